@@ -4,22 +4,48 @@ extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
 #include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
 #include <libavutil/error.h>
 #include <libavutil/log.h>
+#include <libavutil/mathematics.h>
 #include <libavutil/samplefmt.h>
 }
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <thread>
+#include <variant>
+#include <vector>
 
 #include "audio.hpp"
+#include "audio/detail/analysis_cache.hpp"
+#include "audio/detail/analyze.hpp"
 #include "audio/detail/error.hpp"
 #include "audio/detail/filter.hpp"
 #include "audio/detail/format.hpp"
+#include "audio/detail/frame_pool.hpp"
+#include "audio/detail/io.hpp"
 #include "audio/detail/loudnorm.hpp"
+#include "audio/detail/pcm_buffer.hpp"
 #include "audio/detail/pipeline.hpp"
 #include "audio/detail/raii.hpp"
+#include "audio/detail/range_decoder.hpp"
+#include "audio/detail/stage_timer.hpp"
 #include "audio/detail/target_format.hpp"
+#include "audio/detail/validate.hpp"
+#include "audio/detail/waveform.hpp"
+#include "audio/detail/wav_splice.hpp"
 
 #include <spdlog/spdlog.h>
 
@@ -49,14 +75,82 @@ void Audio::Initialize() {
     av_log_set_level(spdlog_to_av_level(spdlog::get_level()));
 }
 
-void Audio::EnsureValid(const fs::path &path) {
-    const auto fmt = OpenAVFormatInput(path);
-    const auto ret = av_find_best_stream(fmt.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
-    av::Check(ret, "No audio stream found in file");
+namespace {
+
+void validate(AudioInput &input, const Audio::ValidateOptions &options) {
+    const auto ifmt = options.Mode == Audio::ValidateMode::Fast ? OpenHeaderOnly(input, options.ProbeSize)
+                                                                 : input.Open();
+    const auto ret = av_find_best_stream(ifmt.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    av::Check(ret, input.Name(), "No audio stream found in input");
+    if (options.Mode == Audio::ValidateMode::Deep) {
+        DecodeAll(ifmt, ifmt->streams[ret], input.Name());
+    }
+}
+
+// Calls `process(state, i)` for every i below `count` on up to `threads` worker threads (0: one per
+// core), each taking the next index as it finishes. Every worker default-constructs its own `State`
+// and keeps it across the items it takes.
+template <typename State, typename Process>
+void runWorkers(const std::size_t count, const unsigned threads, const std::string_view what,
+                const Process &process) {
+    const unsigned hardware = (std::max)(1u, std::thread::hardware_concurrency());
+    const auto workers = static_cast<unsigned>((std::min)(std::size_t{threads ? threads : hardware}, count));
+    spdlog::info("{} {} files on {} workers", what, count, workers);
+
+    std::atomic<std::size_t> next{0};
+    const auto work = [&] {
+        State state;
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            process(state, i);
+        }
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        pool.emplace_back(work);
+    }
+}
+
+} // namespace
+
+void Audio::EnsureValid(const fs::path &path, const ValidateOptions &options) {
+    AudioInput input(path);
+    validate(input, options);
+}
+
+void Audio::EnsureValid(const std::span<const uint8_t> bytes, const ValidateOptions &options) {
+    AudioInput input(bytes);
+    validate(input, options);
+}
+
+std::vector<Audio::ValidateResult> Audio::EnsureValidBatch(const std::span<const fs::path> paths,
+                                                           const ValidateOptions &options, const unsigned threads) {
+    std::vector<ValidateResult> results(paths.size());
+    if (paths.empty())
+        return results;
+
+    runWorkers<std::monostate>(paths.size(), threads, "Validating", [&](std::monostate &, const std::size_t i) {
+        auto &result = results[i];
+        try {
+            EnsureValid(paths[i], options);
+            result.Valid = true;
+        } catch (const std::exception &e) {
+            result.Error = e.what();
+        } catch (...) {
+            result.Error = "Unknown error occurred.";
+        }
+    });
+    return results;
 }
 
 namespace {
 
+// Frame size the WAV writer is fed with, in samples per channel.
+constexpr int kWriteFrameSamples = 4096;
+// Decoded ahead of a preview's start so that codecs which need priming after a seek are exact.
+constexpr int64_t kPreviewPreRollSeconds = 1;
+
 struct NormalizePlan {
     bool needTransform;
     bool needFormat;
@@ -64,48 +158,281 @@ struct NormalizePlan {
     bool needLoudNorm;
     bool needOffset;
     LoudNormStats loudNorm;
+    std::optional<double> linearGain; // dB; set when a constant gain can replace loudnorm
 
     bool isNoop() const {
         return !needTransform && !needFormat && !needChannels && !needLoudNorm && !needOffset;
     }
+
+    bool isOffsetOnly() const {
+        return needOffset && !needTransform && !needFormat && !needChannels && !needLoudNorm;
+    }
 };
 
-NormalizePlan planNormalize(const AVCodecContextPtr &dctx, const LoudNormStats &stats, const double offset,
+NormalizePlan planNormalize(const AudioStreamMeta &meta, const LoudNormStats &stats, const double offset,
                             const TargetFormat &target) {
     NormalizePlan p{};
     p.loudNorm = stats;
-    p.needTransform = dctx->codec_id != target.CodecId;
-    p.needFormat = dctx->sample_rate != target.SampleRate || dctx->sample_fmt != target.SampleFormat;
-    p.needChannels = dctx->ch_layout.nb_channels != 2;
+    p.needTransform = meta.CodecId != target.CodecId;
+    p.needFormat = meta.SampleRate != target.SampleRate || meta.SampleFormat != target.SampleFormat;
+    p.needChannels = meta.Channels != 2;
     p.needLoudNorm = std::abs(stats.InputI - target.Loudness) >= target.GainTolerance ||
                      stats.InputTP > target.TruePeak + target.TruePeakTolerance ||
                      stats.InputLRA > target.LoudnessRange + target.LoudnessRangeTolerance;
     p.needOffset = std::abs(offset) >= target.OffsetTolerance;
+    if (p.needLoudNorm) {
+        p.linearGain = LinearGain(stats, target);
+    }
     return p;
 }
 
+// Fills in loudnorm's target offset when the second pass will run its dynamic mode, replaying
+// `replay` when it holds the decoded input and decoding `src` again otherwise. Serial analyses
+// without a replay measure it alongside the meter instead (see Measure).
+void addTargetOffset(AudioAnalysis &analysis, const Audio::detail::AudioInput &src,
+                     const Audio::detail::PcmBuffer *replay, const double offset, const TargetFormat &target) {
+    using namespace Audio::detail;
+
+    const auto p = planNormalize(analysis.Meta, analysis.LoudNorm, offset, target);
+    if (!p.needLoudNorm || p.linearGain)
+        return;
+    analysis.LoudNorm.TargetOffset =
+        replay ? MeasureTargetOffset(*replay, target) : MeasureTargetOffset(src, offset, target);
+}
+
 struct NormalizeChain {
     AVFilterContext *src;
     AVFilterContext *sink;
 };
 
-NormalizeChain buildChain(const Audio::detail::AVFilterGraphPtr &graph, const Audio::detail::AVCodecContextPtr &dctx,
-                          const NormalizePlan &plan, double offset, const TargetFormat &target) {
+// Appends the loudness correction the plan calls for to `flast`.
+AVFilterContext *applyCorrection(const Audio::detail::AVFilterGraphPtr &graph, AVFilterContext *flast,
+                                 const NormalizePlan &plan, const TargetFormat &target) {
     using namespace Audio::detail;
 
-    AVFilterContext *fsrc = BufferSource(graph, dctx);
-    AVFilterContext *flast = ApplyOffset(graph, dctx, fsrc, offset, target);
+    if (plan.linearGain)
+        return ApplyGain(graph, flast, *plan.linearGain);
+    if (plan.needLoudNorm)
+        return ApplyLoudNorm(graph, flast, plan.loudNorm, target);
+    return flast;
+}
 
-    if (plan.needLoudNorm) {
-        spdlog::info("Applying two-pass loudnorm filter");
-        flast = ApplyLoudNorm(graph, flast, plan.loudNorm, target);
+// swresample options for a preset, or nullptr to leave its defaults to the conversion aformat
+// inserts on its own.
+const char *resamplerOptions(const Audio::ResampleQuality quality) {
+    switch (quality) {
+    case Audio::ResampleQuality::Fast:
+        return "filter_size=16:cutoff=0.85:kaiser_beta=6";
+    case Audio::ResampleQuality::High:
+        return "filter_size=128:cutoff=0.98:kaiser_beta=12";
+    default:
+        return nullptr;
     }
+}
+
+// Appends the conversion to the target sample format, rate and stereo layout, ending in a buffer sink.
+AVFilterContext *convertToTarget(const Audio::detail::AVFilterGraphPtr &graph, AVFilterContext *flast,
+                                 const TargetFormat &target) {
+    using namespace Audio::detail;
 
+    if (const auto *resampler = resamplerOptions(target.Resampler)) {
+        flast = Filter(graph, flast, "aresample", "aresample", "{}:{}", target.SampleRate, resampler);
+    }
     flast = Filter(graph, flast, "aformat", "aformat", "sample_fmts={}:sample_rates={}:channel_layouts=stereo",
                    av_get_sample_fmt_name(target.SampleFormat), target.SampleRate);
+    return Filter(graph, flast, "abuffersink", "abuffersink");
+}
+
+// Appends both the loudness correction and the conversion to the target format.
+AVFilterContext *finishChain(const Audio::detail::AVFilterGraphPtr &graph, AVFilterContext *flast,
+                             const NormalizePlan &plan, const TargetFormat &target) {
+    return convertToTarget(graph, applyCorrection(graph, flast, plan, target), target);
+}
+
+// Source of the second pass, fed either straight from the decoder, or from PCM replayed out of a
+// PcmBuffer in which case the offset has already been applied during capture. Returns the source
+// and the filter the correction is appended to.
+std::pair<AVFilterContext *, AVFilterContext *> buildSource(const Audio::detail::AVFilterGraphPtr &graph,
+                                                            const Audio::detail::AVCodecContextPtr &dctx,
+                                                            const Audio::detail::PcmBuffer *replay,
+                                                            const NormalizePlan &plan, const double offset,
+                                                            const TargetFormat &target) {
+    using namespace Audio::detail;
+
+    AVFilterContext *fsrc = replay ? BufferSource(graph, replay->Format(), replay->SampleRate(), replay->Layout(),
+                                                  AVRational{1, replay->SampleRate()})
+                                   : BufferSource(graph, dctx);
+    AVFilterContext *flast = replay ? fsrc : ApplyOffset(graph, dctx, fsrc, offset, target);
+
+    if (plan.linearGain) {
+        spdlog::info("Applying linear gain of {:.2f} dB", *plan.linearGain);
+    } else if (plan.needLoudNorm) {
+        spdlog::info("Applying two-pass loudnorm filter");
+    }
+    return {fsrc, flast};
+}
+
+// Builds the second-pass chain for a single output.
+NormalizeChain buildChain(const Audio::detail::AVFilterGraphPtr &graph, const Audio::detail::AVCodecContextPtr &dctx,
+                          const Audio::detail::PcmBuffer *replay, const NormalizePlan &plan, double offset,
+                          const TargetFormat &target) {
+    const auto [fsrc, flast] = buildSource(graph, dctx, replay, plan, offset, target);
+    return {fsrc, finishChain(graph, flast, plan, target)};
+}
 
-    AVFilterContext *fsnk = Filter(graph, flast, "abuffersink", "abuffersink");
-    return {fsrc, fsnk};
+// Builds the part of the second pass shared by several outputs: everything up to the loudness
+// correction, ending in a sink that takes the corrected stream as is. Each output then converts it
+// in a graph of its own (see FanOutBranch), the split point being where a single chain converts.
+NormalizeChain buildSharedChain(const Audio::detail::AVFilterGraphPtr &graph,
+                                const Audio::detail::AVCodecContextPtr &dctx, const Audio::detail::PcmBuffer *replay,
+                                const NormalizePlan &plan, double offset, const TargetFormat &target) {
+    using namespace Audio::detail;
+
+    const auto [fsrc, flast] = buildSource(graph, dctx, replay, plan, offset, target);
+    return {fsrc, Filter(graph, applyCorrection(graph, flast, plan, target), "abuffersink", "abuffersink")};
+}
+
+// Length of the normalized output in target samples, for preallocation only: exact for replayed
+// PCM, taken from the container duration otherwise, 0 when that is unknown.
+int64_t estimateOutputFrames(const Audio::detail::AVFormatInputContextPtr &ifmt, const Audio::detail::PcmBuffer *replay,
+                             const double offset, const TargetFormat &target) {
+    if (replay)
+        return av_rescale(replay->Samples(), target.SampleRate, replay->SampleRate());
+    if (ifmt->duration == AV_NOPTS_VALUE || ifmt->duration <= 0)
+        return 0;
+    const int64_t duration = ifmt->duration + llround(offset * AV_TIME_BASE);
+    return duration > 0 ? av_rescale(duration, target.SampleRate, AV_TIME_BASE) : 0;
+}
+
+// Feeds `count` samples of `frame` starting at `first` to `fsrc` with timestamp `pts`, through `in`.
+void addSamples(AVFilterContext *fsrc, const Audio::detail::AVFramePtr &in, const AVFrame *frame, const int first,
+                const int count, const int64_t pts) {
+    in->format = frame->format;
+    in->sample_rate = frame->sample_rate;
+    in->nb_samples = count;
+    auto ret = av_channel_layout_copy(&in->ch_layout, &frame->ch_layout);
+    av::Check(ret, "Failed to copy channel layout");
+    ret = av_frame_get_buffer(in.get(), 0);
+    av::Check(ret, "Failed to allocate frame buffer");
+    av_samples_copy(in->extended_data, frame->extended_data, 0, first, count, frame->ch_layout.nb_channels,
+                    static_cast<AVSampleFormat>(frame->format));
+    in->pts = pts;
+    ret = av_buffersrc_add_frame(fsrc, in.get());
+    av::Check(ret, "Failed to feed filter graph");
+}
+
+// Renders the second pass in time ranges on parallel threads, each decoding its range on its own
+// demuxer and decoder and writing straight to its place in the output. Only valid for a plan whose
+// gain does not depend on the signal (a linear gain, or none). Range starts are multiples of
+// inRate / gcd(inRate, outRate) input samples, where the resampler's filter phase is the same as at
+// the start of the stream, and each range is decoded from a pre-roll before its start to a
+// post-roll after its end; so once the filter history is filled, every range produces exactly the
+// samples a serial pass would, and only those in its own range are written. Returns false, having
+// written nothing, when the input is too short to split or does not seek sample-exactly.
+bool renderSegmented(const Audio::detail::AudioInput &src, const Audio::detail::AVFormatInputContextPtr &ifmt,
+                     const AVStream *ist, const Audio::detail::AVCodecContextPtr &dctx, const NormalizePlan &plan,
+                     const double offset, const TargetFormat &target, const unsigned threads,
+                     Audio::detail::AudioOutput &dst) {
+    using namespace Audio::detail;
+
+    if (!HasExactSeek(dctx->codec_id))
+        return false;
+
+    const int inRate = dctx->sample_rate;
+    const int outRate = target.SampleRate;
+    const int64_t shift = OffsetSamples(offset, inRate, target);
+    const int64_t total = StreamDurationSamples(ifmt, ist, inRate) + shift;
+    const int64_t segments = RangeCount(total, inRate, threads);
+    if (segments < 2)
+        return false;
+
+    const int64_t unitIn = inRate / std::gcd(inRate, outRate);
+    const int64_t unitOut = outRate / std::gcd(inRate, outRate);
+    const int64_t length = total / segments / unitIn * unitIn;
+    const int64_t preRoll = (inRate + unitIn - 1) / unitIn * unitIn; // about a second, far beyond any filter
+    spdlog::info("Rendering in {} segments of {:.1f} s", segments, static_cast<double>(length) / inRate);
+    if (plan.linearGain) {
+        spdlog::info("Applying linear gain of {:.2f} dB", *plan.linearGain);
+    }
+
+    const WavFormat wav{target.SampleFormat, outRate, 2};
+    const auto blockAlign = static_cast<std::size_t>(av_get_bytes_per_sample(target.SampleFormat)) * 2;
+    const auto writer = dst.Open(wav, av_rescale(total, outRate, inRate));
+
+    const auto renderRange = [&](const int64_t from, const int64_t to, const int64_t outStart, const int64_t outEnd) {
+        RangeDecoder decoder(src);
+        const auto &rctx = decoder.Decoder();
+
+        const AVFilterGraphPtr graph(avfilter_graph_alloc());
+        av::Require(graph.get(), "Failed to allocate filter graph");
+        AVFilterContext *fsrc =
+            BufferSource(graph, rctx->sample_fmt, rctx->sample_rate, rctx->ch_layout, AVRational{1, inRate});
+        AVFilterContext *fsnk = finishChain(graph, fsrc, plan, target);
+        auto ret = avfilter_graph_config(graph.get(), nullptr);
+        av::Check(ret, "Failed to configure filter graph.");
+
+        const AVFramePtr in(av_frame_alloc());
+        const AVFramePtr out(av_frame_alloc());
+        av::Require(in.get() && out.get(), "Failed to allocate frames");
+
+        int64_t inPos = from;
+        int64_t outPos = from / unitIn * unitOut;
+        const auto drain = [&] {
+            for (;;) {
+                const auto r = av_buffersink_get_frame(fsnk, out.get());
+                if (r == AVERROR(EAGAIN) || r == AVERROR_EOF)
+                    return;
+                av::Check(r, "Failed to get frame from filter graph");
+                const int64_t lo = (std::max)(outPos, outStart);
+                const int64_t hi = (std::min)(outPos + out->nb_samples, outEnd);
+                if (lo < hi) {
+                    writer->WriteAt(lo, {out->data[0] + static_cast<std::size_t>(lo - outPos) * blockAlign,
+                                         static_cast<std::size_t>(hi - lo) * blockAlign});
+                }
+                outPos += out->nb_samples;
+                av_frame_unref(out.get());
+            }
+        };
+
+        decoder.Run(shift, from, to, [&](const AVFrame *frame, const int first, const int count) {
+            addSamples(fsrc, in, frame, first, count, inPos);
+            inPos += count;
+            drain();
+        });
+        ret = av_buffersrc_add_frame(fsrc, nullptr);
+        av::Check(ret, "Failed to flush filter graph");
+        drain();
+    };
+
+    std::vector<std::exception_ptr> errors(static_cast<size_t>(segments));
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(static_cast<size_t>(segments));
+        for (int64_t k = 0; k < segments; ++k) {
+            constexpr int64_t kEnd = (std::numeric_limits<int64_t>::max)();
+            const bool last = k + 1 == segments;
+            const int64_t start = k * length;
+            const int64_t end = start + length;
+            const int64_t from = (std::max)(int64_t{0}, start - preRoll);
+            const int64_t to = last ? kEnd : end + preRoll;
+            const int64_t outStart = start / unitIn * unitOut;
+            const int64_t outEnd = last ? kEnd : end / unitIn * unitOut;
+            workers.emplace_back([&, k, from, to, outStart, outEnd] {
+                try {
+                    renderRange(from, to, outStart, outEnd);
+                } catch (...) {
+                    errors[k] = std::current_exception();
+                }
+            });
+        }
+    }
+    for (const auto &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    writer->Finish();
+    return true;
 }
 
 void seekInputToStart(const Audio::detail::AVFormatInputContextPtr &ifmt, const AVStream *ist,
@@ -115,53 +442,599 @@ void seekInputToStart(const Audio::detail::AVFormatInputContextPtr &ifmt, const
     avcodec_flush_buffers(dctx.get());
 }
 
-} // namespace
+// One output of a worker run: where it goes, in which format, and whether it was written.
+struct NormalizeTarget {
+    Audio::detail::AudioOutput *Dst;
+    TargetFormat Target;
+    fs::path Waveform; // sidecar path, empty for none
+    bool Written = false;
+};
+
+// Where the frames of one output go: its writer and, when asked for, its waveform sidecar.
+class OutputSink {
+  public:
+    OutputSink(const NormalizeTarget &output, const int64_t expectedFrames)
+        : m_writer(output.Dst->Open(
+              Audio::detail::WavFormat{output.Target.SampleFormat, output.Target.SampleRate, 2}, expectedFrames)),
+          m_waveformPath(output.Waveform) {
+        if (!m_waveformPath.empty()) {
+            m_waveform.emplace(output.Target.SampleRate, 2);
+        }
+    }
+
+    void Write(const AVFrame *frame) {
+        m_writer->Write(frame);
+        if (m_waveform) {
+            m_waveform->Add(frame);
+        }
+    }
+
+    void Finish() {
+        m_writer->Finish();
+        if (m_waveform) {
+            m_waveform->Write(m_waveformPath);
+        }
+    }
+
+  private:
+    std::unique_ptr<Audio::detail::WavWriter> m_writer;
+    std::optional<Audio::detail::WaveformBuilder> m_waveform;
+    fs::path m_waveformPath;
+};
+
+// One output of a fan-out: its own graph converting the shared corrected stream to its format,
+// feeding its own sink.
+struct FanOutBranch {
+    Audio::detail::AVFilterGraphPtr Graph;
+    AVFilterContext *Src;
+    AVFilterContext *Sink;
+    std::optional<OutputSink> Output;
+};
+
+// Copies the decisions of `plan` into `stats`.
+void recordPlan(Audio::NormalizeStats &stats, const NormalizePlan &plan) {
+    stats.NeedTransform = plan.needTransform;
+    stats.NeedFormat = plan.needFormat;
+    stats.NeedChannels = plan.needChannels;
+    stats.NeedLoudNorm = plan.needLoudNorm;
+    stats.NeedOffset = plan.needOffset;
+    stats.LinearGain = plan.linearGain.has_value();
+    stats.GainDb = plan.linearGain.value_or(0.0);
+}
+
+// Per-thread state reused across jobs: the packets and frames used to run graphs (pooled for the
+// pipelined mode) and the PCM capture buffer. Filter graphs are still built per job since a graph
+// cannot be restarted once it has seen EOF.
+class NormalizeWorker {
+  public:
+    bool Run(Audio::detail::AudioInput &src, Audio::detail::AudioOutput &dst, const Audio::NormalizeOptions &options,
+             Audio::NormalizeStats *stats = nullptr);
+    // Normalizes `src` into every output with one analysis and one decode. `options` supplies
+    // everything but the output formats, which come from each output's target.
+    void Run(Audio::detail::AudioInput &src, std::span<NormalizeTarget> outputs, const Audio::NormalizeOptions &options,
+             Audio::NormalizeStats *stats = nullptr);
+
+  private:
+    // Does the work of Run and returns the route taken (see NormalizeStats::Route).
+    const char *RunStages(Audio::detail::AudioInput &src, std::span<NormalizeTarget> outputs,
+                          const Audio::NormalizeOptions &options, Audio::NormalizeStats *stats);
+
+    Audio::detail::GraphScratch m_scratch;
+    Audio::detail::FramePool m_pool;
+    std::optional<Audio::detail::PcmBuffer> m_decoded;
+};
+
+bool NormalizeWorker::Run(Audio::detail::AudioInput &src, Audio::detail::AudioOutput &dst,
+                          const Audio::NormalizeOptions &options, Audio::NormalizeStats *stats) {
+    NormalizeTarget output{&dst, MakeTargetFormat(options), options.Waveform};
+    Run(src, std::span(&output, 1), options, stats);
+    return output.Written;
+}
+
+void NormalizeWorker::Run(Audio::detail::AudioInput &src, const std::span<NormalizeTarget> outputs,
+                          const Audio::NormalizeOptions &options, Audio::NormalizeStats *stats) {
+    if (!stats) {
+        RunStages(src, outputs, options, nullptr);
+        return;
+    }
+
+    *stats = {};
+    StageTimer total(&stats->Total);
+    stats->Route = RunStages(src, outputs, options, stats);
+    total.Stop();
+
+    for (const auto &output : outputs) {
+        if (output.Written) {
+            stats->BytesWritten += output.Dst->Size();
+        }
+    }
+    if (stats->Total.WallSeconds > 0.0) {
+        stats->RealtimeFactor = stats->InputSeconds / stats->Total.WallSeconds;
+    }
+}
 
-bool Audio::Normalize(const fs::path &src, const fs::path &dst, const NormalizeOptions &options) {
+const char *NormalizeWorker::RunStages(Audio::detail::AudioInput &src, const std::span<NormalizeTarget> outputs,
+                                       const Audio::NormalizeOptions &options, Audio::NormalizeStats *stats) {
     using namespace Audio::detail;
 
+    const auto stage = [stats](Audio::StageTiming Audio::NormalizeStats::*timing) {
+        return stats ? &(stats->*timing) : nullptr;
+    };
+
     const auto target = MakeTargetFormat(options);
-    const auto ifmt = OpenAVFormatInput(src);
+    const auto allNoop = [&](const AudioAnalysis &analysis) {
+        return std::ranges::all_of(outputs, [&](const NormalizeTarget &output) {
+            return planNormalize(analysis.Meta, analysis.LoudNorm, options.Offset, output.Target).isNoop();
+        });
+    };
+
+    // A cache hit settles the plan before the source is even opened; only a real second pass
+    // decodes it then.
+    std::optional<AnalysisKey> cacheKey;
+    std::optional<AudioAnalysis> cached;
+    if (options.Cache) {
+        StageTimer timer(stage(&Audio::NormalizeStats::Analysis));
+        cacheKey = src.InMemory() ? MakeAnalysisKey(src.Bytes(), options.Offset, target)
+                                  : MakeAnalysisKey(src.Name(), options.Offset, target);
+        cached = options.Cache->Store().Lookup(*cacheKey);
+        if (stats && cached) {
+            stats->CacheHit = true;
+            stats->Codec = avcodec_get_name(cached->Meta.CodecId);
+            recordPlan(*stats, planNormalize(cached->Meta, cached->LoudNorm, options.Offset, outputs.front().Target));
+        }
+        if (cached && allNoop(*cached))
+            return "unchanged";
+    }
+
+    StageTimer openTimer(stage(&Audio::NormalizeStats::Open));
+    const auto ifmt = src.Open();
     const auto ist = GetBestAudioStream(ifmt);
     const auto dctx = OpenDecoder(ist);
-    const auto loudNormStats = AnalyzeLoudNorm(ifmt, ist, dctx, options.Offset, target);
+    openTimer.Stop();
 
-    const auto plan = planNormalize(dctx, loudNormStats, options.Offset, target);
-    if (plan.isNoop())
-        return false;
+    if (stats) {
+        const auto frames = StreamDurationSamples(ifmt, ist, dctx->sample_rate);
+        stats->InputFrames = static_cast<uint64_t>((std::max)(frames, int64_t{0}));
+        stats->InputSeconds = static_cast<double>(stats->InputFrames) / dctx->sample_rate;
+        stats->Codec = avcodec_get_name(dctx->codec_id);
+    }
+    // Whatever the route, report what the main demuxer read by the time it returns.
+    const auto done = [&](const char *route) {
+        if (stats && ifmt->pb) {
+            stats->BytesRead = static_cast<uint64_t>(ifmt->pb->bytes_read);
+        }
+        return route;
+    };
 
-    seekInputToStart(ifmt, ist, dctx, src);
+    PcmBuffer *replay = nullptr;
+    if (options.ReuseDecodedAudio && !cached) {
+        if (m_decoded) {
+            m_decoded->Reset(options.DecodedAudioMemoryLimit);
+        } else {
+            m_decoded.emplace(options.DecodedAudioMemoryLimit);
+        }
+        replay = &*m_decoded;
+    }
+
+    AudioAnalysis analysis;
+    if (cached) {
+        analysis = *cached;
+    } else {
+        StageTimer timer(stage(&Audio::NormalizeStats::Analysis));
+        std::optional<AudioAnalysis> segmented;
+        if (options.AnalysisThreads != 1) {
+            segmented = MeasureSegmented(src, ifmt, ist, dctx, options.Offset, target, options.AnalysisThreads);
+        }
+        if (segmented) {
+            analysis = *segmented;
+            replay = nullptr;
+            addTargetOffset(analysis, src, nullptr, options.Offset, target);
+        } else if (replay) {
+            analysis = Measure(ifmt, ist, dctx, options.Offset, target, replay, options.Pipelined);
+            addTargetOffset(analysis, src, replay, options.Offset, target);
+        } else {
+            // Without a replay the offset would take another decode; measure it on the way instead.
+            analysis = Measure(ifmt, ist, dctx, options.Offset, target, nullptr, options.Pipelined, true);
+        }
+        if (cacheKey) {
+            options.Cache->Store().Insert(*cacheKey, analysis);
+        }
+    }
+
+    if (stats) {
+        recordPlan(*stats, planNormalize(analysis.Meta, analysis.LoudNorm, options.Offset, outputs.front().Target));
+    }
+
+    StageTimer renderTimer(stage(&Audio::NormalizeStats::Render));
+    const char *route = "unchanged";
+    std::vector<NormalizeTarget *> pending;
+    for (auto &output : outputs) {
+        const auto plan = planNormalize(analysis.Meta, analysis.LoudNorm, options.Offset, output.Target);
+        if (plan.isNoop())
+            continue;
 
-    const auto ofmt = OpenAVFormatOutput(dst);
-    const AVCodecContextPtr ectx = OpenEncoder(target);
-    AVStream *const ost = OpenOutputStream(dst, ofmt, ectx);
+        // The samples are already what the output needs, only shifted: splice them into a new file.
+        const WavFormat wav{output.Target.SampleFormat, output.Target.SampleRate, 2};
+        if (plan.isOffsetOnly() && output.Waveform.empty() && std::string_view(ifmt->iformat->name) == "wav" &&
+            SpliceWav(src, *output.Dst, wav, OffsetSamples(options.Offset, output.Target.SampleRate, target))) {
+            spdlog::info("Only the offset changes, splicing PCM data without decoding");
+            output.Written = true;
+            route = "splice";
+            continue;
+        }
+        pending.push_back(&output);
+    }
+    if (pending.empty())
+        return done(route);
+
+    // The loudness correction only depends on the shared options, so it is the same for every output.
+    const auto plan = planNormalize(analysis.Meta, analysis.LoudNorm, options.Offset, pending.front()->Target);
+
+    // A gain that does not depend on the signal lets separate time ranges be rendered independently.
+    if (pending.size() == 1 && pending.front()->Waveform.empty() && options.RenderThreads != 1 &&
+        (plan.linearGain || !plan.needLoudNorm) &&
+        renderSegmented(src, ifmt, ist, dctx, plan, options.Offset, pending.front()->Target, options.RenderThreads,
+                        *pending.front()->Dst)) {
+        pending.front()->Written = true;
+        return done("segmented");
+    }
+
+    // The seek is timed on its own, between the planning above and the graph below; both count as
+    // Render, each exactly once.
+    renderTimer.Stop();
+    if (!replay && !cached) {
+        StageTimer seekTimer(stage(&Audio::NormalizeStats::Seek));
+        seekInputToStart(ifmt, ist, dctx, src.Name());
+    }
+    StageTimer graphTimer(stage(&Audio::NormalizeStats::Render));
+    const auto graphStart = std::chrono::steady_clock::now();
 
     const AVFilterGraphPtr graph(avfilter_graph_alloc());
     av::Require(graph.get(), "Failed to allocate filter graph");
 
-    const auto chain = buildChain(graph, dctx, plan, options.Offset, target);
+    NormalizeChain chain{};
+    std::optional<OutputSink> single;
+    std::vector<FanOutBranch> branches;
+    if (pending.size() == 1) {
+        const auto &singleTarget = pending.front()->Target;
+        chain = buildChain(graph, dctx, replay, plan, options.Offset, singleTarget);
+        single.emplace(*pending.front(), estimateOutputFrames(ifmt, replay, options.Offset, singleTarget));
+    } else {
+        spdlog::info("Fanning out to {} outputs", pending.size());
+        chain = buildSharedChain(graph, dctx, replay, plan, options.Offset, target);
+    }
 
     auto ret = avfilter_graph_config(graph.get(), nullptr);
     av::Check(ret, "Failed to configure filter graph.");
 
     av::Require(chain.src && chain.sink, "Failed to build normalize filter chain");
 
-    const AVRational sinkTb = av_buffersink_get_time_base(chain.sink);
+    if (single) {
+        // Hand the writer large, uniform frames rather than whatever sizes the filters produce.
+        av_buffersink_set_frame_size(chain.sink, kWriteFrameSamples);
+    } else {
+        for (const auto *output : pending) {
+            const auto &branchTarget = output->Target;
+            auto &branch = branches.emplace_back();
+            branch.Graph.reset(avfilter_graph_alloc());
+            av::Require(branch.Graph.get(), "Failed to allocate filter graph");
+            branch.Src = BufferSource(branch.Graph, chain.sink);
+            branch.Sink = convertToTarget(branch.Graph, branch.Src, branchTarget);
+            ret = avfilter_graph_config(branch.Graph.get(), nullptr);
+            av::Check(ret, "Failed to configure filter graph.");
+            av_buffersink_set_frame_size(branch.Sink, kWriteFrameSamples);
+            branch.Output.emplace(*output, estimateOutputFrames(ifmt, replay, options.Offset, branchTarget));
+        }
+    }
+
+    const AVFramePtr branchFrame(av_frame_alloc());
+    av::Require(branchFrame.get(), "Failed to allocate frame");
+    const auto drainBranch = [&](FanOutBranch &branch) {
+        while (av_buffersink_get_frame(branch.Sink, branchFrame.get()) == 0) {
+            branch.Output->Write(branchFrame.get());
+            av_frame_unref(branchFrame.get());
+        }
+    };
+    std::chrono::steady_clock::duration writeTime{};
+    const auto writeFrame = [&](const AVFrame *f) {
+        const auto start = std::chrono::steady_clock::now();
+        if (single) {
+            single->Write(f);
+        } else {
+            for (auto &branch : branches) {
+                const auto r = av_buffersrc_write_frame(branch.Src, f);
+                av::Check(r, "Failed to add frame to buffer source: {}", branch.Src->filter->name);
+                drainBranch(branch);
+            }
+        }
+        writeTime += std::chrono::steady_clock::now() - start;
+    };
+
+    m_scratch.DecodeTime = {};
+    if (replay && options.Pipelined) {
+        RunGraphPipelined(*replay, chain.src, chain.sink, m_pool, writeFrame);
+    } else if (replay) {
+        RunGraph(*replay, chain.src, chain.sink, m_scratch, writeFrame);
+    } else if (options.Pipelined) {
+        RunGraphPipelined(ifmt, ist, dctx, chain.src, chain.sink, m_pool, writeFrame);
+    } else {
+        RunGraph(ifmt, ist, dctx, chain.src, chain.sink, m_scratch, writeFrame);
+    }
+
+    for (auto &branch : branches) {
+        ret = av_buffersrc_add_frame(branch.Src, nullptr);
+        av::Check(ret, "Failed to add end-of-stream frame to buffer source: {}", branch.Src->filter->name);
+        drainBranch(branch);
+        branch.Output->Finish();
+    }
+    if (single) {
+        single->Finish();
+    }
+    for (auto *output : pending) {
+        output->Written = true;
+    }
+
+    if (stats && !options.Pipelined) {
+        using Seconds = std::chrono::duration<double>;
+        stats->DecodeSeconds = Seconds(m_scratch.DecodeTime).count();
+        stats->WriteSeconds = Seconds(writeTime).count();
+        const auto graphSeconds = Seconds(std::chrono::steady_clock::now() - graphStart).count();
+        stats->FilterSeconds = (std::max)(graphSeconds - stats->DecodeSeconds - stats->WriteSeconds, 0.0);
+    }
+    return done(single ? "graph" : "fan-out");
+}
+
+} // namespace
+
+bool Audio::Normalize(const fs::path &src, const fs::path &dst, const NormalizeOptions &options,
+                      NormalizeStats *stats) {
+    AudioInput input(src);
+    AudioOutput output(dst);
+    NormalizeWorker worker;
+    return worker.Run(input, output, options, stats);
+}
+
+bool Audio::Normalize(const std::span<const uint8_t> src, std::vector<uint8_t> &dst, const NormalizeOptions &options,
+                      NormalizeStats *stats) {
+    AudioInput input(src);
+    AudioOutput output(dst);
+    NormalizeWorker worker;
+    return worker.Run(input, output, options, stats);
+}
+
+std::vector<Audio::NormalizeStatus> Audio::NormalizeFanOut(const fs::path &src,
+                                                           const std::span<const NormalizeOutput> outputs,
+                                                           NormalizeStats *stats) {
+    if (outputs.empty())
+        return {};
+
+    const auto &options = outputs.front().Options;
+    std::vector<std::unique_ptr<AudioOutput>> dsts;
+    std::vector<NormalizeTarget> targets;
+    dsts.reserve(outputs.size());
+    targets.reserve(outputs.size());
+    for (const auto &output : outputs) {
+        auto shared = output.Options;
+        shared.SampleFormat = options.SampleFormat;
+        shared.SampleRate = options.SampleRate;
+        shared.Resampler = options.Resampler;
+        shared.Waveform = options.Waveform;
+        if (!(shared == options)) {
+            throw std::runtime_error(
+                "Fan-out outputs may only differ in sample format, sample rate, resampler and waveform sidecar");
+        }
+        dsts.push_back(std::make_unique<AudioOutput>(output.Dst));
+        targets.push_back({dsts.back().get(), MakeTargetFormat(output.Options), output.Options.Waveform});
+    }
+
+    AudioInput input(src);
+    NormalizeWorker worker;
+    worker.Run(input, targets, options, stats);
+
+    std::vector<NormalizeStatus> statuses;
+    statuses.reserve(targets.size());
+    for (const auto &target : targets) {
+        statuses.push_back(target.Written ? NormalizeStatus::Normalized : NormalizeStatus::Unchanged);
+    }
+    return statuses;
+}
 
-    const AVPacketPtr pkt(av_packet_alloc());
-    av::Require(pkt.get(), "Failed to allocate packet");
+std::vector<Audio::NormalizeResult> Audio::NormalizeBatch(const std::span<const NormalizeJob> jobs,
+                                                          const unsigned threads) {
+    std::vector<NormalizeResult> results(jobs.size());
+    if (jobs.empty())
+        return results;
 
-    RunGraph(ifmt, ist, dctx, chain.src, chain.sink, [&](AVFrame *f) {
-        AVFramePtr owned(av_frame_alloc());
-        av::Require(owned.get(), "Failed to allocate frame");
-        av_frame_move_ref(owned.get(), f);
-        Encode(owned, ectx, ofmt, ost, pkt, sinkTb);
+    runWorkers<NormalizeWorker>(jobs.size(), threads, "Normalizing", [&](NormalizeWorker &worker, const std::size_t i) {
+        const auto &job = jobs[i];
+        auto &result = results[i];
+        try {
+            AudioInput input(job.Src);
+            AudioOutput output(job.Dst);
+            result.Status =
+                worker.Run(input, output, job.Options) ? NormalizeStatus::Normalized : NormalizeStatus::Unchanged;
+        } catch (const std::exception &e) {
+            result.Status = NormalizeStatus::Failed;
+            result.Error = e.what();
+            spdlog::error("Failed to normalize {}: {}", lib::PathToUtf8(job.Src), result.Error);
+        } catch (...) {
+            result.Status = NormalizeStatus::Failed;
+            result.Error = "Unknown error occurred.";
+            spdlog::error("Failed to normalize {}: {}", lib::PathToUtf8(job.Src), result.Error);
+        }
     });
+    return results;
+}
 
-    FlushEncoder(ectx, ofmt, ost, pkt);
+namespace {
 
-    ret = av_write_trailer(ofmt.get());
-    av::Check(ret, "Failed to write trailer to output format: {}", ofmt->oformat->name);
+// Whole-input loudness for `src`: from the cache when it has it, otherwise measured (in parallel
+// segments when options allow) and stored there. `cacheHit`, when given, tells which.
+AudioAnalysis measureWhole(const AudioInput &src, const AVFormatInputContextPtr &ifmt, const AVStream *ist,
+                           const AVCodecContextPtr &dctx, const Audio::NormalizeOptions &options,
+                           const TargetFormat &target, bool *cacheHit = nullptr) {
+    std::optional<AnalysisKey> cacheKey;
+    if (options.Cache) {
+        cacheKey = src.InMemory() ? MakeAnalysisKey(src.Bytes(), options.Offset, target)
+                                  : MakeAnalysisKey(src.Name(), options.Offset, target);
+        const auto cached = options.Cache->Store().Lookup(*cacheKey);
+        if (cacheHit) {
+            *cacheHit = cached.has_value();
+        }
+        if (cached)
+            return *cached;
+    }
 
-    return true;
+    std::optional<AudioAnalysis> analysis;
+    if (options.AnalysisThreads != 1) {
+        analysis = MeasureSegmented(src, ifmt, ist, dctx, options.Offset, target, options.AnalysisThreads);
+        if (analysis) {
+            addTargetOffset(*analysis, src, nullptr, options.Offset, target);
+        }
+    }
+    if (!analysis) {
+        analysis = Measure(ifmt, ist, dctx, options.Offset, target, nullptr, false, true);
+    }
+    if (cacheKey) {
+        options.Cache->Store().Insert(*cacheKey, *analysis);
+    }
+    return *analysis;
+}
+
+// The constant gain of a preview: the linear-mode gain when loudnorm would use one; otherwise, as
+// loudnorm's dynamic correction cannot be reproduced for an excerpt, the largest gain towards the
+// target loudness that keeps the whole input's true peak within the target.
+double previewGain(const LoudNormStats &stats, const TargetFormat &target) {
+    if (const auto gain = LinearGain(stats, target))
+        return *gain;
+    if (stats.InputI <= -70.0)
+        return 0.0;
+    return (std::min)(target.Loudness - stats.InputI, target.TruePeak - stats.InputTP);
+}
+
+Audio::PlanResult plan(AudioInput &src, const Audio::NormalizeOptions &options) {
+    const auto target = MakeTargetFormat(options);
+    const auto ifmt = src.Open();
+    const auto ist = GetBestAudioStream(ifmt);
+    const auto dctx = OpenDecoder(ist);
+
+    Audio::PlanResult result;
+    const auto analysis = measureWhole(src, ifmt, ist, dctx, options, target, &result.CacheHit);
+    const auto &meta = analysis.Meta;
+    result.Codec = avcodec_get_name(meta.CodecId);
+    const char *sampleFormat = av_get_sample_fmt_name(meta.SampleFormat);
+    result.SampleFormat = sampleFormat ? sampleFormat : "unknown";
+    result.SampleRate = meta.SampleRate;
+    result.Channels = meta.Channels;
+    if (meta.SampleRate > 0) {
+        result.DurationSeconds =
+            static_cast<double>(StreamDurationSamples(ifmt, ist, meta.SampleRate)) / meta.SampleRate;
+    }
+
+    const auto &stats = analysis.LoudNorm;
+    result.Loudness = stats.InputI;
+    result.TruePeak = stats.InputTP;
+    result.LoudnessRange = stats.InputLRA;
+    result.Threshold = stats.InputThresh;
+
+    const auto p = planNormalize(meta, stats, options.Offset, target);
+    result.NeedTransform = p.needTransform;
+    result.NeedFormat = p.needFormat;
+    result.NeedChannels = p.needChannels;
+    result.NeedLoudNorm = p.needLoudNorm;
+    result.NeedOffset = p.needOffset;
+    result.LinearGain = p.linearGain.has_value();
+    result.GainDb = p.linearGain.value_or(0.0);
+    return result;
+}
+
+} // namespace
+
+void Audio::NormalizePreview(const fs::path &src, const fs::path &dst, const NormalizeOptions &options,
+                             const PreviewOptions &preview) {
+    if (!(preview.Start >= 0.0) || !(preview.Duration > 0.0)) {
+        throw std::runtime_error("Preview must start at or after 0 s and last longer than 0 s");
+    }
+
+    const auto target = MakeTargetFormat(options);
+    AudioInput input(src);
+    AudioOutput output(dst);
+    const auto ifmt = input.Open();
+    const auto ist = GetBestAudioStream(ifmt);
+    const auto dctx = OpenDecoder(ist);
+    const auto analysis = measureWhole(input, ifmt, ist, dctx, options, target);
+    const double gain = previewGain(analysis.LoudNorm, target);
+
+    const int inRate = dctx->sample_rate;
+    const int64_t shift = OffsetSamples(options.Offset, inRate, target);
+    const int64_t start = llround(preview.Start * inRate);
+    int64_t end = start + llround(preview.Duration * inRate);
+    if (const int64_t length = StreamDurationSamples(ifmt, ist, inRate); length > 0) {
+        end = (std::min)(end, length + shift);
+    }
+    if (start >= end) {
+        throw lib::FileError(src, "Preview starts after the end of the input");
+    }
+
+    const double startSeconds = static_cast<double>(start) / inRate;
+    const double endSeconds = static_cast<double>(end) / inRate;
+    const double fadeIn = (std::min)(preview.FadeIn, (endSeconds - startSeconds) / 2);
+    const double fadeOut = (std::min)(preview.FadeOut, (endSeconds - startSeconds) / 2);
+    spdlog::info("Rendering preview {:.2f}-{:.2f} s with a gain of {:.2f} dB", startSeconds, endSeconds, gain);
+
+    RangeDecoder decoder(input);
+    const auto &rctx = decoder.Decoder();
+
+    const AVFilterGraphPtr graph(avfilter_graph_alloc());
+    av::Require(graph.get(), "Failed to allocate filter graph");
+    AVFilterContext *fsrc =
+        BufferSource(graph, rctx->sample_fmt, rctx->sample_rate, rctx->ch_layout, AVRational{1, inRate});
+    AVFilterContext *flast = ApplyGain(graph, fsrc, gain);
+    // afade reads its times from the frame timestamps, which are positions on the offset timeline.
+    if (fadeIn > 0.0) {
+        flast = Filter(graph, flast, "afade", "fade_in", "t=in:st={:.6f}:d={:.6f}", startSeconds, fadeIn);
+    }
+    if (fadeOut > 0.0) {
+        flast = Filter(graph, flast, "afade", "fade_out", "t=out:st={:.6f}:d={:.6f}", endSeconds - fadeOut, fadeOut);
+    }
+    AVFilterContext *fsnk = convertToTarget(graph, flast, target);
+    auto ret = avfilter_graph_config(graph.get(), nullptr);
+    av::Check(ret, "Failed to configure filter graph.");
+    av_buffersink_set_frame_size(fsnk, kWriteFrameSamples);
+
+    const auto writer = output.Open(WavFormat{target.SampleFormat, target.SampleRate, 2},
+                                    av_rescale(end - start, target.SampleRate, inRate));
+    const AVFramePtr in(av_frame_alloc());
+    const AVFramePtr out(av_frame_alloc());
+    av::Require(in.get() && out.get(), "Failed to allocate frames");
+    const auto drain = [&] {
+        while (av_buffersink_get_frame(fsnk, out.get()) == 0) {
+            writer->Write(out.get());
+            av_frame_unref(out.get());
+        }
+    };
+
+    int64_t position = start;
+    decoder.Run(
+        shift, start, end,
+        [&](const AVFrame *frame, const int first, const int count) {
+            addSamples(fsrc, in, frame, first, count, position);
+            position += count;
+            drain();
+        },
+        kPreviewPreRollSeconds * inRate);
+    ret = av_buffersrc_add_frame(fsrc, nullptr);
+    av::Check(ret, "Failed to flush filter graph");
+    drain();
+    writer->Finish();
+}
+
+Audio::PlanResult Audio::Plan(const fs::path &src, const NormalizeOptions &options) {
+    AudioInput input(src);
+    return plan(input, options);
+}
+
+Audio::PlanResult Audio::Plan(const std::span<const uint8_t> src, const NormalizeOptions &options) {
+    AudioInput input(src);
+    return plan(input, options);
 }
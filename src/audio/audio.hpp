@@ -2,12 +2,82 @@
 
 #include "lib.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
 extern "C" {
 #include <libavutil/samplefmt.h>
 }
 
 namespace Audio {
 
+namespace detail {
+class AnalysisStore;
+}
+
+// On-disk cache of loudness measurements, keyed by a hash of the source content and the offset
+// applied before measuring. A hit lets Normalize decide between no-op, gain and loudnorm without
+// decoding for the analysis pass. Safe to share between threads and NormalizeBatch workers.
+class AnalysisCache {
+  public:
+    explicit AnalysisCache(const fs::path &file);
+    ~AnalysisCache();
+
+    AnalysisCache(const AnalysisCache &) = delete;
+    AnalysisCache &operator=(const AnalysisCache &) = delete;
+
+    [[nodiscard]] std::uint64_t Hits() const;
+    [[nodiscard]] std::uint64_t Misses() const;
+
+    [[nodiscard]] detail::AnalysisStore &Store() const {
+        return *m_store;
+    }
+
+  private:
+    std::unique_ptr<detail::AnalysisStore> m_store;
+};
+
+// Layout of the waveform sidecar written by Normalize (NormalizeOptions::Waveform). Little-endian
+// and 8-byte aligned throughout, so an editor can memory-map it and read the tables in place: a
+// WaveformHeader, LevelCount WaveformLevel entries, then the tables they point to.
+struct WaveformHeader {
+    char Magic[8]; // "MUAWAVE\0"
+    std::uint32_t Version;
+    std::uint32_t SampleRate;
+    std::uint32_t Channels;
+    std::uint32_t LevelCount;
+    std::uint64_t Frames; // samples per channel in the output
+    std::uint32_t LoudnessIntervalMs;
+    std::uint32_t Reserved;
+    // LoudnessCount floats: momentary (400 ms) loudness in LUFS ending at each interval.
+    std::uint64_t LoudnessOffset;
+    std::uint64_t LoudnessCount;
+};
+
+// One zoom level: for each bucket of SamplesPerBucket samples, an int16 {min, max} pair per
+// channel, channels interleaved. The last bucket may be partial.
+struct WaveformLevel {
+    std::uint32_t SamplesPerBucket;
+    std::uint32_t Reserved;
+    std::uint64_t Offset;
+    std::uint64_t Buckets;
+};
+
+inline constexpr std::uint32_t kWaveformVersion = 1;
+
+// Sample rate converter settings, used wherever the output rate differs from the source's, and
+// always after loudnorm, which works at 192 kHz. All are swresample's windowed-sinc polyphase
+// filter with different lengths, passbands and Kaiser windows.
+enum class ResampleQuality {
+    Fast,    // 16 taps, 85% passband: about half the cost, rolls off above ~19 kHz at 48 kHz output
+    Default, // swresample's defaults: 32 taps, 97% passband
+    High,    // 128 taps, 98% passband and a steeper window, for the least aliasing near Nyquist
+};
+
 struct NormalizeOptions {
     double Offset = 0.0;
 
@@ -22,12 +92,209 @@ struct NormalizeOptions {
     double LoudnessRangeTolerance = 0.1; // LU
     double GainTolerance = 0.2;          // dB
     double OffsetTolerance = 0.0001;     // seconds
+
+    ResampleQuality Resampler = ResampleQuality::Default;
+
+    // Keep the first pass's decoded PCM and replay it for the second pass instead of decoding the
+    // source twice. PCM beyond DecodedAudioMemoryLimit spills to a memory-mapped temporary file.
+    bool ReuseDecodedAudio = true;
+    std::size_t DecodedAudioMemoryLimit = std::size_t{256} << 20; // bytes
+
+    // Run decode, filtering and encode on separate threads. Lowers the latency of a single file;
+    // leave off when many files are normalized in parallel anyway. Output is identical either way.
+    bool Pipelined = false;
+
+    // Measure inputs longer than a minute in up to this many time ranges on parallel threads, each
+    // with its own demuxer and decoder; 0 uses one per hardware thread, 1 measures serially. Only
+    // codecs that seek sample-exactly (PCM, FLAC) are split, and the result matches a serial pass.
+    // A split analysis keeps no decoded PCM, so the second pass decodes the source again.
+    unsigned AnalysisThreads = 1;
+
+    // Render the second pass of such inputs in up to this many time ranges on parallel threads,
+    // each written straight to its place in the output; 0 uses one per hardware thread, 1 renders
+    // serially. Only applies when the correction is a linear gain (or none), since loudnorm's
+    // dynamic gain depends on everything before it; the output matches a serial pass.
+    unsigned RenderThreads = 1;
+
+    // Optional loudness measurement cache; not owned.
+    AnalysisCache *Cache = nullptr;
+
+    // When set, also writes a waveform sidecar (see WaveformHeader) for the output to this path,
+    // built from the output samples as they are written. Outputs with a sidecar are always
+    // rendered serially through the filter graph, never spliced or split into segments.
+    fs::path Waveform;
+
+    bool operator==(const NormalizeOptions &) const = default;
 };
 
 void Initialize();
 
-void EnsureValid(const fs::path &path);
+enum class ValidateMode {
+    Fast,     // trusts the container header: format taken from the extension, probing capped at ProbeSize
+    Standard, // opens the input as Normalize does
+    Deep,     // also decodes every packet of the audio stream, so corrupt data is caught too
+};
+
+struct ValidateOptions {
+    ValidateMode Mode = ValidateMode::Standard;
+    // Bytes Fast mode may read to find the streams when the header does not describe them.
+    std::int64_t ProbeSize = std::int64_t{64} << 10;
+};
+
+// Throws when the input has no audio stream FFmpeg can open.
+void EnsureValid(const fs::path &path, const ValidateOptions &options = {});
+void EnsureValid(std::span<const uint8_t> bytes, const ValidateOptions &options = {});
+
+struct ValidateResult {
+    bool Valid = false;
+    std::string Error;
+};
+
+// Runs EnsureValid for every path on `threads` workers (0: one per hardware thread). Results are in
+// path order; a failure is reported in its result and does not stop the others.
+std::vector<ValidateResult> EnsureValidBatch(std::span<const fs::path> paths, const ValidateOptions &options = {},
+                                             unsigned threads = 0);
+
+// Wall and CPU time of one stage. CPU time is the whole process's, so it includes helper threads
+// (pipelined and segmented passes) but also any other work running at the same time.
+struct StageTiming {
+    double WallSeconds = 0.0;
+    double CpuSeconds = 0.0;
+};
+
+// Where the time of one Normalize call went, and what it decided. Stages that did not run stay
+// zero.
+struct NormalizeStats {
+    StageTiming Open;     // open, probe and decoder setup
+    StageTiming Analysis; // first pass, including the cache lookup
+    StageTiming Seek;     // rewind for a second decode
+    StageTiming Render;   // second pass: decode or replay, filters and writing
+    StageTiming Total;
+
+    // Split of the filter graph pass when it is not pipelined: demux and decode, writing (WAV,
+    // waveform sidecar and, for a fan-out, each output's conversion), and the rest, which is the
+    // shared filter graph. Zero on the other routes.
+    double DecodeSeconds = 0.0;
+    double FilterSeconds = 0.0;
+    double WriteSeconds = 0.0;
+
+    std::uint64_t BytesRead = 0;    // through the main demuxer; segmented passes read on their own
+    std::uint64_t BytesWritten = 0; // every output, headers included
+    std::uint64_t InputFrames = 0;  // source samples per channel
+    double InputSeconds = 0.0;
+    double RealtimeFactor = 0.0; // InputSeconds per second of Total wall time
+
+    std::string Codec; // source codec
+    bool CacheHit = false;
+
+    // The plan: what the source needed, and how the output was produced: "unchanged", "splice",
+    // "segmented", "graph" or "fan-out".
+    bool NeedTransform = false;
+    bool NeedFormat = false;
+    bool NeedChannels = false;
+    bool NeedLoudNorm = false;
+    bool NeedOffset = false;
+    bool LinearGain = false;
+    double GainDb = 0.0; // when LinearGain
+    std::string Route;
+};
+
+struct NormalizeJob {
+    fs::path Src;
+    fs::path Dst;
+    NormalizeOptions Options;
+};
+
+enum class NormalizeStatus {
+    Normalized, // dst was written
+    Unchanged,  // src already meets the target; dst was not written
+    Failed,
+};
+
+struct NormalizeResult {
+    NormalizeStatus Status = NormalizeStatus::Failed;
+    std::string Error;
+};
+
+// Returns false, writing nothing, when the source already meets the target. `stats`, when given,
+// is filled in with the stage timings and decisions of the call.
+bool Normalize(const fs::path &src, const fs::path &dst, const NormalizeOptions &options,
+               NormalizeStats *stats = nullptr);
+
+// In-memory variant: reads the source from `src` and, unless the source is already normalized,
+// replaces the contents of `dst` with the WAV output. No temporary files are involved.
+bool Normalize(std::span<const uint8_t> src, std::vector<uint8_t> &dst, const NormalizeOptions &options,
+               NormalizeStats *stats = nullptr);
+
+// One output of NormalizeFanOut. Only Options.SampleFormat, Options.SampleRate, Options.Resampler
+// and Options.Waveform may differ between the outputs of one call.
+struct NormalizeOutput {
+    fs::path Dst;
+    NormalizeOptions Options;
+};
+
+// Normalizes `src` into several formats at once, e.g. a 48 kHz game asset and a 44.1 kHz preview:
+// loudness is measured once, the source is decoded once, and the corrected stream fans out to one
+// format conversion and writer per output. Returns each output's status (Normalized or Unchanged)
+// in order; throws when the outputs' shared options differ.
+std::vector<NormalizeStatus> NormalizeFanOut(const fs::path &src, std::span<const NormalizeOutput> outputs,
+                                             NormalizeStats *stats = nullptr);
+
+// Which part of the source NormalizePreview renders. Times are on the offset timeline, i.e. in the
+// output of a full Normalize with the same options.
+struct PreviewOptions {
+    double Start = 0.0;     // seconds
+    double Duration = 30.0; // seconds; the excerpt ends early when the source does
+    double FadeIn = 0.5;    // seconds
+    double FadeOut = 2.0;   // seconds
+};
+
+// Writes a normalized excerpt of `src` to `dst` without rendering the rest. The gain comes from the
+// whole input's loudness, taken from Options.Cache when it has it and measured otherwise; then only
+// the excerpt and a second of pre-roll are decoded. The excerpt gets the constant gain Normalize
+// would apply, or where Normalize would need loudnorm's dynamic mode, the largest constant gain
+// towards the target that keeps the true peak within it. Options.Waveform is ignored.
+void NormalizePreview(const fs::path &src, const fs::path &dst, const NormalizeOptions &options,
+                      const PreviewOptions &preview);
+
+// What Normalize would do with a source, and the measurements it would decide on.
+struct PlanResult {
+    std::string Codec;
+    std::string SampleFormat;
+    int SampleRate = 0;
+    int Channels = 0;
+    double DurationSeconds = 0.0; // 0 when the container does not say
+
+    // Whole-input loudness, on the offset timeline.
+    double Loudness = 0.0;      // LUFS
+    double TruePeak = 0.0;      // dBTP
+    double LoudnessRange = 0.0; // LU
+    double Threshold = 0.0;     // LUFS
+    bool CacheHit = false;
+
+    bool NeedTransform = false; // codec differs from the target's
+    bool NeedFormat = false;    // sample format or rate differs
+    bool NeedChannels = false;  // not stereo
+    bool NeedLoudNorm = false;
+    bool NeedOffset = false;
+    bool LinearGain = false; // the loudness correction is a constant gain rather than loudnorm
+    double GainDb = 0.0;     // when LinearGain
+
+    // Normalize would return false and write nothing.
+    [[nodiscard]] bool Noop() const {
+        return !NeedTransform && !NeedFormat && !NeedChannels && !NeedLoudNorm && !NeedOffset;
+    }
+};
+
+// Runs Normalize's analysis, through Options.Cache when set, and returns its decision without
+// writing anything. Cheap after a cache hit, which leaves only opening the source.
+PlanResult Plan(const fs::path &src, const NormalizeOptions &options);
+PlanResult Plan(std::span<const uint8_t> src, const NormalizeOptions &options);
 
-bool Normalize(const fs::path &src, const fs::path &dst, const NormalizeOptions &options);
+// Runs Normalize for every job on `threads` workers (0: one per hardware thread). Each worker keeps
+// its graph scratch packet and frames, its frame pool and its decoded-PCM buffer between jobs;
+// filter graphs and WAV writers are built per job. A failing job is reported in its result and
+// does not stop the others; results are in job order.
+std::vector<NormalizeResult> NormalizeBatch(std::span<const NormalizeJob> jobs, unsigned threads = 0);
 
 } // namespace Audio
@@ -0,0 +1,290 @@
+// src/audio/detail/analysis_cache.cpp
+#include "audio/detail/analysis_cache.hpp"
+
+#include "audio/audio.hpp"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace Audio::detail {
+
+namespace {
+
+// Bump whenever the meter, the record layout or what goes into the key changes so stale
+// measurements are ignored.
+constexpr uint32_t kCacheVersion = 3;
+constexpr std::array<char, 8> kMagic = {'M', 'U', 'A', 'L', 'O', 'U', 'D', '\0'};
+
+struct FileHeader {
+    std::array<char, 8> Magic;
+    uint32_t Version;
+    uint32_t RecordSize;
+};
+
+struct Record {
+    uint64_t ContentHash;
+    uint64_t ContentSize;
+    uint64_t Params;
+    int32_t StreamIndex;
+    int32_t MediaType;
+    int32_t CodecId;
+    int32_t SampleFormat;
+    int32_t SampleRate;
+    int32_t Channels;
+    double Loudness;
+    double TruePeak;
+    double InputI;
+    double InputTP;
+    double InputLRA;
+    double InputThresh;
+    double TargetOffset;
+};
+static_assert(std::is_trivially_copyable_v<Record> && std::is_trivially_copyable_v<FileHeader>);
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+uint64_t Load64(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t Load32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t Round(uint64_t acc, const uint64_t input) {
+    acc += input * kPrime2;
+    return std::rotl(acc, 31) * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t acc, const uint64_t val) {
+    acc ^= Round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+// Streaming XXH64 (seed 0). Update must be fed multiples of 32 bytes except for the final call.
+class Xxh64 {
+  public:
+    void Update(const uint8_t *data, const size_t size) {
+        const uint8_t *p = data;
+        const uint8_t *const end = data + size - size % 32;
+        for (; p < end; p += 32) {
+            m_v[0] = Round(m_v[0], Load64(p));
+            m_v[1] = Round(m_v[1], Load64(p + 8));
+            m_v[2] = Round(m_v[2], Load64(p + 16));
+            m_v[3] = Round(m_v[3], Load64(p + 24));
+        }
+        m_total += size - size % 32;
+        m_tail.assign(p, data + size);
+    }
+
+    uint64_t Digest() const {
+        const uint64_t total = m_total + m_tail.size();
+        uint64_t h;
+        if (m_total >= 32) {
+            h = std::rotl(m_v[0], 1) + std::rotl(m_v[1], 7) + std::rotl(m_v[2], 12) + std::rotl(m_v[3], 18);
+            for (const uint64_t v : m_v) {
+                h = MergeRound(h, v);
+            }
+        } else {
+            h = kPrime5;
+        }
+        h += total;
+
+        const uint8_t *p = m_tail.data();
+        const uint8_t *const end = p + m_tail.size();
+        for (; p + 8 <= end; p += 8) {
+            h ^= Round(0, Load64(p));
+            h = std::rotl(h, 27) * kPrime1 + kPrime4;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<uint64_t>(Load32(p)) * kPrime1;
+            h = std::rotl(h, 23) * kPrime2 + kPrime3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= *p * kPrime5;
+            h = std::rotl(h, 11) * kPrime1;
+        }
+
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+  private:
+    std::array<uint64_t, 4> m_v{kPrime1 + kPrime2, kPrime2, 0, 0ull - kPrime1};
+    uint64_t m_total = 0;
+    std::vector<uint8_t> m_tail;
+};
+
+Record ToRecord(const AnalysisKey &key, const AudioAnalysis &analysis) {
+    const auto &meta = analysis.Meta;
+    const auto &stats = analysis.LoudNorm;
+    return {key.ContentHash,  key.ContentSize,  key.Params,          meta.StreamIndex, meta.MediaType,
+            meta.CodecId,     meta.SampleFormat, meta.SampleRate,    meta.Channels,    meta.Loudness,
+            meta.TruePeak,    stats.InputI,      stats.InputTP,      stats.InputLRA,   stats.InputThresh,
+            stats.TargetOffset};
+}
+
+AudioAnalysis FromRecord(const Record &record) {
+    AudioAnalysis analysis{};
+    analysis.Meta.StreamIndex = record.StreamIndex;
+    analysis.Meta.MediaType = static_cast<AVMediaType>(record.MediaType);
+    analysis.Meta.CodecId = static_cast<AVCodecID>(record.CodecId);
+    analysis.Meta.SampleFormat = static_cast<AVSampleFormat>(record.SampleFormat);
+    analysis.Meta.SampleRate = record.SampleRate;
+    analysis.Meta.Channels = record.Channels;
+    analysis.Meta.Loudness = record.Loudness;
+    analysis.Meta.TruePeak = record.TruePeak;
+    analysis.LoudNorm = {record.InputI, record.InputTP, record.InputLRA, record.InputThresh, record.TargetOffset};
+    return analysis;
+}
+
+uint64_t MakeParams(const double offset, const TargetFormat &target) {
+    // Only the offset ApplyOffset would actually apply changes what is measured. The loudnorm
+    // target offset also depends on the target loudness, and the tolerances decide whether the
+    // plan needs loudnorm's dynamic mode and so whether that offset is measured at all.
+    const double applied = std::abs(offset) < target.OffsetTolerance ? 0.0 : offset;
+    const std::array<double, 7> params = {
+        applied,
+        target.Loudness,
+        target.LoudnessRange,
+        target.TruePeak,
+        target.GainTolerance,
+        target.TruePeakTolerance,
+        target.LoudnessRangeTolerance,
+    };
+    Xxh64 hash;
+    hash.Update(reinterpret_cast<const uint8_t *>(params.data()), sizeof(params));
+    return hash.Digest() ^ (static_cast<uint64_t>(kCacheVersion) << 56);
+}
+
+} // namespace
+
+AnalysisKey MakeAnalysisKey(const fs::path &src, const double offset, const TargetFormat &target) {
+    std::ifstream in(src, std::ios::binary);
+    if (!in) {
+        throw lib::FileError(src, "Failed to open input for hashing");
+    }
+
+    constexpr size_t kChunk = size_t{1} << 20;
+    std::vector<uint8_t> buffer(kChunk);
+    Xxh64 hash;
+    AnalysisKey key{};
+    for (;;) {
+        in.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        const auto got = static_cast<size_t>(in.gcount());
+        hash.Update(buffer.data(), got);
+        key.ContentSize += got;
+        if (got < buffer.size())
+            break;
+    }
+    if (in.bad()) {
+        throw lib::FileError(src, "Failed to read input for hashing");
+    }
+    key.ContentHash = hash.Digest();
+    key.Params = MakeParams(offset, target);
+    return key;
+}
+
+AnalysisKey MakeAnalysisKey(const std::span<const uint8_t> src, const double offset, const TargetFormat &target) {
+    Xxh64 hash;
+    hash.Update(src.data(), src.size());
+    return {hash.Digest(), src.size(), MakeParams(offset, target)};
+}
+
+AnalysisStore::AnalysisStore(const fs::path &file) : m_path(file) {
+    const FileHeader expected{kMagic, kCacheVersion, sizeof(Record)};
+    bool valid = false;
+
+    if (std::ifstream in(file, std::ios::binary); in) {
+        FileHeader header{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        valid = in.gcount() == sizeof(header) && header.Magic == kMagic && header.Version == kCacheVersion &&
+                header.RecordSize == sizeof(Record);
+
+        Record record{};
+        uintmax_t complete = sizeof(header);
+        while (valid && in.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+            m_entries[{record.ContentHash, record.ContentSize, record.Params}] = FromRecord(record);
+            complete += sizeof(record);
+        }
+        in.close();
+
+        if (!valid) {
+            spdlog::info("Discarding loudness cache with unknown format: {}", lib::PathToUtf8(file));
+        } else if (fs::file_size(file) != complete) {
+            // Drop a record left half-written by an interrupted run so appends stay aligned.
+            fs::resize_file(file, complete);
+        }
+    }
+
+    const auto mode = std::ios::binary | (valid ? std::ios::app : std::ios::trunc);
+    m_out.open(file, mode);
+    if (!m_out) {
+        throw lib::FileError(file, "Failed to open loudness cache");
+    }
+    if (!valid) {
+        m_out.write(reinterpret_cast<const char *>(&expected), sizeof(expected));
+        m_out.flush();
+    }
+    spdlog::debug("Loaded {} loudness cache entries from {}", m_entries.size(), lib::PathToUtf8(file));
+}
+
+std::optional<AudioAnalysis> AnalysisStore::Lookup(const AnalysisKey &key) {
+    std::lock_guard lock(m_mutex);
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second;
+}
+
+void AnalysisStore::Insert(const AnalysisKey &key, const AudioAnalysis &analysis) {
+    const Record record = ToRecord(key, analysis);
+
+    std::lock_guard lock(m_mutex);
+    m_entries[key] = analysis;
+    m_out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    m_out.flush();
+    if (!m_out) {
+        throw lib::FileError(m_path, "Failed to write loudness cache");
+    }
+}
+
+} // namespace Audio::detail
+
+namespace Audio {
+
+AnalysisCache::AnalysisCache(const fs::path &file) : m_store(std::make_unique<detail::AnalysisStore>(file)) {}
+
+AnalysisCache::~AnalysisCache() = default;
+
+uint64_t AnalysisCache::Hits() const {
+    return m_store->Hits();
+}
+
+uint64_t AnalysisCache::Misses() const {
+    return m_store->Misses();
+}
+
+} // namespace Audio
@@ -0,0 +1,63 @@
+// src/audio/detail/analysis_cache.hpp
+#pragma once
+
+#include "audio/detail/analyze.hpp"
+#include "audio/detail/target_format.hpp"
+#include "lib.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+namespace Audio::detail {
+
+// Identifies one measurement: the source content plus everything that changes what Measure sees.
+struct AnalysisKey {
+    uint64_t ContentHash = 0;
+    uint64_t ContentSize = 0;
+    uint64_t Params = 0; // offset actually applied before measuring, loudness target, cache version
+
+    bool operator==(const AnalysisKey &) const = default;
+};
+
+// Hashes the whole file with XXH64. Reading is far cheaper than decoding, so the key is always
+// derived from the current content and a modified file simply misses.
+AnalysisKey MakeAnalysisKey(const fs::path &src, double offset, const TargetFormat &target);
+AnalysisKey MakeAnalysisKey(std::span<const uint8_t> src, double offset, const TargetFormat &target);
+
+// Backing store of Audio::AnalysisCache: an append-only file of fixed-size records loaded into a
+// hash map on open. Later records for the same key win. Lookup and Insert are thread-safe.
+class AnalysisStore {
+  public:
+    explicit AnalysisStore(const fs::path &file);
+
+    std::optional<AudioAnalysis> Lookup(const AnalysisKey &key);
+    void Insert(const AnalysisKey &key, const AudioAnalysis &analysis);
+
+    [[nodiscard]] uint64_t Hits() const {
+        return m_hits.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t Misses() const {
+        return m_misses.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct KeyHash {
+        size_t operator()(const AnalysisKey &key) const {
+            return static_cast<size_t>(key.ContentHash ^ (key.Params * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    fs::path m_path;
+    std::mutex m_mutex;
+    std::ofstream m_out;
+    std::unordered_map<AnalysisKey, AudioAnalysis, KeyHash> m_entries;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+} // namespace Audio::detail
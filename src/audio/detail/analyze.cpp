@@ -6,24 +6,35 @@ extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
 #include <libavformat/avformat.h>
+#include <libavutil/mathematics.h>
 #include <libavutil/opt.h>
 }
 
 #include "audio/detail/error.hpp"
 #include "audio/detail/filter.hpp"
 #include "audio/detail/format.hpp"
+#include "audio/detail/meter.hpp"
 #include "audio/detail/pipeline.hpp"
+#include "audio/detail/range_decoder.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
 
 namespace Audio::detail {
 
-AudioStreamMeta Analyze(const fs::path &path) {
-    const auto ifmt = OpenAVFormatInput(path);
-    const auto ist = GetBestAudioStream(ifmt);
-    const auto dctx = OpenDecoder(ist);
-    return Analyze(ifmt, ist, dctx);
-}
+namespace {
 
-AudioStreamMeta Analyze(const AVFormatInputContextPtr &ifmt, const AVStream *ist, const AVCodecContextPtr &dctx) {
+// Pre-roll fed ahead of each segment so that the K-weighting filters and the true-peak history
+// have settled to their serial state by the time the segment starts.
+constexpr int64_t kPreRollSubBlocks = 10;
+
+AudioStreamMeta DescribeStream(const AVStream *ist, const AVCodecContextPtr &dctx) {
     AudioStreamMeta meta{};
     meta.StreamIndex = ist->index;
     meta.MediaType = dctx->codec_type;
@@ -31,6 +42,96 @@ AudioStreamMeta Analyze(const AVFormatInputContextPtr &ifmt, const AVStream *ist
     meta.SampleFormat = dctx->sample_fmt;
     meta.SampleRate = dctx->sample_rate;
     meta.Channels = dctx->ch_layout.nb_channels;
+    return meta;
+}
+
+AudioAnalysis Summarize(const AudioStreamMeta &meta, const LoudnessMeter &meter) {
+    AudioAnalysis analysis{};
+    analysis.Meta = meta;
+    analysis.Meta.Loudness = meter.Integrated();
+    analysis.Meta.TruePeak = meter.TruePeak();
+
+    // TargetOffset needs a pass through loudnorm itself; see MeasureTargetOffset.
+    analysis.LoudNorm.InputI = analysis.Meta.Loudness;
+    analysis.LoudNorm.InputTP = analysis.Meta.TruePeak;
+    analysis.LoudNorm.InputLRA = meter.Range();
+    analysis.LoudNorm.InputThresh = meter.RelativeThreshold();
+
+    spdlog::info("Loudness analysis: I={:.2f} TP={:.2f} LRA={:.2f} threshold={:.2f}", analysis.LoudNorm.InputI,
+                 analysis.LoudNorm.InputTP, analysis.LoudNorm.InputLRA, analysis.LoudNorm.InputThresh);
+    return analysis;
+}
+
+LoudnessMeter SinkMeter(const AVFilterContext *fsnk, const bool truePeak = true) {
+    AVChannelLayout layout{};
+    const auto ret = av_buffersink_get_ch_layout(fsnk, &layout);
+    av::Check(ret, "Failed to get channel layout from buffer sink");
+    LoudnessMeter meter(av_buffersink_get_sample_rate(fsnk), layout, truePeak);
+    av_channel_layout_uninit(&layout);
+    return meter;
+}
+
+// Appends loudnorm's first pass and a sink to `from`, configures the graph, and returns the sink.
+AVFilterContext *FinishTargetOffsetGraph(const AVFilterGraphPtr &graph, AVFilterContext *from,
+                                         const TargetFormat &target) {
+    from = ApplyLoudNormFirstPass(graph, from, target);
+    AVFilterContext *fsnk = Filter(graph, from, "abuffersink", "target_offset_out");
+    const auto ret = avfilter_graph_config(graph.get(), nullptr);
+    av::Check(ret, "Failed to configure filter graph for the loudnorm target offset");
+    return fsnk;
+}
+
+double TargetOffsetFrom(const LoudnessMeter &meter, const TargetFormat &target) {
+    // loudnorm accepts offsets within +-99 LU.
+    const double loudness = meter.Integrated();
+    const double offset = loudness > -70.0 ? std::clamp(target.Loudness - loudness, -99.0, 99.0) : 0.0;
+    spdlog::info("Loudnorm target offset: {:.2f}", offset);
+    return offset;
+}
+
+// Meters samples [from, to) of the offset timeline, where the source starts at `shift`. Samples
+// before `start` only prime the meter; its measurements begin there.
+LoudnessMeter MeterRange(const AudioInput &src, const int64_t shift, const int64_t from, const int64_t start,
+                         const int64_t to) {
+    RangeDecoder decoder(src);
+    const auto &dctx = decoder.Decoder();
+
+    LoudnessMeter meter(dctx->sample_rate, dctx->ch_layout);
+    int64_t position = from;
+    bool started = from == start;
+    decoder.Run(shift, from, to, [&](const AVFrame *frame, int first, int count) {
+        while (count > 0) {
+            const int take = started ? count : static_cast<int>((std::min)(int64_t{count}, start - position));
+            meter.Add(frame, first, take);
+            first += take;
+            count -= take;
+            position += take;
+            if (!started && position == start) {
+                meter.StartSegment();
+                started = true;
+            }
+        }
+    });
+    return meter;
+}
+
+} // namespace
+
+AudioStreamMeta Analyze(const fs::path &path) {
+    const auto ifmt = OpenAVFormatInput(path);
+    const auto ist = GetBestAudioStream(ifmt);
+    const auto dctx = OpenDecoder(ist);
+    return Analyze(ifmt, ist, dctx);
+}
+
+AudioStreamMeta Analyze(const AVFormatInputContextPtr &ifmt, const AVStream *ist, const AVCodecContextPtr &dctx) {
+    const NormalizeOptions defaults;
+    return Measure(ifmt, ist, dctx, 0.0, MakeTargetFormat(defaults)).Meta;
+}
+
+AudioStreamMeta AnalyzeEbur128(const AVFormatInputContextPtr &ifmt, const AVStream *ist,
+                               const AVCodecContextPtr &dctx) {
+    auto meta = DescribeStream(ist, dctx);
 
     const AVFilterGraphPtr graph(avfilter_graph_alloc());
     av::Require(graph.get(), "Failed to allocate filter graph");
@@ -53,4 +154,170 @@ AudioStreamMeta Analyze(const AVFormatInputContextPtr &ifmt, const AVStream *ist
     return meta;
 }
 
+AudioAnalysis Measure(const fs::path &path) {
+    const auto ifmt = OpenAVFormatInput(path);
+    const auto ist = GetBestAudioStream(ifmt);
+    const auto dctx = OpenDecoder(ist);
+    const NormalizeOptions defaults;
+    return Measure(ifmt, ist, dctx, 0.0, MakeTargetFormat(defaults));
+}
+
+AudioAnalysis Measure(const AVFormatInputContextPtr &ifmt, const AVStream *ist, const AVCodecContextPtr &dctx,
+                      const double offset, const TargetFormat &target, PcmBuffer *capture, const bool pipelined,
+                      const bool targetOffset) {
+    const AVFilterGraphPtr graph(avfilter_graph_alloc());
+    av::Require(graph.get(), "Failed to allocate filter graph");
+
+    AVFilterContext *fsrc = BufferSource(graph, dctx);
+    AVFilterContext *flast = ApplyOffset(graph, dctx, fsrc, offset, target);
+    flast = Filter(graph, flast, "aformat", "aformat", "sample_fmts={}",
+                   av_get_sample_fmt_name(av_get_packed_sample_fmt(dctx->sample_fmt)));
+    AVFilterContext *fsnk = Filter(graph, flast, "abuffersink", "measure_out");
+
+    auto ret = avfilter_graph_config(graph.get(), nullptr);
+    av::Check(ret, "Failed to configure filter graph for audio analysis");
+
+    if (capture) {
+        capture->Configure(fsnk);
+    }
+
+    LoudnessMeter meter = SinkMeter(fsnk);
+
+    // loudnorm's first pass gets a graph of its own fed with the measured frames, so it shares the
+    // decode rather than costing another.
+    AVFilterGraphPtr offsetGraph;
+    AVFilterContext *offsetSrc = nullptr;
+    AVFilterContext *offsetSink = nullptr;
+    std::optional<LoudnessMeter> offsetMeter;
+    AVFramePtr offsetFrame;
+    if (targetOffset) {
+        offsetGraph.reset(avfilter_graph_alloc());
+        av::Require(offsetGraph.get(), "Failed to allocate filter graph");
+        offsetSrc = BufferSource(offsetGraph, fsnk);
+        offsetSink = FinishTargetOffsetGraph(offsetGraph, offsetSrc, target);
+        offsetMeter.emplace(SinkMeter(offsetSink, false));
+        offsetFrame.reset(av_frame_alloc());
+        av::Require(offsetFrame.get(), "Failed to allocate frame");
+    }
+    const auto drainOffset = [&] {
+        while (av_buffersink_get_frame(offsetSink, offsetFrame.get()) == 0) {
+            offsetMeter->Add(offsetFrame.get());
+            av_frame_unref(offsetFrame.get());
+        }
+    };
+
+    const auto onFrame = [&](AVFrame *f) {
+        meter.Add(f);
+        if (capture) {
+            capture->Append(f);
+        }
+        if (targetOffset) {
+            const auto r = av_buffersrc_write_frame(offsetSrc, f);
+            av::Check(r, "Failed to add frame to buffer source: {}", offsetSrc->filter->name);
+            drainOffset();
+        }
+    };
+    if (pipelined) {
+        RunGraphPipelined(ifmt, ist, dctx, fsrc, fsnk, onFrame);
+    } else {
+        RunGraph(ifmt, ist, dctx, fsrc, fsnk, onFrame);
+    }
+
+    if (capture) {
+        capture->Finish();
+    }
+
+    auto analysis = Summarize(DescribeStream(ist, dctx), meter);
+    if (targetOffset) {
+        ret = av_buffersrc_add_frame(offsetSrc, nullptr);
+        av::Check(ret, "Failed to add end-of-stream frame to buffer source: {}", offsetSrc->filter->name);
+        drainOffset();
+        analysis.LoudNorm.TargetOffset = TargetOffsetFrom(*offsetMeter, target);
+    }
+    return analysis;
+}
+
+double MeasureTargetOffset(const AudioInput &src, const double offset, const TargetFormat &target) {
+    // A demuxer of its own, so the caller's stays where it is.
+    std::optional<AudioInput> input;
+    if (src.InMemory()) {
+        input.emplace(src.Bytes());
+    } else {
+        input.emplace(src.Name());
+    }
+    const auto ifmt = input->Open();
+    const auto ist = GetBestAudioStream(ifmt);
+    const auto dctx = OpenDecoder(ist);
+
+    const AVFilterGraphPtr graph(avfilter_graph_alloc());
+    av::Require(graph.get(), "Failed to allocate filter graph");
+    AVFilterContext *fsrc = BufferSource(graph, dctx);
+    AVFilterContext *fsnk = FinishTargetOffsetGraph(graph, ApplyOffset(graph, dctx, fsrc, offset, target), target);
+
+    LoudnessMeter meter = SinkMeter(fsnk, false);
+    RunGraph(ifmt, ist, dctx, fsrc, fsnk, [&](AVFrame *f) { meter.Add(f); });
+    return TargetOffsetFrom(meter, target);
+}
+
+double MeasureTargetOffset(const PcmBuffer &decoded, const TargetFormat &target) {
+    const AVFilterGraphPtr graph(avfilter_graph_alloc());
+    av::Require(graph.get(), "Failed to allocate filter graph");
+    AVFilterContext *fsrc = BufferSource(graph, decoded.Format(), decoded.SampleRate(), decoded.Layout(),
+                                         AVRational{1, decoded.SampleRate()});
+    AVFilterContext *fsnk = FinishTargetOffsetGraph(graph, fsrc, target);
+
+    LoudnessMeter meter = SinkMeter(fsnk, false);
+    RunGraph(decoded, fsrc, fsnk, [&](AVFrame *f) { meter.Add(f); });
+    return TargetOffsetFrom(meter, target);
+}
+
+std::optional<AudioAnalysis> MeasureSegmented(const AudioInput &src, const AVFormatInputContextPtr &ifmt,
+                                              const AVStream *ist, const AVCodecContextPtr &dctx, const double offset,
+                                              const TargetFormat &target, const unsigned threads) {
+    if (!HasExactSeek(dctx->codec_id))
+        return std::nullopt;
+
+    const int rate = dctx->sample_rate;
+    const int64_t shift = OffsetSamples(offset, rate, target);
+    const int64_t total = StreamDurationSamples(ifmt, ist, rate) + shift;
+    const int64_t segments = RangeCount(total, rate, threads);
+    if (segments < 2)
+        return std::nullopt;
+
+    // Only the last segment runs to the end of the stream, so an inexact duration costs balance,
+    // not accuracy.
+    const int64_t subBlock = LoudnessMeter::SubBlockSamples(rate);
+    const int64_t length = total / segments / subBlock * subBlock;
+    const int64_t preRoll = kPreRollSubBlocks * subBlock;
+    spdlog::info("Measuring loudness in {} segments of {:.1f} s", segments, static_cast<double>(length) / rate);
+
+    std::vector<std::optional<LoudnessMeter>> meters(static_cast<size_t>(segments));
+    std::vector<std::exception_ptr> errors(static_cast<size_t>(segments));
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(static_cast<size_t>(segments));
+        for (int64_t k = 0; k < segments; ++k) {
+            const int64_t start = k * length;
+            const int64_t end = k + 1 == segments ? (std::numeric_limits<int64_t>::max)() : start + length;
+            workers.emplace_back([&, k, start, end] {
+                try {
+                    meters[k].emplace(MeterRange(src, shift, (std::max)(int64_t{0}, start - preRoll), start, end));
+                } catch (...) {
+                    errors[k] = std::current_exception();
+                }
+            });
+        }
+    }
+    for (const auto &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    LoudnessMeter &merged = *meters.front();
+    for (size_t k = 1; k < meters.size(); ++k) {
+        merged.Append(*meters[k]);
+    }
+    return Summarize(DescribeStream(ist, dctx), merged);
+}
+
 } // namespace Audio::detail
@@ -6,9 +6,15 @@ extern "C" {
 #include <libavutil/samplefmt.h>
 }
 
+#include "audio/detail/io.hpp"
+#include "audio/detail/loudnorm.hpp"
+#include "audio/detail/pcm_buffer.hpp"
 #include "audio/detail/raii.hpp"
+#include "audio/detail/target_format.hpp"
 #include "lib.hpp"
 
+#include <optional>
+
 namespace Audio::detail {
 
 struct AudioStreamMeta {
@@ -22,8 +28,50 @@ struct AudioStreamMeta {
     double TruePeak = 0.0;
 };
 
+struct AudioAnalysis {
+    AudioStreamMeta Meta;
+    LoudNormStats LoudNorm;
+};
+
 AudioStreamMeta Analyze(const fs::path &path);
 
 AudioStreamMeta Analyze(const AVFormatInputContextPtr &ifmt, const AVStream *ist, const AVCodecContextPtr &dctx);
 
+// Same measurements as Analyze, taken with FFmpeg's ebur128 filter. Kept as a reference for the
+// native meter.
+AudioStreamMeta AnalyzeEbur128(const AVFormatInputContextPtr &ifmt, const AVStream *ist,
+                               const AVCodecContextPtr &dctx);
+
+AudioAnalysis Measure(const fs::path &path);
+
+// Decodes the input once, applies `offset`, and measures it with the native loudness meter. The
+// result carries both the stream metadata and the loudnorm first-pass statistics. When `capture`
+// is non-null, the measured PCM is kept in it so the second pass can replay it. `pipelined` runs
+// decoding and filtering on their own threads (see RunGraphPipelined). `targetOffset` also runs
+// loudnorm's first pass over the measured frames to fill in LoudNorm.TargetOffset (see
+// MeasureTargetOffset) without decoding again; it costs as much as that pass whether or not the
+// second pass ends up using loudnorm.
+AudioAnalysis Measure(const AVFormatInputContextPtr &ifmt, const AVStream *ist, const AVCodecContextPtr &dctx,
+                      double offset, const TargetFormat &target, PcmBuffer *capture = nullptr,
+                      bool pipelined = false, bool targetOffset = false);
+
+// loudnorm's first pass also reports a `target_offset`: the target loudness minus the loudness of
+// what its dynamic mode makes of the input, which the second pass adds as extra gain. These run
+// that dynamic mode over the offset input, decoded afresh from `src` or replayed from `decoded`,
+// and meter its output natively. A full extra pass, so only worth it when the second pass will
+// use loudnorm and no cheaper route applies. Returns 0 when the output is too quiet to measure.
+double MeasureTargetOffset(const AudioInput &src, double offset, const TargetFormat &target);
+double MeasureTargetOffset(const PcmBuffer &decoded, const TargetFormat &target);
+
+// Same measurements as Measure, taken by splitting the offset input into up to `threads` time
+// ranges (0: one per hardware thread) that are metered in parallel, each on its own demuxer and
+// decoder opened from `src`. Every range after the first is preceded by a second of pre-roll that
+// only primes the filters, and ranges start on 100 ms sub-block boundaries, so the merged blocks
+// are those of a serial pass. `ifmt`, `ist` and `dctx` describe the stream and are not read.
+// Returns nullopt when the codec does not seek exactly (see HasExactSeek) or the input is too
+// short to be worth splitting.
+std::optional<AudioAnalysis> MeasureSegmented(const AudioInput &src, const AVFormatInputContextPtr &ifmt,
+                                              const AVStream *ist, const AVCodecContextPtr &dctx, double offset,
+                                              const TargetFormat &target, unsigned threads);
+
 } // namespace Audio::detail
@@ -2,6 +2,7 @@
 #include "audio/detail/filter.hpp"
 
 extern "C" {
+#include <libavfilter/buffersink.h>
 #include <libavutil/channel_layout.h>
 }
 
@@ -28,17 +29,18 @@ AVFilterContext *Filter(const AVFilterGraphPtr &graph, AVFilterContext *from, co
     return ctx;
 }
 
-AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVCodecContextPtr &codec) {
+AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVSampleFormat format, const int sampleRate,
+                              const AVChannelLayout &layout, const AVRational timeBase) {
     AVFilterContext *src = Filter(graph, "abuffer", "in");
 
     AVBufferSrcParametersPtr par(av_buffersrc_parameters_alloc());
     av::Require(par.get(), "Failed to allocate buffer source parameters");
 
-    par->format = codec->sample_fmt;
-    par->sample_rate = codec->sample_rate;
-    par->time_base = codec->time_base;
+    par->format = format;
+    par->sample_rate = sampleRate;
+    par->time_base = timeBase;
 
-    auto ret = av_channel_layout_copy(&par->ch_layout, &codec->ch_layout);
+    auto ret = av_channel_layout_copy(&par->ch_layout, &layout);
     av::Check(ret, "Failed to copy channel layout to buffer source parameters");
 
     ret = av_buffersrc_parameters_set(src, par.get());
@@ -50,4 +52,25 @@ AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVCodecContex
     return src;
 }
 
+AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVCodecContextPtr &codec) {
+    return BufferSource(graph, codec->sample_fmt, codec->sample_rate, codec->ch_layout, codec->time_base);
+}
+
+AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVFilterContext *sink) {
+    AVChannelLayout layout{};
+    auto ret = av_buffersink_get_ch_layout(sink, &layout);
+    av::Check(ret, "Failed to get channel layout from buffer sink");
+
+    AVFilterContext *src = nullptr;
+    try {
+        src = BufferSource(graph, static_cast<AVSampleFormat>(av_buffersink_get_format(sink)),
+                           av_buffersink_get_sample_rate(sink), layout, av_buffersink_get_time_base(sink));
+    } catch (...) {
+        av_channel_layout_uninit(&layout);
+        throw;
+    }
+    av_channel_layout_uninit(&layout);
+    return src;
+}
+
 } // namespace Audio::detail
@@ -25,6 +25,13 @@ AVFilterContext *Filter(const AVFilterGraphPtr &graph, AVFilterContext *from, co
     return Filter(graph, from, name, instance, opts.c_str());
 }
 
+AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, AVSampleFormat format, int sampleRate,
+                              const AVChannelLayout &layout, AVRational timeBase);
+
 AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVCodecContextPtr &codec);
 
+// Creates a buffer source whose parameters mirror the output of an already configured `sink`,
+// so frames pulled from one graph can be pushed straight into another.
+AVFilterContext *BufferSource(const AVFilterGraphPtr &graph, const AVFilterContext *sink);
+
 } // namespace Audio::detail
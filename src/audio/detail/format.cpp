@@ -2,27 +2,70 @@
 
 extern "C" {
 #include <libavutil/channel_layout.h>
+#include <libavutil/mathematics.h>
 }
 
 #include "audio/detail/error.hpp"
 
+#include <algorithm>
+#include <climits>
+
 namespace Audio::detail {
 
-AVFormatInputContextPtr OpenAVFormatInput(const fs::path &path) {
-    AVFormatContext *raw = nullptr;
-    auto ret = avformat_open_input(&raw, lib::PathToUtf8(path).c_str(), nullptr, nullptr);
-    av::Check(ret, path, "Failed to open input format context");
+namespace {
+
+bool HasDescribedAudioStream(const AVFormatContext *ctx) {
+    if (ctx->ctx_flags & AVFMTCTX_NOHEADER)
+        return false;
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        const AVCodecParameters *par = ctx->streams[i]->codecpar;
+        if (par->codec_type == AVMEDIA_TYPE_AUDIO && par->codec_id != AV_CODEC_ID_NONE)
+            return true;
+    }
+    return false;
+}
+
+// Takes ownership of `raw`, which avformat_open_input frees on failure.
+AVFormatInputContextPtr OpenInput(AVFormatContext *raw, const char *url, const fs::path &name,
+                                  const ProbeSettings &probe) {
+    if (probe.ProbeSize > 0) {
+        raw->probesize = probe.ProbeSize;
+        raw->format_probesize = static_cast<int>((std::min)(probe.ProbeSize, int64_t{INT_MAX}));
+    }
+    auto ret = avformat_open_input(&raw, url, probe.Format, nullptr);
+    av::Check(ret, name, "Failed to open input format context");
     auto ctx = AVFormatInputContextPtr(raw);
+    if (probe.HeaderOnly && HasDescribedAudioStream(ctx.get()))
+        return ctx;
     ret = avformat_find_stream_info(ctx.get(), nullptr);
-    av::Check(ret, path, "Failed to find stream info");
+    av::Check(ret, name, "Failed to find stream info");
     return ctx;
 }
 
-AVFormatOutputContextPtr OpenAVFormatOutput(const fs::path &path) {
-    AVFormatContext *raw = nullptr;
-    const auto ret = avformat_alloc_output_context2(&raw, nullptr, "wav", lib::PathToUtf8(path).c_str());
-    av::Check(ret, path, "Failed to allocate output format context");
-    return AVFormatOutputContextPtr(raw);
+} // namespace
+
+AVFormatInputContextPtr OpenAVFormatInput(const fs::path &path, const ProbeSettings &probe) {
+    AVFormatContext *raw = avformat_alloc_context();
+    av::Require(raw, "Failed to allocate input format context");
+    return OpenInput(raw, lib::PathToUtf8(path).c_str(), path, probe);
+}
+
+AVFormatInputContextPtr OpenAVFormatInput(AVIOContext *pb, const fs::path &name, const ProbeSettings &probe) {
+    AVFormatContext *raw = avformat_alloc_context();
+    av::Require(raw, "Failed to allocate input format context");
+    raw->pb = pb;
+    raw->flags |= AVFMT_FLAG_CUSTOM_IO;
+    return OpenInput(raw, "", name, probe);
+}
+
+const AVInputFormat *FindInputFormatByExtension(const fs::path &path) {
+    const auto name = lib::PathToUtf8(path.filename());
+    void *it = nullptr;
+    while (const AVInputFormat *format = av_demuxer_iterate(&it)) {
+        if (format->extensions && av_match_ext(name.c_str(), format->extensions))
+            return format;
+    }
+    return nullptr;
 }
 
 AVStream *GetBestAudioStream(const AVFormatInputContextPtr &ctx) {
@@ -31,7 +74,7 @@ AVStream *GetBestAudioStream(const AVFormatInputContextPtr &ctx) {
     return ctx->streams[ret];
 }
 
-AVCodecContextPtr OpenDecoder(const AVStream *st) {
+AVCodecContextPtr OpenDecoder(const AVStream *st, const int errorRecognition) {
     const AVCodec *codec = avcodec_find_decoder(st->codecpar->codec_id);
     av::Require(codec, "Failed to find decoder for stream codec");
 
@@ -51,44 +94,55 @@ AVCodecContextPtr OpenDecoder(const AVStream *st) {
         av_channel_layout_default(&ctx->ch_layout, ch);
     }
 
+    ctx->err_recognition |= errorRecognition;
     ret = avcodec_open2(ctx.get(), codec, nullptr);
     av::Check(ret, "Failed to open decoder");
 
     return ctx;
 }
 
-AVCodecContextPtr OpenEncoder(const TargetFormat &params) {
-    auto ectx = AVCodecContextPtr(avcodec_alloc_context3(nullptr));
-    av::Require(ectx.get(), "Failed to allocate encoder context");
-    ectx->codec_type = AVMEDIA_TYPE_AUDIO;
-    ectx->codec_id = params.CodecId;
-    ectx->sample_rate = params.SampleRate;
-    av_channel_layout_default(&ectx->ch_layout, 2);
-    ectx->sample_fmt = params.SampleFormat;
-    ectx->bit_rate = 0;
-    ectx->time_base = AVRational{1, params.SampleRate};
-    const auto ret = avcodec_open2(ectx.get(), avcodec_find_encoder(ectx->codec_id), nullptr);
-    av::Check(ret, "Failed to open encoder");
-    return ectx;
-}
-
-AVStream *OpenOutputStream(const fs::path &path, const AVFormatOutputContextPtr &ofmt, const AVCodecContextPtr &ectx) {
-    AVStream *ost = avformat_new_stream(ofmt.get(), nullptr);
-    av::Require(ost, "Failed to create output stream");
-    ost->time_base = ectx->time_base;
-
-    auto ret = avcodec_parameters_from_context(ost->codecpar, ectx.get());
-    av::Check(ret, "Failed to copy codec parameters to output stream");
-
-    if (!(ofmt->oformat->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&ofmt->pb, lib::PathToUtf8(path).c_str(), AVIO_FLAG_WRITE);
-        av::Check(ret, path, "Failed to open output I/O");
+bool HasExactSeek(const AVCodecID codecId) {
+    // Only plain linear PCM, one sample after another. Packetized variants such as S302M, DVD and
+    // Blu-ray PCM share the PCM id range but their containers seek to packet boundaries.
+    switch (codecId) {
+    case AV_CODEC_ID_PCM_U8:
+    case AV_CODEC_ID_PCM_S8:
+    case AV_CODEC_ID_PCM_S8_PLANAR:
+    case AV_CODEC_ID_PCM_S16LE:
+    case AV_CODEC_ID_PCM_S16BE:
+    case AV_CODEC_ID_PCM_U16LE:
+    case AV_CODEC_ID_PCM_U16BE:
+    case AV_CODEC_ID_PCM_S16LE_PLANAR:
+    case AV_CODEC_ID_PCM_S16BE_PLANAR:
+    case AV_CODEC_ID_PCM_S24LE:
+    case AV_CODEC_ID_PCM_S24BE:
+    case AV_CODEC_ID_PCM_U24LE:
+    case AV_CODEC_ID_PCM_U24BE:
+    case AV_CODEC_ID_PCM_S24LE_PLANAR:
+    case AV_CODEC_ID_PCM_S32LE:
+    case AV_CODEC_ID_PCM_S32BE:
+    case AV_CODEC_ID_PCM_U32LE:
+    case AV_CODEC_ID_PCM_U32BE:
+    case AV_CODEC_ID_PCM_S32LE_PLANAR:
+    case AV_CODEC_ID_PCM_S64LE:
+    case AV_CODEC_ID_PCM_S64BE:
+    case AV_CODEC_ID_PCM_F32LE:
+    case AV_CODEC_ID_PCM_F32BE:
+    case AV_CODEC_ID_PCM_F64LE:
+    case AV_CODEC_ID_PCM_F64BE:
+    case AV_CODEC_ID_FLAC:
+        return true;
+    default:
+        return false;
     }
+}
 
-    ret = avformat_write_header(ofmt.get(), nullptr);
-    av::Check(ret, path, "Failed to write output format header");
-
-    return ost;
+int64_t StreamDurationSamples(const AVFormatInputContextPtr &ctx, const AVStream *st, const int sampleRate) {
+    if (st->duration != AV_NOPTS_VALUE)
+        return av_rescale_q(st->duration, st->time_base, AVRational{1, sampleRate});
+    if (ctx->duration != AV_NOPTS_VALUE)
+        return av_rescale_q(ctx->duration, AVRational{1, AV_TIME_BASE}, AVRational{1, sampleRate});
+    return 0;
 }
 
 } // namespace Audio::detail
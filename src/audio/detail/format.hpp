@@ -6,19 +6,38 @@ extern "C" {
 }
 
 #include "audio/detail/raii.hpp"
-#include "audio/detail/target_format.hpp"
 #include "lib.hpp"
 
 namespace Audio::detail {
 
-AVFormatInputContextPtr OpenAVFormatInput(const fs::path &path);
-AVFormatOutputContextPtr OpenAVFormatOutput(const fs::path &path);
+// How much a demuxer may read while opening; the defaults are FFmpeg's own.
+struct ProbeSettings {
+    const AVInputFormat *Format = nullptr; // skips format probing when set
+    int64_t ProbeSize = 0;                 // bytes read to find the format and streams; 0: FFmpeg's default
+    // Skip avformat_find_stream_info when the header already describes an audio stream, instead of
+    // decoding the first packets to fill in parameters the header left out.
+    bool HeaderOnly = false;
+};
+
+AVFormatInputContextPtr OpenAVFormatInput(const fs::path &path, const ProbeSettings &probe = {});
+// Opens a demuxer reading through `pb`, which stays owned by the caller. `name` is only used for
+// error messages.
+AVFormatInputContextPtr OpenAVFormatInput(AVIOContext *pb, const fs::path &name, const ProbeSettings &probe = {});
+
+// The demuxer registered for the extension of `path`, or nullptr when none matches.
+const AVInputFormat *FindInputFormatByExtension(const fs::path &path);
 
 AVStream *GetBestAudioStream(const AVFormatInputContextPtr &ctx);
 
-AVCodecContextPtr OpenDecoder(const AVStream *st);
-AVCodecContextPtr OpenEncoder(const TargetFormat &params);
+// `errorRecognition` adds AV_EF_* flags to the decoder's error detection.
+AVCodecContextPtr OpenDecoder(const AVStream *st, int errorRecognition = 0);
+
+// Whether streams of `codecId` seek to exact sample positions with exact timestamps, so a file can
+// be split into time ranges decoded independently: plain interleaved or planar PCM, and FLAC.
+bool HasExactSeek(AVCodecID codecId);
 
-AVStream *OpenOutputStream(const fs::path &path, const AVFormatOutputContextPtr &ofmt, const AVCodecContextPtr &ectx);
+// Length of `st` in samples at `sampleRate`, from the stream or else the container duration; 0 when
+// neither is known.
+int64_t StreamDurationSamples(const AVFormatInputContextPtr &ctx, const AVStream *st, int sampleRate);
 
 } // namespace Audio::detail
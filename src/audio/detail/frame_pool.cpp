@@ -0,0 +1,66 @@
+// src/audio/detail/frame_pool.cpp
+#include "audio/detail/frame_pool.hpp"
+
+#include "audio/detail/error.hpp"
+
+#include <atomic>
+
+namespace Audio::detail {
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+AVFramePtr FramePool::AcquireFrame() {
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_frames.empty()) {
+            auto frame = std::move(m_frames.back());
+            m_frames.pop_back();
+            return frame;
+        }
+    }
+    AVFramePtr frame(av_frame_alloc());
+    av::Require(frame.get(), "Failed to allocate frame");
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+void FramePool::Release(AVFramePtr frame) {
+    if (!frame)
+        return;
+    av_frame_unref(frame.get());
+    std::lock_guard lock(m_mutex);
+    m_frames.push_back(std::move(frame));
+}
+
+AVPacketPtr FramePool::AcquirePacket() {
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_packets.empty()) {
+            auto packet = std::move(m_packets.back());
+            m_packets.pop_back();
+            return packet;
+        }
+    }
+    AVPacketPtr packet(av_packet_alloc());
+    av::Require(packet.get(), "Failed to allocate packet");
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return packet;
+}
+
+void FramePool::Release(AVPacketPtr packet) {
+    if (!packet)
+        return;
+    av_packet_unref(packet.get());
+    std::lock_guard lock(m_mutex);
+    m_packets.push_back(std::move(packet));
+}
+
+uint64_t FramePool::Allocations() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace Audio::detail
@@ -0,0 +1,38 @@
+// src/audio/detail/frame_pool.hpp
+#pragma once
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+#include "audio/detail/raii.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Audio::detail {
+
+// Recycles AVFrame and AVPacket shells. Released frames are unreferenced and kept for the next
+// Acquire, so a loop that returns what it takes stops allocating once warmed up. Acquire and
+// Release may be called from different threads.
+class FramePool {
+  public:
+    AVFramePtr AcquireFrame();
+    void Release(AVFramePtr frame);
+
+    AVPacketPtr AcquirePacket();
+    void Release(AVPacketPtr packet);
+
+    // Frames and packets allocated by all pools in the process so far. Lets tests check that a
+    // steady-state loop allocates nothing per frame.
+    static uint64_t Allocations();
+
+  private:
+    std::mutex m_mutex;
+    std::vector<AVFramePtr> m_frames;
+    std::vector<AVPacketPtr> m_packets;
+};
+
+} // namespace Audio::detail
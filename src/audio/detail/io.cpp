@@ -0,0 +1,109 @@
+// src/audio/detail/io.cpp
+#include "audio/detail/io.hpp"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include "audio/detail/error.hpp"
+#include "audio/detail/format.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Audio::detail {
+
+namespace {
+
+constexpr int kAvioBufferSize = 64 * 1024;
+
+int64_t ResolveSeek(const int64_t offset, const int whence, const int64_t position, const int64_t size) {
+    switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET:
+        return offset;
+    case SEEK_CUR:
+        return position + offset;
+    case SEEK_END:
+        return size + offset;
+    default:
+        return AVERROR(EINVAL);
+    }
+}
+
+AVIOContextPtr AllocAvio(void *opaque, int (*read)(void *, uint8_t *, int), int64_t (*seek)(void *, int64_t, int)) {
+    auto *buffer = static_cast<unsigned char *>(av_malloc(kAvioBufferSize));
+    av::Require(buffer, "Failed to allocate I/O buffer");
+    AVIOContext *avio = avio_alloc_context(buffer, kAvioBufferSize, 0, opaque, read, nullptr, seek);
+    if (!avio) {
+        av_free(buffer);
+        av::Require(false, "Failed to allocate I/O context");
+    }
+    return AVIOContextPtr(avio);
+}
+
+} // namespace
+
+struct AudioInput::Reader {
+    std::span<const uint8_t> Bytes;
+    int64_t Position = 0;
+
+    static int Read(void *opaque, uint8_t *buf, const int size) {
+        auto *self = static_cast<Reader *>(opaque);
+        const auto total = static_cast<int64_t>(self->Bytes.size());
+        const auto count = static_cast<int>((std::min)(static_cast<int64_t>(size), total - self->Position));
+        if (count <= 0)
+            return AVERROR_EOF;
+        std::memcpy(buf, self->Bytes.data() + self->Position, static_cast<size_t>(count));
+        self->Position += count;
+        return count;
+    }
+
+    static int64_t Seek(void *opaque, const int64_t offset, const int whence) {
+        auto *self = static_cast<Reader *>(opaque);
+        const auto total = static_cast<int64_t>(self->Bytes.size());
+        if (whence & AVSEEK_SIZE)
+            return total;
+        const int64_t target = ResolveSeek(offset, whence, self->Position, total);
+        if (target < 0 || target > total)
+            return AVERROR(EINVAL);
+        self->Position = target;
+        return target;
+    }
+};
+
+AudioInput::AudioInput(const fs::path &path) : m_path(path) {}
+
+AudioInput::AudioInput(const std::span<const uint8_t> bytes) : m_path("<memory>"), m_bytes(bytes), m_memory(true) {}
+
+AudioInput::~AudioInput() = default;
+
+AVFormatInputContextPtr AudioInput::Open(const ProbeSettings &probe) {
+    if (!m_memory)
+        return OpenAVFormatInput(m_path, probe);
+
+    m_reader = std::make_unique<Reader>(Reader{m_bytes});
+    m_avio = AllocAvio(m_reader.get(), &Reader::Read, &Reader::Seek);
+    return OpenAVFormatInput(m_avio.get(), m_path, probe);
+}
+
+AudioOutput::AudioOutput(const fs::path &path) : m_path(path) {}
+
+AudioOutput::AudioOutput(std::vector<uint8_t> &bytes) : m_path("<memory>"), m_bytes(&bytes) {}
+
+std::unique_ptr<WavWriter> AudioOutput::Open(const WavFormat &format, const int64_t expectedFrames) {
+    if (m_bytes)
+        return std::make_unique<WavWriter>(*m_bytes, format, expectedFrames);
+    return std::make_unique<WavWriter>(m_path, format, expectedFrames);
+}
+
+uint64_t AudioOutput::Size() const {
+    if (m_bytes)
+        return m_bytes->size();
+    std::error_code ec;
+    const auto size = fs::file_size(m_path, ec);
+    return ec ? 0 : static_cast<uint64_t>(size);
+}
+
+} // namespace Audio::detail
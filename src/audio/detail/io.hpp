@@ -0,0 +1,82 @@
+// src/audio/detail/io.hpp
+#pragma once
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+#include "audio/detail/format.hpp"
+#include "audio/detail/raii.hpp"
+#include "audio/detail/wav_writer.hpp"
+#include "lib.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Audio::detail {
+
+// Where a normalize job reads from: a file, or bytes the caller already holds in memory. Memory
+// input is served through a seekable custom AVIOContext, so both passes work without temp files.
+class AudioInput {
+  public:
+    explicit AudioInput(const fs::path &path);
+    explicit AudioInput(std::span<const uint8_t> bytes);
+    ~AudioInput();
+
+    AudioInput(const AudioInput &) = delete;
+    AudioInput &operator=(const AudioInput &) = delete;
+
+    // Opens a demuxer over the input. For memory input the returned context reads through an
+    // AVIOContext owned by this object, which must outlive it; opening again rewinds it.
+    AVFormatInputContextPtr Open(const ProbeSettings &probe = {});
+
+    // The file path, or a placeholder used in error messages for memory input.
+    [[nodiscard]] const fs::path &Name() const {
+        return m_path;
+    }
+    [[nodiscard]] bool InMemory() const {
+        return m_memory;
+    }
+    [[nodiscard]] std::span<const uint8_t> Bytes() const {
+        return m_bytes;
+    }
+
+  private:
+    struct Reader;
+
+    fs::path m_path;
+    std::span<const uint8_t> m_bytes;
+    bool m_memory = false;
+    std::unique_ptr<Reader> m_reader;
+    AVIOContextPtr m_avio;
+};
+
+// Where a normalize job writes to: a file, or a caller-owned byte vector. Either way the samples
+// go through a WavWriter rather than an encoder and muxer.
+class AudioOutput {
+  public:
+    explicit AudioOutput(const fs::path &path);
+    explicit AudioOutput(std::vector<uint8_t> &bytes);
+
+    AudioOutput(const AudioOutput &) = delete;
+    AudioOutput &operator=(const AudioOutput &) = delete;
+
+    // Creates the output and writes a provisional header. `expectedFrames` sizes the
+    // preallocation and may be 0 when the length is unknown.
+    std::unique_ptr<WavWriter> Open(const WavFormat &format, int64_t expectedFrames);
+
+    [[nodiscard]] const fs::path &Name() const {
+        return m_path;
+    }
+
+    // Bytes written so far; 0 when nothing was.
+    [[nodiscard]] uint64_t Size() const;
+
+  private:
+    fs::path m_path;
+    std::vector<uint8_t> *m_bytes = nullptr;
+};
+
+} // namespace Audio::detail
@@ -9,6 +9,9 @@ extern "C" {
 #include <libavformat/avformat.h>
 }
 
+#include <cstdint>
+#include <optional>
+
 namespace Audio::detail {
 
 struct LoudNormStats {
@@ -16,16 +19,31 @@ struct LoudNormStats {
     double InputTP = 0.0;
     double InputLRA = 0.0;
     double InputThresh = 0.0;
+    // Target loudness minus that of loudnorm's first-pass output, added back by its dynamic mode
+    // (see MeasureTargetOffset); 0 when not measured.
     double TargetOffset = 0.0;
 };
 
+// The offset ApplyOffset applies, in samples at `sampleRate`: positive for leading silence,
+// negative for samples cut from the start, 0 when the offset is within tolerance.
+int64_t OffsetSamples(double offset, int sampleRate, const TargetFormat &target);
+
 AVFilterContext *ApplyOffset(const AVFilterGraphPtr &graph, const AVCodecContextPtr &dctx, AVFilterContext *from,
                              double offset, const TargetFormat &target);
 
 AVFilterContext *ApplyLoudNorm(const AVFilterGraphPtr &graph, AVFilterContext *from, const LoudNormStats &stats,
                                const TargetFormat &target);
 
-LoudNormStats AnalyzeLoudNorm(const AVFormatInputContextPtr &ifmt, const AVStream *ist, const AVCodecContextPtr &dctx,
-                              double offset, const TargetFormat &target);
+// loudnorm configured as for its own first pass: nothing measured yet, so it runs in dynamic mode.
+AVFilterContext *ApplyLoudNormFirstPass(const AVFilterGraphPtr &graph, AVFilterContext *from,
+                                        const TargetFormat &target);
+
+// Returns the constant gain that reaches the target loudness when it can stand in for loudnorm, i.e.
+// when loudnorm itself would run in linear mode: the gained true peak stays within the target and
+// the measured range already fits. Returns nullopt when the dynamic mode is needed.
+std::optional<double> LinearGain(const LoudNormStats &stats, const TargetFormat &target);
+
+// Applies a constant gain in dB, computed in double precision.
+AVFilterContext *ApplyGain(const AVFilterGraphPtr &graph, AVFilterContext *from, double gainDb);
 
 } // namespace Audio::detail
@@ -0,0 +1,413 @@
+// src/audio/detail/meter.cpp
+#include "audio/detail/meter.hpp"
+
+extern "C" {
+#include <libavutil/samplefmt.h>
+}
+
+#include "audio/detail/error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+
+namespace Audio::detail {
+
+namespace {
+
+constexpr double kAbsoluteGate = -70.0;    // LUFS
+constexpr double kIntegratedGate = -10.0;  // LU below the absolute-gated loudness
+constexpr double kRangeGate = -20.0;       // LU below the absolute-gated short-term loudness
+constexpr double kMinLevel = -99.0;        // dB reported for digital silence
+constexpr int kMomentarySubBlocks = 4;     // 400 ms
+constexpr int kShortTermSubBlocks = 30;    // 3 s
+constexpr double kRangeBinWidth = 0.1;     // LU
+constexpr double kRangeMax = 5.0;          // LUFS
+constexpr int kRangeBins = static_cast<int>((kRangeMax - kAbsoluteGate) / kRangeBinWidth);
+
+constexpr int kPeakPhases = 4;
+constexpr int kPeakTaps = 12;
+
+// ITU-R BS.1770-4 Annex 2 4x oversampling filter, transposed so the four phases of one tap are
+// adjacent.
+constexpr float kPeakFilter[kPeakTaps][kPeakPhases] = {
+    {0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f},
+    {0.0109863281250f, 0.0292968750000f, 0.0330810546875f, 0.0148925781250f},
+    {-0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f},
+    {0.0332031250000f, 0.0891113281250f, 0.1015625000000f, 0.0476074218750f},
+    {-0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f},
+    {0.1373291015625f, 0.4650878906250f, 0.7797851562500f, 0.9721679687500f},
+    {0.9721679687500f, 0.7797851562500f, 0.4650878906250f, 0.1373291015625f},
+    {-0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f},
+    {0.0476074218750f, 0.1015625000000f, 0.0891113281250f, 0.0332031250000f},
+    {-0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f},
+    {0.0148925781250f, 0.0330810546875f, 0.0292968750000f, 0.0109863281250f},
+    {-0.0083007812500f, -0.0189208984375f, -0.0291748046875f, 0.0017089843750f},
+};
+
+double LoudnessFromEnergy(const double energy) {
+    return -0.691 + 10.0 * std::log10(energy);
+}
+
+double EnergyFromLoudness(const double loudness) {
+    return std::pow(10.0, (loudness + 0.691) / 10.0);
+}
+
+double ChannelWeight(const AVChannelLayout &layout, const int index) {
+    switch (av_channel_layout_channel_from_index(&layout, static_cast<unsigned>(index))) {
+    case AV_CHAN_LOW_FREQUENCY:
+    case AV_CHAN_LOW_FREQUENCY_2:
+        return 0.0;
+    case AV_CHAN_BACK_LEFT:
+    case AV_CHAN_BACK_RIGHT:
+    case AV_CHAN_SIDE_LEFT:
+    case AV_CHAN_SIDE_RIGHT:
+        return 1.41;
+    default:
+        return 1.0;
+    }
+}
+
+// Mean-square energy of every complete block of `length` sub-blocks, one block per 100 ms.
+std::vector<double> BlockEnergies(const std::vector<double> &subBlocks, const int length, const int samplesPer100ms) {
+    std::vector<double> blocks;
+    if (subBlocks.size() < static_cast<size_t>(length))
+        return blocks;
+
+    const double scale = 1.0 / (static_cast<double>(length) * samplesPer100ms);
+    blocks.reserve(subBlocks.size() - length + 1);
+    for (size_t first = 0; first + length <= subBlocks.size(); ++first) {
+        double sum = 0.0;
+        for (int k = 0; k < length; ++k) {
+            sum += subBlocks[first + k];
+        }
+        blocks.push_back(sum * scale);
+    }
+    return blocks;
+}
+
+// Loudness of the absolute-gated blocks shifted by `relativeGate`, i.e. the relative gate.
+double RelativeGate(const std::vector<double> &blocks, const double relativeGate) {
+    const double absolute = EnergyFromLoudness(kAbsoluteGate);
+    double sum = 0.0;
+    size_t count = 0;
+    for (const double energy : blocks) {
+        if (energy >= absolute) {
+            sum += energy;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return kAbsoluteGate;
+    return LoudnessFromEnergy(sum / static_cast<double>(count)) + relativeGate;
+}
+
+template <typename T> double Normalized(const T value) {
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        return (static_cast<double>(value) - 128.0) / 128.0;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<double>(value);
+    } else {
+        return static_cast<double>(value) / -static_cast<double>(std::numeric_limits<T>::min());
+    }
+}
+
+// Converts `frames` samples per channel from `first` on into interleaved doubles and planar floats.
+// Each planar channel starts `planarOffset` floats into a row of `planarStride`.
+template <typename T>
+void Unpack(const AVFrame *frame, const int first, const int frames, const bool planar, const int channels,
+            double *interleaved, float *planarOut, const int planarStride, const int planarOffset) {
+    for (int c = 0; c < channels; ++c) {
+        const T *src = planar ? reinterpret_cast<const T *>(frame->extended_data[c]) + first
+                              : reinterpret_cast<const T *>(frame->extended_data[0]) +
+                                    static_cast<size_t>(first) * channels + c;
+        const int step = planar ? 1 : channels;
+        float *dst = planarOut + static_cast<size_t>(c) * planarStride + planarOffset;
+        for (int i = 0; i < frames; ++i) {
+            const double v = Normalized(src[static_cast<size_t>(i) * step]);
+            interleaved[static_cast<size_t>(i) * channels + c] = v;
+            dst[i] = static_cast<float>(v);
+        }
+    }
+}
+
+double FlushDenormal(const double v) {
+    return std::abs(v) < 1e-30 ? 0.0 : v;
+}
+
+} // namespace
+
+LoudnessMeter::LoudnessMeter(const int sampleRate, const AVChannelLayout &layout, const bool truePeak)
+    : m_channels(layout.nb_channels), m_samplesPer100ms(SubBlockSamples(sampleRate)), m_measureTruePeak(truePeak) {
+    av::Require(sampleRate > 0 && m_channels > 0, "Loudness meter needs a sample rate and channels");
+
+    // K-weighting pre-filter (high shelf) and RLB high-pass, re-derived for the input rate as in
+    // libebur128 so that rates other than 48 kHz measure the same curve.
+    {
+        const double f0 = 1681.974450955533;
+        const double gain = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(std::numbers::pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gain / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        m_shelf = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                   2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(std::numbers::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        m_highPass = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+
+    m_weights.resize(m_channels);
+    for (int c = 0; c < m_channels; ++c) {
+        m_weights[c] = ChannelWeight(layout, c);
+    }
+    m_shelfState.assign(static_cast<size_t>(m_channels) * 2, 0.0);
+    m_highPassState.assign(static_cast<size_t>(m_channels) * 2, 0.0);
+    m_peakHistory.assign(static_cast<size_t>(m_channels) * (kPeakTaps - 1), 0.0f);
+}
+
+void LoudnessMeter::Add(const AVFrame *frame) {
+    Add(frame, 0, frame->nb_samples);
+}
+
+void LoudnessMeter::Add(const AVFrame *frame, const int first, const int frames) {
+    av::Require(frame->ch_layout.nb_channels == m_channels, "Loudness meter frame has {} channels, expected {}",
+                frame->ch_layout.nb_channels, m_channels);
+    av::Require(first >= 0 && first + frames <= frame->nb_samples, "Loudness meter range is outside the frame");
+    if (frames <= 0)
+        return;
+
+    const auto format = static_cast<AVSampleFormat>(frame->format);
+    const bool planar = av_sample_fmt_is_planar(format);
+    const int stride = frames + kPeakTaps - 1;
+    m_interleaved.resize(static_cast<size_t>(frames) * m_channels);
+    m_planar.resize(static_cast<size_t>(stride) * m_channels);
+
+    const auto unpack = [&]<typename T>() {
+        Unpack<T>(frame, first, frames, planar, m_channels, m_interleaved.data(), m_planar.data(), stride,
+                  kPeakTaps - 1);
+    };
+    switch (av_get_packed_sample_fmt(format)) {
+    case AV_SAMPLE_FMT_U8:
+        unpack.template operator()<uint8_t>();
+        break;
+    case AV_SAMPLE_FMT_S16:
+        unpack.template operator()<int16_t>();
+        break;
+    case AV_SAMPLE_FMT_S32:
+        unpack.template operator()<int32_t>();
+        break;
+    case AV_SAMPLE_FMT_S64:
+        unpack.template operator()<int64_t>();
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        unpack.template operator()<float>();
+        break;
+    case AV_SAMPLE_FMT_DBL:
+        unpack.template operator()<double>();
+        break;
+    default:
+        av::Require(false, "Unsupported sample format for loudness meter: {}", static_cast<int>(format));
+    }
+
+    MeasurePeaks(frames);
+
+    // Feed the K-weighting filters in pieces that end on 100 ms sub-block boundaries.
+    for (int begin = 0; begin < frames;) {
+        const int count = (std::min)(frames - begin, m_samplesPer100ms - m_subBlockFill);
+        const double *samples = m_interleaved.data() + static_cast<size_t>(begin) * m_channels;
+        switch (m_channels) {
+        case 1:
+            Weight<1>(samples, count);
+            break;
+        case 2:
+            Weight<2>(samples, count);
+            break;
+        default:
+            Weight<0>(samples, count);
+            break;
+        }
+        begin += count;
+        m_subBlockFill += count;
+        if (m_subBlockFill == m_samplesPer100ms) {
+            m_subBlocks.push_back(m_subBlockSum);
+            m_subBlockSum = 0.0;
+            m_subBlockFill = 0;
+        }
+    }
+}
+
+void LoudnessMeter::StartSegment() {
+    av::Require(m_subBlockFill == 0, "Loudness meter segment must start on a sub-block boundary");
+    m_subBlocks.clear();
+    m_subBlockSum = 0.0;
+    m_truePeak = 0.0f;
+    m_samplePeak = 0.0f;
+}
+
+void LoudnessMeter::Append(const LoudnessMeter &next) {
+    av::Require(m_subBlockFill == 0 && next.m_channels == m_channels &&
+                    next.m_samplesPer100ms == m_samplesPer100ms,
+                "Loudness meter segments do not line up");
+    m_subBlocks.insert(m_subBlocks.end(), next.m_subBlocks.begin(), next.m_subBlocks.end());
+    m_subBlockSum = next.m_subBlockSum;
+    m_subBlockFill = next.m_subBlockFill;
+    m_truePeak = (std::max)(m_truePeak, next.m_truePeak);
+    m_samplePeak = (std::max)(m_samplePeak, next.m_samplePeak);
+}
+
+template <int Channels> void LoudnessMeter::Weight(const double *samples, const int count) {
+    const int channels = Channels > 0 ? Channels : m_channels;
+    const Biquad shelf = m_shelf;
+    const Biquad highPass = m_highPass;
+    double *const s1 = m_shelfState.data();
+    double *const s2 = s1 + channels;
+    double *const h1 = m_highPassState.data();
+    double *const h2 = h1 + channels;
+    const double *const weights = m_weights.data();
+
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i, samples += channels) {
+        for (int c = 0; c < channels; ++c) {
+            const double x = samples[c];
+            const double y = shelf.b0 * x + s1[c];
+            s1[c] = shelf.b1 * x - shelf.a1 * y + s2[c];
+            s2[c] = shelf.b2 * x - shelf.a2 * y;
+            const double z = highPass.b0 * y + h1[c];
+            h1[c] = highPass.b1 * y - highPass.a1 * z + h2[c];
+            h2[c] = highPass.b2 * y - highPass.a2 * z;
+            sum += weights[c] * z * z;
+        }
+    }
+
+    for (int c = 0; c < channels; ++c) {
+        s1[c] = FlushDenormal(s1[c]);
+        s2[c] = FlushDenormal(s2[c]);
+        h1[c] = FlushDenormal(h1[c]);
+        h2[c] = FlushDenormal(h2[c]);
+    }
+    m_subBlockSum += sum;
+}
+
+void LoudnessMeter::MeasurePeaks(const int frames) {
+    const int stride = frames + kPeakTaps - 1;
+    float truePeak = m_truePeak;
+    float samplePeak = m_samplePeak;
+
+    for (int c = 0; c < m_channels; ++c) {
+        float *const row = m_planar.data() + static_cast<size_t>(c) * stride;
+        float *const history = m_peakHistory.data() + static_cast<size_t>(c) * (kPeakTaps - 1);
+        std::copy_n(history, kPeakTaps - 1, row);
+
+        if (!m_measureTruePeak) {
+            for (int i = 0; i < frames; ++i) {
+                samplePeak = (std::max)(samplePeak, std::abs(row[kPeakTaps - 1 + i]));
+            }
+            continue;
+        }
+        for (int i = 0; i < frames; ++i) {
+            const float *window = row + i;
+            std::array<float, kPeakPhases> acc{};
+            for (int t = 0; t < kPeakTaps; ++t) {
+                for (int p = 0; p < kPeakPhases; ++p) {
+                    acc[p] += kPeakFilter[t][p] * window[t];
+                }
+            }
+            for (int p = 0; p < kPeakPhases; ++p) {
+                truePeak = (std::max)(truePeak, std::abs(acc[p]));
+            }
+            samplePeak = (std::max)(samplePeak, std::abs(window[kPeakTaps - 1]));
+        }
+
+        std::copy_n(row + frames, kPeakTaps - 1, history);
+    }
+
+    m_truePeak = truePeak;
+    m_samplePeak = samplePeak;
+}
+
+double LoudnessMeter::Integrated() const {
+    const auto blocks = BlockEnergies(m_subBlocks, kMomentarySubBlocks, m_samplesPer100ms);
+    const double gate =
+        EnergyFromLoudness((std::max)(RelativeGate(blocks, kIntegratedGate), kAbsoluteGate));
+
+    double sum = 0.0;
+    size_t count = 0;
+    for (const double energy : blocks) {
+        if (energy >= gate) {
+            sum += energy;
+            ++count;
+        }
+    }
+    return count ? LoudnessFromEnergy(sum / static_cast<double>(count)) : kAbsoluteGate;
+}
+
+double LoudnessMeter::RelativeThreshold() const {
+    const auto blocks = BlockEnergies(m_subBlocks, kMomentarySubBlocks, m_samplesPer100ms);
+    return (std::max)(RelativeGate(blocks, kIntegratedGate), kAbsoluteGate);
+}
+
+double LoudnessMeter::Range() const {
+    const auto blocks = BlockEnergies(m_subBlocks, kShortTermSubBlocks, m_samplesPer100ms);
+    const double gate = (std::max)(RelativeGate(blocks, kRangeGate), kAbsoluteGate);
+
+    std::array<uint32_t, kRangeBins> histogram{};
+    uint64_t total = 0;
+    for (const double energy : blocks) {
+        const double loudness = LoudnessFromEnergy(energy);
+        if (!(loudness >= gate))
+            continue;
+        const int bin = std::clamp(static_cast<int>((loudness - kAbsoluteGate) / kRangeBinWidth), 0, kRangeBins - 1);
+        ++histogram[bin];
+        ++total;
+    }
+    if (total == 0)
+        return 0.0;
+
+    const auto percentile = [&](const double fraction) {
+        const auto rank = static_cast<uint64_t>(std::llround(static_cast<double>(total - 1) * fraction));
+        uint64_t seen = 0;
+        for (int bin = 0; bin < kRangeBins; ++bin) {
+            seen += histogram[bin];
+            if (seen > rank)
+                return kAbsoluteGate + (bin + 0.5) * kRangeBinWidth;
+        }
+        return kRangeMax;
+    };
+    return percentile(0.95) - percentile(0.10);
+}
+
+double LoudnessMeter::TruePeak() const {
+    const float peak = (std::max)(m_truePeak, m_samplePeak);
+    return peak > 0.0f ? (std::max)(20.0 * std::log10(peak), kMinLevel) : kMinLevel;
+}
+
+double LoudnessMeter::SamplePeak() const {
+    return m_samplePeak > 0.0f ? (std::max)(20.0 * std::log10(m_samplePeak), kMinLevel) : kMinLevel;
+}
+
+std::vector<float> LoudnessMeter::Momentary() const {
+    std::vector<float> momentary;
+    momentary.reserve(m_subBlocks.size());
+    const double scale = 1.0 / (static_cast<double>(kMomentarySubBlocks) * m_samplesPer100ms);
+    for (size_t i = 0; i < m_subBlocks.size(); ++i) {
+        double sum = 0.0;
+        for (size_t k = i + 1 - (std::min)(i + 1, size_t{kMomentarySubBlocks}); k <= i; ++k) {
+            sum += m_subBlocks[k];
+        }
+        const double energy = sum * scale;
+        momentary.push_back(
+            static_cast<float>(energy > 0.0 ? (std::max)(LoudnessFromEnergy(energy), kMinLevel) : kMinLevel));
+    }
+    return momentary;
+}
+
+} // namespace Audio::detail
@@ -0,0 +1,87 @@
+// src/audio/detail/meter.hpp
+#pragma once
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/frame.h>
+}
+
+#include <cstdint>
+#include <vector>
+
+namespace Audio::detail {
+
+// Native ITU-R BS.1770-4 / EBU R128 meter: K-weighted, gated integrated loudness, EBU Tech 3342
+// loudness range and 4x oversampled true peak, all measured in a single pass.
+//
+// The kernels are plain scalar loops; only their data is laid out with vectorization in mind. The
+// K-weighting biquads run on interleaved samples with their state stored per channel, and the
+// true-peak polyphase filter runs on planar samples with the four phases of each tap adjacent.
+// Whether the compiler turns either into SIMD code is up to it.
+class LoudnessMeter {
+  public:
+    // Without `truePeak` the oversampled peak is skipped and TruePeak reports the sample peak.
+    LoudnessMeter(int sampleRate, const AVChannelLayout &layout, bool truePeak = true);
+
+    // Accepts packed or planar frames in any integer or floating point sample format.
+    void Add(const AVFrame *frame);
+    // Feeds only the `count` samples of `frame` starting at `first`.
+    void Add(const AVFrame *frame, int first, int count);
+
+    // Drops everything measured so far but keeps the filter state, so that the samples fed before
+    // act as pre-roll for a segment that starts here. Must fall on a 100 ms sub-block boundary.
+    void StartSegment();
+    // Appends the measurements of `next`, which metered the samples right after this meter's. This
+    // meter must have stopped on a sub-block boundary.
+    void Append(const LoudnessMeter &next);
+
+    [[nodiscard]] double Integrated() const;        // LUFS
+    [[nodiscard]] double RelativeThreshold() const; // LUFS
+    [[nodiscard]] double Range() const;             // LU
+    [[nodiscard]] double TruePeak() const;          // dBTP
+    [[nodiscard]] double SamplePeak() const;        // dBFS
+
+    // Momentary (400 ms) loudness ending at each complete sub-block, in LUFS; the first few windows
+    // count the time before the first sample as silence.
+    [[nodiscard]] std::vector<float> Momentary() const;
+
+    // Length of a 100 ms sub-block at `sampleRate`, the granularity segments must line up on.
+    [[nodiscard]] static int SubBlockSamples(int sampleRate) {
+        return (sampleRate + 5) / 10;
+    }
+
+  private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    template <int Channels> void Weight(const double *samples, int count);
+    void MeasurePeaks(int frames);
+
+    int m_channels;
+    int m_samplesPer100ms;
+    bool m_measureTruePeak;
+    Biquad m_shelf{};
+    Biquad m_highPass{};
+    std::vector<double> m_weights;
+
+    // Direct form II transposed state: two words per stage, each stored contiguously per channel.
+    std::vector<double> m_shelfState;
+    std::vector<double> m_highPassState;
+
+    // Weighted sum of squares of each complete 100 ms sub-block. Momentary (400 ms) and
+    // short-term (3 s) blocks are sums over consecutive sub-blocks.
+    std::vector<double> m_subBlocks;
+    double m_subBlockSum = 0.0;
+    int m_subBlockFill = 0;
+
+    // The current frame as interleaved doubles, and as planar floats preceded by the last
+    // samples of the previous frame that the oversampling filter still needs.
+    std::vector<double> m_interleaved;
+    std::vector<float> m_planar;
+    std::vector<float> m_peakHistory;
+    float m_truePeak = 0.0f;
+    float m_samplePeak = 0.0f;
+};
+
+} // namespace Audio::detail
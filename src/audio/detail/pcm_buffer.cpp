@@ -0,0 +1,240 @@
+// src/audio/detail/pcm_buffer.cpp
+#include "audio/detail/pcm_buffer.hpp"
+
+extern "C" {
+#include <libavfilter/buffersink.h>
+}
+
+#include "audio/detail/error.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace Audio::detail {
+
+namespace {
+
+// Once spilled, appends are staged in memory and written to the file in chunks of this size.
+constexpr std::size_t kSpillChunk = std::size_t{1} << 20;
+
+} // namespace
+
+class PcmBuffer::SpillFile {
+  public:
+    SpillFile() {
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        m_path = fs::temp_directory_path() /
+                 fmt::format("muautils-pcm-{}-{}.raw", stamp, reinterpret_cast<std::uintptr_t>(this));
+#if defined(_WIN32)
+        m_file = CreateFileW(m_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                             FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            throw lib::FileError(m_path, "Failed to create PCM spill file");
+        }
+#else
+        m_fd = open(m_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (m_fd < 0) {
+            throw lib::FileError(m_path, "Failed to create PCM spill file");
+        }
+        // The descriptor keeps the data alive; nothing is left behind if the process dies.
+        unlink(m_path.c_str());
+#endif
+    }
+
+    ~SpillFile() {
+#if defined(_WIN32)
+        if (m_view)
+            UnmapViewOfFile(m_view);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        CloseHandle(m_file);
+#else
+        if (m_view)
+            munmap(const_cast<uint8_t *>(m_view), m_size);
+        close(m_fd);
+#endif
+    }
+
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
+
+    void Write(std::span<const uint8_t> bytes) {
+        while (!bytes.empty()) {
+#if defined(_WIN32)
+            const auto chunk = static_cast<DWORD>((std::min)(bytes.size(), std::size_t{1} << 30));
+            DWORD written = 0;
+            if (!WriteFile(m_file, bytes.data(), chunk, &written, nullptr)) {
+                throw lib::FileError(m_path, "Failed to write PCM spill file");
+            }
+#else
+            const auto written = write(m_fd, bytes.data(), bytes.size());
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw lib::FileError(m_path, "Failed to write PCM spill file");
+            }
+#endif
+            m_size += static_cast<std::size_t>(written);
+            bytes = bytes.subspan(static_cast<std::size_t>(written));
+        }
+    }
+
+    void Map() {
+        if (m_size == 0)
+            return;
+#if defined(_WIN32)
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) {
+            throw lib::FileError(m_path, "Failed to map PCM spill file");
+        }
+        m_view = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_view) {
+            throw lib::FileError(m_path, "Failed to map PCM spill file");
+        }
+#else
+        void *view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (view == MAP_FAILED) {
+            throw lib::FileError(m_path, "Failed to map PCM spill file");
+        }
+        madvise(view, m_size, MADV_SEQUENTIAL);
+        m_view = static_cast<const uint8_t *>(view);
+#endif
+    }
+
+    [[nodiscard]] std::span<const uint8_t> View() const {
+        return {m_view, m_view ? m_size : 0};
+    }
+
+  private:
+    fs::path m_path;
+    std::size_t m_size = 0;
+    const uint8_t *m_view = nullptr;
+#if defined(_WIN32)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+PcmBuffer::PcmBuffer(const std::size_t memoryLimit) : m_memoryLimit(memoryLimit) {}
+
+PcmBuffer::~PcmBuffer() {
+    av_channel_layout_uninit(&m_layout);
+}
+
+void PcmBuffer::Reset(const std::size_t memoryLimit) {
+    m_memoryLimit = memoryLimit;
+    m_spill.reset();
+    m_memory.clear();
+    m_samples = 0;
+    m_finished = false;
+}
+
+void PcmBuffer::Configure(const AVFilterContext *sink) {
+    m_format = static_cast<AVSampleFormat>(av_buffersink_get_format(sink));
+    av::Require(m_format != AV_SAMPLE_FMT_NONE && !av_sample_fmt_is_planar(m_format),
+                "Decoded audio buffer requires a packed sample format");
+    m_sampleRate = av_buffersink_get_sample_rate(sink);
+
+    av_channel_layout_uninit(&m_layout);
+    const auto ret = av_buffersink_get_ch_layout(sink, &m_layout);
+    av::Check(ret, "Failed to get channel layout from buffer sink");
+
+    m_frameBytes = static_cast<std::size_t>(av_get_bytes_per_sample(m_format)) * m_layout.nb_channels;
+}
+
+void PcmBuffer::Append(const AVFrame *frame) {
+    av::Require(!m_finished, "Decoded audio buffer is already finished");
+    av::Require(frame->format == m_format && frame->ch_layout.nb_channels == m_layout.nb_channels,
+                "Decoded audio frame does not match buffer format");
+
+    const std::size_t bytes = static_cast<std::size_t>(frame->nb_samples) * m_frameBytes;
+    if (!m_spill && m_memory.size() + bytes > m_memoryLimit) {
+        spdlog::debug("Decoded audio exceeds {} bytes, spilling to a temporary file", m_memoryLimit);
+        m_spill = std::make_unique<SpillFile>();
+        m_spill->Write(m_memory);
+        std::vector<uint8_t>().swap(m_memory);
+        m_memory.reserve(kSpillChunk);
+    }
+
+    m_memory.insert(m_memory.end(), frame->data[0], frame->data[0] + bytes);
+    m_samples += frame->nb_samples;
+
+    if (m_spill && m_memory.size() >= kSpillChunk) {
+        m_spill->Write(m_memory);
+        m_memory.clear();
+    }
+}
+
+void PcmBuffer::Finish() {
+    if (m_finished)
+        return;
+    m_finished = true;
+    if (!m_spill)
+        return;
+    m_spill->Write(m_memory);
+    std::vector<uint8_t>().swap(m_memory);
+    m_spill->Map();
+}
+
+int PcmBuffer::ReadFrame(AVFrame *frame, const int64_t position, const int maxSamples) const {
+    av::Require(m_finished, "Decoded audio buffer must be finished before replay");
+    const int64_t remaining = m_samples - position;
+    if (remaining <= 0)
+        return 0;
+    const int count = static_cast<int>((std::min)(remaining, static_cast<int64_t>(maxSamples)));
+
+    frame->format = m_format;
+    frame->sample_rate = m_sampleRate;
+    frame->nb_samples = count;
+    frame->pts = position;
+    frame->time_base = AVRational{1, m_sampleRate};
+
+    auto ret = av_channel_layout_copy(&frame->ch_layout, &m_layout);
+    av::Check(ret, "Failed to copy channel layout to replay frame");
+
+    const std::size_t bufferSize = static_cast<std::size_t>(maxSamples) * m_frameBytes;
+    if (!m_replayPool || m_replayBufferSize != bufferSize) {
+        m_replayPool.reset(av_buffer_pool_init(bufferSize, av_buffer_alloc));
+        av::Require(m_replayPool.get(), "Failed to allocate replay buffer pool");
+        m_replayBufferSize = bufferSize;
+    }
+    frame->buf[0] = av_buffer_pool_get(m_replayPool.get());
+    av::Require(frame->buf[0], "Failed to allocate replay frame buffer");
+    frame->data[0] = frame->buf[0]->data;
+    frame->extended_data = frame->data;
+    frame->linesize[0] = static_cast<int>(static_cast<std::size_t>(count) * m_frameBytes);
+
+    const auto data = Data();
+    std::memcpy(frame->data[0], data.data() + static_cast<std::size_t>(position) * m_frameBytes,
+                static_cast<std::size_t>(count) * m_frameBytes);
+    return count;
+}
+
+std::span<const uint8_t> PcmBuffer::Data() const {
+    if (m_spill)
+        return m_spill->View();
+    return m_memory;
+}
+
+} // namespace Audio::detail
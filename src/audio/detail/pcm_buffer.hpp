@@ -0,0 +1,88 @@
+// src/audio/detail/pcm_buffer.hpp
+#pragma once
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include "audio/detail/raii.hpp"
+#include "lib.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Audio::detail {
+
+// Interleaved PCM captured during the loudness analysis pass so the second pass can replay it
+// instead of demuxing and decoding the source again. Samples are kept in memory up to
+// `memoryLimit` bytes; anything beyond that spills to a temporary file which is memory-mapped
+// once capture is finished.
+class PcmBuffer {
+  public:
+    explicit PcmBuffer(std::size_t memoryLimit);
+    ~PcmBuffer();
+
+    PcmBuffer(const PcmBuffer &) = delete;
+    PcmBuffer &operator=(const PcmBuffer &) = delete;
+
+    // Drops the captured samples so the buffer can take a new capture with a new memory limit.
+    // Memory already reserved is kept for the next one.
+    void Reset(std::size_t memoryLimit);
+
+    // Takes the sample format, rate and channel layout from a configured abuffersink. The format
+    // must be packed; frames passed to Append are expected to match it.
+    void Configure(const AVFilterContext *sink);
+
+    void Append(const AVFrame *frame);
+
+    // Flushes any spilled data and maps it for replay. No further Append calls are allowed.
+    void Finish();
+
+    // Fills `frame` with up to `maxSamples` samples starting at `position`. Returns the number of
+    // samples written, or 0 once the end of the buffer is reached. Sample buffers come from a pool
+    // sized for `maxSamples`, so replay does not allocate per frame. Not thread-safe.
+    int ReadFrame(AVFrame *frame, int64_t position, int maxSamples) const;
+
+    [[nodiscard]] AVSampleFormat Format() const {
+        return m_format;
+    }
+    [[nodiscard]] int SampleRate() const {
+        return m_sampleRate;
+    }
+    [[nodiscard]] const AVChannelLayout &Layout() const {
+        return m_layout;
+    }
+    [[nodiscard]] int64_t Samples() const {
+        return m_samples;
+    }
+    [[nodiscard]] bool Spilled() const {
+        return m_spill != nullptr;
+    }
+
+  private:
+    class SpillFile;
+
+    [[nodiscard]] std::span<const uint8_t> Data() const;
+
+    std::size_t m_memoryLimit;
+    AVSampleFormat m_format = AV_SAMPLE_FMT_NONE;
+    int m_sampleRate = 0;
+    AVChannelLayout m_layout{};
+    std::size_t m_frameBytes = 0;
+    int64_t m_samples = 0;
+    bool m_finished = false;
+
+    std::vector<uint8_t> m_memory;
+    std::unique_ptr<SpillFile> m_spill;
+
+    mutable AVBufferPoolPtr m_replayPool;
+    mutable std::size_t m_replayBufferSize = 0;
+};
+
+} // namespace Audio::detail
@@ -2,8 +2,15 @@
 #pragma once
 
 #include "audio/detail/error.hpp"
+#include "audio/detail/frame_pool.hpp"
+#include "audio/detail/pcm_buffer.hpp"
 #include "audio/detail/raii.hpp"
+#include "audio/detail/spsc_queue.hpp"
 
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 extern "C" {
@@ -17,13 +24,31 @@ extern "C" {
 
 namespace Audio::detail {
 
+// Packet and frames used while running a graph. Long-lived callers (batch workers) keep one around
+// so consecutive jobs do not reallocate them.
+struct GraphScratch {
+    GraphScratch();
+
+    AVPacketPtr Packet;
+    AVFramePtr Decoded;
+    AVFramePtr Filtered;
+
+    // Time RunGraph spent demuxing and decoding, accumulated across runs until reset by the caller.
+    std::chrono::steady_clock::duration DecodeTime{};
+};
+
 namespace pipeline_detail {
 
+// Size of the frames PcmBuffer replay feeds into a graph.
+constexpr int kReplayFrameSamples = 4096;
+
 template <typename FrameCb>
 void pumpDecoder(const AVCodecContextPtr &decoder, AVFilterContext *src, AVFilterContext *sink, const AVFramePtr &dfrm,
-                 const AVFramePtr &ffrm, FrameCb &&cb) {
+                 const AVFramePtr &ffrm, std::chrono::steady_clock::duration &decodeTime, FrameCb &&cb) {
     for (;;) {
+        const auto start = std::chrono::steady_clock::now();
         auto ret = avcodec_receive_frame(decoder.get(), dfrm.get());
+        decodeTime += std::chrono::steady_clock::now() - start;
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
             break;
         av::Check(ret, "Failed to receive frame from decoder");
@@ -47,15 +72,15 @@ void pumpDecoder(const AVCodecContextPtr &decoder, AVFilterContext *src, AVFilte
 // and trailer write that comes after.
 template <typename OnFrame>
 void RunGraph(const AVFormatInputContextPtr &input, const AVStream *stream, const AVCodecContextPtr &decoder,
-              AVFilterContext *src, AVFilterContext *sink, OnFrame &&onFrame) {
+              AVFilterContext *src, AVFilterContext *sink, GraphScratch &scratch, OnFrame &&onFrame) {
     auto &&cb = std::forward<OnFrame>(onFrame);
 
-    const AVPacketPtr pkt(av_packet_alloc());
-    const AVFramePtr dfrm(av_frame_alloc());
-    const AVFramePtr ffrm(av_frame_alloc());
-    av::Require(pkt && dfrm && ffrm, "Failed to allocate packet or frame");
+    const AVPacketPtr &pkt = scratch.Packet;
+    const AVFramePtr &dfrm = scratch.Decoded;
+    const AVFramePtr &ffrm = scratch.Filtered;
 
     for (;;) {
+        const auto start = std::chrono::steady_clock::now();
         const auto rret = av_read_frame(input.get(), pkt.get());
         if (rret == AVERROR_EOF)
             break;
@@ -68,12 +93,13 @@ void RunGraph(const AVFormatInputContextPtr &input, const AVStream *stream, cons
         auto ret = avcodec_send_packet(decoder.get(), pkt.get());
         av::Check(ret, "Failed to send packet to decoder: {}", decoder->codec->name);
         av_packet_unref(pkt.get());
-        pipeline_detail::pumpDecoder(decoder, src, sink, dfrm, ffrm, cb);
+        scratch.DecodeTime += std::chrono::steady_clock::now() - start;
+        pipeline_detail::pumpDecoder(decoder, src, sink, dfrm, ffrm, scratch.DecodeTime, cb);
     }
 
     auto ret = avcodec_send_packet(decoder.get(), nullptr);
     av::Check(ret, "Failed to send end-of-stream packet to decoder: {}", decoder->codec->name);
-    pipeline_detail::pumpDecoder(decoder, src, sink, dfrm, ffrm, cb);
+    pipeline_detail::pumpDecoder(decoder, src, sink, dfrm, ffrm, scratch.DecodeTime, cb);
 
     ret = av_buffersrc_add_frame(src, nullptr);
     av::Check(ret, "Failed to add end-of-stream frame to buffer source: {}", src->filter->name);
@@ -84,24 +110,218 @@ void RunGraph(const AVFormatInputContextPtr &input, const AVStream *stream, cons
     }
 }
 
-// Writes one encoded packet to `output`, rescaling timestamps from `encoder`'s time_base
-// to `ost`'s time_base (which the muxer may have rewritten during avformat_write_header)
-// and tagging the packet with the correct output stream index. Unrefs the packet on success.
-void WritePacket(const AVPacketPtr &pkt, const AVCodecContextPtr &encoder, const AVFormatOutputContextPtr &output,
-                 const AVStream *ost);
-
-// Drains any packets the encoder currently has queued, forwarding them through WritePacket.
-// Stops on AVERROR(EAGAIN); propagates any other error.
-void DrainEncoder(const AVCodecContextPtr &encoder, const AVFormatOutputContextPtr &output, const AVStream *ost,
-                  const AVPacketPtr &pkt);
-
-// Pushes `frame` into `encoder` and drains any packets it produces. `src_frame_time_base`
-// is the time_base of `frame->pts` (typically the filter graph's abuffersink time_base).
-void Encode(const AVFramePtr &frame, const AVCodecContextPtr &encoder, const AVFormatOutputContextPtr &output,
-            const AVStream *ost, const AVPacketPtr &pkt, AVRational src_frame_time_base);
-
-// Signals end-of-stream to `encoder` and drains remaining packets through WritePacket.
-void FlushEncoder(const AVCodecContextPtr &encoder, const AVFormatOutputContextPtr &output, const AVStream *ost,
-                  const AVPacketPtr &pkt);
+// Replays PCM captured during an earlier pass through the filter graph rooted at `src`,
+// invoking `onFrame` for each frame produced at `sink`. Handles the filter-graph flush.
+template <typename OnFrame>
+void RunGraph(const PcmBuffer &input, AVFilterContext *src, AVFilterContext *sink, GraphScratch &scratch,
+              OnFrame &&onFrame) {
+    auto &&cb = std::forward<OnFrame>(onFrame);
+
+    const AVFramePtr &rfrm = scratch.Decoded;
+    const AVFramePtr &ffrm = scratch.Filtered;
+
+    for (int64_t position = 0;;) {
+        const int count = input.ReadFrame(rfrm.get(), position, pipeline_detail::kReplayFrameSamples);
+        if (count == 0)
+            break;
+        position += count;
+
+        const auto ret = av_buffersrc_add_frame(src, rfrm.get());
+        av::Check(ret, "Failed to add frame to buffer source: {}", src->filter->name);
+
+        while (av_buffersink_get_frame(sink, ffrm.get()) == 0) {
+            cb(ffrm.get());
+            av_frame_unref(ffrm.get());
+        }
+    }
+
+    const auto ret = av_buffersrc_add_frame(src, nullptr);
+    av::Check(ret, "Failed to add end-of-stream frame to buffer source: {}", src->filter->name);
+
+    while (av_buffersink_get_frame(sink, ffrm.get()) == 0) {
+        cb(ffrm.get());
+        av_frame_unref(ffrm.get());
+    }
+}
+
+template <typename OnFrame>
+void RunGraph(const AVFormatInputContextPtr &input, const AVStream *stream, const AVCodecContextPtr &decoder,
+              AVFilterContext *src, AVFilterContext *sink, OnFrame &&onFrame) {
+    GraphScratch scratch;
+    RunGraph(input, stream, decoder, src, sink, scratch, std::forward<OnFrame>(onFrame));
+}
+
+template <typename OnFrame>
+void RunGraph(const PcmBuffer &input, AVFilterContext *src, AVFilterContext *sink, OnFrame &&onFrame) {
+    GraphScratch scratch;
+    RunGraph(input, src, sink, scratch, std::forward<OnFrame>(onFrame));
+}
+
+namespace pipeline_detail {
+
+// Frames in flight between two pipeline stages. Small enough to bound memory, large enough to
+// absorb the burstiness of packet-sized decoder output.
+constexpr std::size_t kStageDepth = 16;
+
+using FrameQueue = SpscQueue<AVFramePtr>;
+
+// Runs `produce` on one thread and the filter graph on another, handing frames over through
+// bounded SPSC queues, while `cb` consumes filtered frames on the calling thread. Frames keep their
+// order at every stage, so the output is identical to the serial RunGraph. Every frame shell comes
+// from and goes back to `pool`, so nothing is allocated per frame once the queues have filled.
+template <typename Produce, typename FrameCb>
+void runStages(FramePool &pool, Produce &&produce, AVFilterContext *src, AVFilterContext *sink, FrameCb &&cb) {
+    FrameQueue decoded(kStageDepth);
+    FrameQueue filtered(kStageDepth);
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    const auto fail = [&] {
+        {
+            std::lock_guard lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+        decoded.Cancel();
+        filtered.Cancel();
+    };
+
+    std::jthread producer([&] {
+        try {
+            produce([&](AVFramePtr frame) { return decoded.Push(std::move(frame)); });
+            decoded.Close();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    std::jthread filter([&] {
+        try {
+            const auto drain = [&] {
+                for (;;) {
+                    auto frame = pool.AcquireFrame();
+                    if (av_buffersink_get_frame(sink, frame.get()) != 0) {
+                        pool.Release(std::move(frame));
+                        return true;
+                    }
+                    if (!filtered.Push(std::move(frame)))
+                        return false;
+                }
+            };
+
+            while (auto frame = decoded.Pop()) {
+                const auto ret = av_buffersrc_add_frame(src, frame->get());
+                av::Check(ret, "Failed to add frame to buffer source: {}", src->filter->name);
+                pool.Release(std::move(*frame));
+                if (!drain())
+                    return;
+            }
+            if (decoded.Cancelled())
+                return;
+
+            const auto ret = av_buffersrc_add_frame(src, nullptr);
+            av::Check(ret, "Failed to add end-of-stream frame to buffer source: {}", src->filter->name);
+            if (drain())
+                filtered.Close();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    try {
+        while (auto frame = filtered.Pop()) {
+            cb(frame->get());
+            pool.Release(std::move(*frame));
+        }
+    } catch (...) {
+        fail();
+    }
+
+    producer.join();
+    filter.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+} // namespace pipeline_detail
+
+// Pipelined RunGraph: demux and decode, the filter graph, and `onFrame` each run on their own
+// thread. Produces the same frames in the same order as the serial version.
+template <typename OnFrame>
+void RunGraphPipelined(const AVFormatInputContextPtr &input, const AVStream *stream, const AVCodecContextPtr &decoder,
+                       AVFilterContext *src, AVFilterContext *sink, FramePool &pool, OnFrame &&onFrame) {
+    const auto produce = [&](auto &&push) {
+        const AVPacketPtr pkt = pool.AcquirePacket();
+
+        const auto receive = [&] {
+            for (;;) {
+                auto frame = pool.AcquireFrame();
+                const auto ret = avcodec_receive_frame(decoder.get(), frame.get());
+                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                    pool.Release(std::move(frame));
+                    return true;
+                }
+                av::Check(ret, "Failed to receive frame from decoder");
+                if (!push(std::move(frame)))
+                    return false;
+            }
+        };
+
+        for (;;) {
+            const auto rret = av_read_frame(input.get(), pkt.get());
+            if (rret == AVERROR_EOF)
+                break;
+            av::Check(rret, "Failed to read frame from input");
+
+            if (pkt->stream_index != stream->index) {
+                av_packet_unref(pkt.get());
+                continue;
+            }
+            const auto ret = avcodec_send_packet(decoder.get(), pkt.get());
+            av::Check(ret, "Failed to send packet to decoder: {}", decoder->codec->name);
+            av_packet_unref(pkt.get());
+            if (!receive())
+                return;
+        }
+
+        const auto ret = avcodec_send_packet(decoder.get(), nullptr);
+        av::Check(ret, "Failed to send end-of-stream packet to decoder: {}", decoder->codec->name);
+        receive();
+    };
+    pipeline_detail::runStages(pool, produce, src, sink, std::forward<OnFrame>(onFrame));
+}
+
+// Pipelined replay of a PcmBuffer; see above.
+template <typename OnFrame>
+void RunGraphPipelined(const PcmBuffer &input, AVFilterContext *src, AVFilterContext *sink, FramePool &pool,
+                       OnFrame &&onFrame) {
+    const auto produce = [&](auto &&push) {
+        for (int64_t position = 0;;) {
+            auto frame = pool.AcquireFrame();
+            const int count = input.ReadFrame(frame.get(), position, pipeline_detail::kReplayFrameSamples);
+            if (count == 0) {
+                pool.Release(std::move(frame));
+                return;
+            }
+            if (!push(std::move(frame)))
+                return;
+            position += count;
+        }
+    };
+    pipeline_detail::runStages(pool, produce, src, sink, std::forward<OnFrame>(onFrame));
+}
+
+template <typename OnFrame>
+void RunGraphPipelined(const AVFormatInputContextPtr &input, const AVStream *stream, const AVCodecContextPtr &decoder,
+                       AVFilterContext *src, AVFilterContext *sink, OnFrame &&onFrame) {
+    FramePool pool;
+    RunGraphPipelined(input, stream, decoder, src, sink, pool, std::forward<OnFrame>(onFrame));
+}
+
+template <typename OnFrame>
+void RunGraphPipelined(const PcmBuffer &input, AVFilterContext *src, AVFilterContext *sink, OnFrame &&onFrame) {
+    FramePool pool;
+    RunGraphPipelined(input, src, sink, pool, std::forward<OnFrame>(onFrame));
+}
 
 } // namespace Audio::detail
@@ -5,6 +5,7 @@ extern "C" {
 #include <libavfilter/avfilter.h>
 #include <libavfilter/buffersrc.h>
 #include <libavformat/avformat.h>
+#include <libavutil/buffer.h>
 #include <libavutil/channel_layout.h>
 #include <libavutil/frame.h>
 #include <libavutil/mem.h>
@@ -28,16 +29,17 @@ struct AVFormatInputContextDeleter {
 };
 using AVFormatInputContextPtr = std::unique_ptr<AVFormatContext, AVFormatInputContextDeleter>;
 
-struct AVFormatOutputContextDeleter {
-    void operator()(AVFormatContext *ctx) const {
+// For contexts from avio_alloc_context; the buffer may have been reallocated by FFmpeg, so it is
+// freed through the context.
+struct AVIOContextDeleter {
+    void operator()(AVIOContext *ctx) const {
         if (!ctx)
             return;
-        if (ctx->pb)
-            avio_closep(&ctx->pb);
-        avformat_free_context(ctx);
+        av_freep(&ctx->buffer);
+        avio_context_free(&ctx);
     }
 };
-using AVFormatOutputContextPtr = std::unique_ptr<AVFormatContext, AVFormatOutputContextDeleter>;
+using AVIOContextPtr = std::unique_ptr<AVIOContext, AVIOContextDeleter>;
 
 struct AVCodecContextDeleter {
     void operator()(AVCodecContext *ctx) const {
@@ -67,6 +69,13 @@ struct AVFrameDeleter {
 };
 using AVFramePtr = std::unique_ptr<AVFrame, AVFrameDeleter>;
 
+struct AVBufferPoolDeleter {
+    void operator()(AVBufferPool *pool) const {
+        av_buffer_pool_uninit(&pool);
+    }
+};
+using AVBufferPoolPtr = std::unique_ptr<AVBufferPool, AVBufferPoolDeleter>;
+
 struct AVBufferSrcParametersDeleter {
     void operator()(AVBufferSrcParameters *par) const {
         if (!par)
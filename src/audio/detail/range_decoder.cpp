@@ -0,0 +1,117 @@
+// src/audio/detail/range_decoder.cpp
+#include "audio/detail/range_decoder.hpp"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/mathematics.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include "audio/detail/error.hpp"
+#include "audio/detail/format.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace Audio::detail {
+
+namespace {
+
+constexpr int kSilenceFrameSamples = 4096;
+constexpr int64_t kMinRangeSeconds = 30;
+
+} // namespace
+
+RangeDecoder::RangeDecoder(const AudioInput &src) {
+    if (src.InMemory()) {
+        m_input.emplace(src.Bytes());
+    } else {
+        m_input.emplace(src.Name());
+    }
+    m_ifmt = m_input->Open();
+    m_ist = GetBestAudioStream(m_ifmt);
+    m_dctx = OpenDecoder(m_ist);
+}
+
+void RangeDecoder::Run(const int64_t shift, const int64_t from, const int64_t to, const OnSamples &onSamples,
+                       const int64_t preRoll) {
+    int64_t position = from;
+
+    if (position < shift) {
+        const AVFramePtr silence(av_frame_alloc());
+        av::Require(silence.get(), "Failed to allocate silence frame");
+        silence->format = m_dctx->sample_fmt;
+        silence->sample_rate = m_dctx->sample_rate;
+        silence->nb_samples = kSilenceFrameSamples;
+        auto ret = av_channel_layout_copy(&silence->ch_layout, &m_dctx->ch_layout);
+        av::Check(ret, "Failed to copy channel layout to silence frame");
+        ret = av_frame_get_buffer(silence.get(), 0);
+        av::Check(ret, "Failed to allocate silence frame buffer");
+        av_samples_set_silence(silence->extended_data, 0, kSilenceFrameSamples, silence->ch_layout.nb_channels,
+                               m_dctx->sample_fmt);
+
+        const int64_t silenceEnd = (std::min)(shift, to);
+        while (position < silenceEnd) {
+            const auto count = static_cast<int>((std::min)(int64_t{kSilenceFrameSamples}, silenceEnd - position));
+            onSamples(silence.get(), 0, count);
+            position += count;
+        }
+    }
+    if (position >= to)
+        return;
+
+    const AVRational sampleTb{1, m_dctx->sample_rate};
+    const int64_t startTime = m_ist->start_time == AV_NOPTS_VALUE ? 0 : m_ist->start_time;
+    const int64_t sourceStart = position - shift - preRoll;
+    if (sourceStart > 0) {
+        const int64_t ts = startTime + av_rescale_q(sourceStart, sampleTb, m_ist->time_base);
+        const auto ret = avformat_seek_file(m_ifmt.get(), m_ist->index, INT64_MIN, ts, ts, 0);
+        av::Check(ret, m_input->Name(), "Failed to seek input to the start of the range");
+    }
+
+    const AVPacketPtr pkt(av_packet_alloc());
+    const AVFramePtr frame(av_frame_alloc());
+    av::Require(pkt.get() && frame.get(), "Failed to allocate packet or frame");
+
+    const auto drain = [&] {
+        for (;;) {
+            const auto ret = avcodec_receive_frame(m_dctx.get(), frame.get());
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+                return;
+            av::Check(ret, "Failed to receive frame from decoder");
+
+            av::Require(frame->best_effort_timestamp != AV_NOPTS_VALUE, "Decoded frame has no timestamp");
+            const int64_t frameStart =
+                av_rescale_q(frame->best_effort_timestamp - startTime, m_ist->time_base, sampleTb) + shift;
+            const int64_t skip = position - frameStart;
+            av::Require(skip >= 0, "Seek landed after the start of the range");
+            if (skip < frame->nb_samples && position < to) {
+                const auto count = (std::min)(int64_t{frame->nb_samples} - skip, to - position);
+                onSamples(frame.get(), static_cast<int>(skip), static_cast<int>(count));
+                position += count;
+            }
+            av_frame_unref(frame.get());
+        }
+    };
+
+    while (position < to && av_read_frame(m_ifmt.get(), pkt.get()) >= 0) {
+        if (pkt->stream_index == m_ist->index) {
+            const auto ret = avcodec_send_packet(m_dctx.get(), pkt.get());
+            av::Check(ret, "Failed to send packet to decoder");
+            drain();
+        }
+        av_packet_unref(pkt.get());
+    }
+    if (position < to) {
+        const auto ret = avcodec_send_packet(m_dctx.get(), nullptr);
+        av::Check(ret, "Failed to flush decoder");
+        drain();
+    }
+}
+
+int64_t RangeCount(const int64_t samples, const int sampleRate, const unsigned threads) {
+    const unsigned hardware = (std::max)(1u, std::thread::hardware_concurrency());
+    return (std::min)(int64_t{threads ? threads : hardware}, samples / (kMinRangeSeconds * sampleRate));
+}
+
+} // namespace Audio::detail
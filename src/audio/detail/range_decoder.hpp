@@ -0,0 +1,51 @@
+// src/audio/detail/range_decoder.hpp
+#pragma once
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+}
+
+#include "audio/detail/io.hpp"
+#include "audio/detail/raii.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+namespace Audio::detail {
+
+// Decodes one time range of an input on a demuxer and decoder of its own, so several ranges can
+// be decoded in parallel. Positions are samples on the offset timeline, where the source starts at
+// `shift` (see OffsetSamples): a positive shift is leading silence, a negative one drops the
+// source's first samples. Only meaningful for codecs with exact seeking (see HasExactSeek).
+class RangeDecoder {
+  public:
+    using OnSamples = std::function<void(const AVFrame *frame, int first, int count)>;
+
+    explicit RangeDecoder(const AudioInput &src);
+
+    [[nodiscard]] const AVCodecContextPtr &Decoder() const {
+        return m_dctx;
+    }
+
+    // Delivers the samples [from, to) in order as ranges of decoded frames (or of silence frames
+    // in the decoder's format), then returns. Stops early at the end of the input. Decoding starts
+    // `preRoll` samples before `from`, which primes decoders whose first frames after a seek are
+    // not exact (MP3's bit reservoir, AAC's overlap) and absorbs seeks that land a little late.
+    void Run(int64_t shift, int64_t from, int64_t to, const OnSamples &onSamples, int64_t preRoll = 0);
+
+  private:
+    std::optional<AudioInput> m_input;
+    AVFormatInputContextPtr m_ifmt;
+    const AVStream *m_ist = nullptr;
+    AVCodecContextPtr m_dctx;
+};
+
+// How many ranges `samples` at `sampleRate` are split into for `threads` threads (0: one per
+// hardware thread). Ranges shorter than 30 s are not worth a demuxer and decoder of their own, so
+// short inputs get fewer ranges; a result below 2 means the input should not be split.
+int64_t RangeCount(int64_t samples, int sampleRate, unsigned threads);
+
+} // namespace Audio::detail
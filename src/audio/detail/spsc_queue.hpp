@@ -0,0 +1,102 @@
+// src/audio/detail/spsc_queue.hpp
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Audio::detail {
+
+// Bounded single-producer/single-consumer ring. Push and Pop never take a lock; when the ring is
+// full (backpressure) or empty they spin briefly and then block on an atomic wait. Close ends the
+// stream once drained; Cancel wakes and stops both sides immediately, e.g. after an error.
+template <typename T> class SpscQueue {
+  public:
+    explicit SpscQueue(const std::size_t capacity)
+        : m_slots(std::bit_ceil((std::max)(capacity, std::size_t{2}))), m_mask(m_slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Returns false if the queue was cancelled; the value is dropped then.
+    bool Push(T value) {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (!Await([&] { return tail - m_head.load(std::memory_order_acquire) < m_slots.size(); }))
+            return false;
+
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        Signal();
+        return true;
+    }
+
+    // Returns nullopt once the queue is closed and drained, or cancelled.
+    std::optional<T> Pop() {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        const auto ready = [&] { return m_tail.load(std::memory_order_acquire) != head; };
+        if (!Await([&] { return ready() || m_closed.load(std::memory_order_acquire); }) || !ready())
+            return std::nullopt;
+
+        std::optional<T> value(std::move(m_slots[head & m_mask]));
+        m_slots[head & m_mask] = T{};
+        m_head.store(head + 1, std::memory_order_release);
+        Signal();
+        return value;
+    }
+
+    void Close() {
+        m_closed.store(true, std::memory_order_release);
+        Signal();
+    }
+
+    void Cancel() {
+        m_cancelled.store(true, std::memory_order_release);
+        Signal();
+    }
+
+    [[nodiscard]] bool Cancelled() const {
+        return m_cancelled.load(std::memory_order_acquire);
+    }
+
+  private:
+    template <typename Ready> bool Await(Ready &&ready) {
+        constexpr int kSpins = 64;
+        for (int spin = 0;; ++spin) {
+            const auto seen = m_signal.load(std::memory_order_acquire);
+            if (Cancelled())
+                return false;
+            if (ready())
+                return true;
+            if (spin >= kSpins) {
+                // Announce the waiter before the wait re-checks `seen`, so a concurrent Signal either
+                // sees it and notifies, or has already changed the value and the wait returns.
+                m_waiters.fetch_add(1);
+                m_signal.wait(seen);
+                m_waiters.fetch_sub(1);
+            }
+        }
+    }
+
+    void Signal() {
+        m_signal.fetch_add(1);
+        if (m_waiters.load() > 0) {
+            m_signal.notify_all();
+        }
+    }
+
+    std::vector<T> m_slots;
+    std::size_t m_mask;
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    alignas(64) std::atomic<uint32_t> m_signal{0};
+    std::atomic<uint32_t> m_waiters{0};
+    std::atomic<bool> m_closed{false};
+    std::atomic<bool> m_cancelled{false};
+};
+
+} // namespace Audio::detail
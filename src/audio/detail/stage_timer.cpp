@@ -0,0 +1,54 @@
+// src/audio/detail/stage_timer.cpp
+#include "audio/detail/stage_timer.hpp"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace Audio::detail {
+
+double ProcessCpuSeconds() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0.0;
+    const auto ticks = [](const FILETIME &t) {
+        return (static_cast<unsigned long long>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+    };
+    return static_cast<double>(ticks(kernel) + ticks(user)) * 1e-7;
+#else
+    timespec ts{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+StageTimer::StageTimer(StageTiming *into) : m_into(into) {
+    if (m_into) {
+        m_wall = std::chrono::steady_clock::now();
+        m_cpu = ProcessCpuSeconds();
+    }
+}
+
+StageTimer::~StageTimer() {
+    Stop();
+}
+
+void StageTimer::Stop() {
+    if (!m_into)
+        return;
+    m_into->WallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wall).count();
+    m_into->CpuSeconds += ProcessCpuSeconds() - m_cpu;
+    m_into = nullptr;
+}
+
+} // namespace Audio::detail
@@ -0,0 +1,31 @@
+// src/audio/detail/stage_timer.hpp
+#pragma once
+
+#include "audio/audio.hpp"
+
+#include <chrono>
+
+namespace Audio::detail {
+
+// CPU time consumed so far by every thread of the process, in seconds.
+double ProcessCpuSeconds();
+
+// Adds the wall and process CPU time between construction and Stop (or destruction) to a
+// StageTiming. Does nothing when the target is null, so callers can time unconditionally.
+class StageTimer {
+  public:
+    explicit StageTimer(StageTiming *into);
+    ~StageTimer();
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+    void Stop();
+
+  private:
+    StageTiming *m_into;
+    std::chrono::steady_clock::time_point m_wall;
+    double m_cpu = 0.0;
+};
+
+} // namespace Audio::detail
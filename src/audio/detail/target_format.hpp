@@ -25,6 +25,8 @@ struct TargetFormat {
     double LoudnessRangeTolerance; // LU
     double GainTolerance;          // dB
     double OffsetTolerance;        // seconds
+
+    ResampleQuality Resampler;
 };
 
 inline AVCodecID CodecIdForSampleFormat(const AVSampleFormat sampleFormat) {
@@ -60,6 +62,7 @@ inline TargetFormat MakeTargetFormat(const NormalizeOptions &options) {
         options.LoudnessRangeTolerance,
         options.GainTolerance,
         options.OffsetTolerance,
+        options.Resampler,
     };
 }
 
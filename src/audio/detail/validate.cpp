@@ -0,0 +1,70 @@
+// src/audio/detail/validate.cpp
+#include "audio/detail/validate.hpp"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/error.h>
+}
+
+#include "audio/detail/error.hpp"
+#include "audio/detail/format.hpp"
+
+#include <exception>
+
+namespace Audio::detail {
+
+AVFormatInputContextPtr OpenHeaderOnly(AudioInput &input, const int64_t probeSize) {
+    ProbeSettings probe;
+    probe.ProbeSize = probeSize;
+    probe.HeaderOnly = true;
+    if (!input.InMemory()) {
+        probe.Format = FindInputFormatByExtension(input.Name());
+    }
+    if (probe.Format) {
+        try {
+            return input.Open(probe);
+        } catch (const std::exception &) {
+            probe.Format = nullptr;
+        }
+    }
+    return input.Open(probe);
+}
+
+void DecodeAll(const AVFormatInputContextPtr &ctx, const AVStream *st, const fs::path &name) {
+    const auto dctx = OpenDecoder(st, AV_EF_CRCCHECK | AV_EF_BITSTREAM | AV_EF_EXPLODE);
+
+    const AVPacketPtr pkt(av_packet_alloc());
+    const AVFramePtr frame(av_frame_alloc());
+    av::Require(pkt.get() && frame.get(), "Failed to allocate packet or frame");
+
+    const auto drain = [&] {
+        for (;;) {
+            const auto ret = avcodec_receive_frame(dctx.get(), frame.get());
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+                return;
+            av::Check(ret, name, "Failed to decode audio");
+            av_frame_unref(frame.get());
+        }
+    };
+
+    for (;;) {
+        const auto ret = av_read_frame(ctx.get(), pkt.get());
+        if (ret == AVERROR_EOF)
+            break;
+        av::Check(ret, name, "Failed to read packet");
+        if (pkt->stream_index == st->index) {
+            if (pkt->flags & AV_PKT_FLAG_CORRUPT) {
+                throw lib::FileError(name, "Corrupt packet in audio stream");
+            }
+            const auto sent = avcodec_send_packet(dctx.get(), pkt.get());
+            av::Check(sent, name, "Failed to decode audio");
+            drain();
+        }
+        av_packet_unref(pkt.get());
+    }
+    const auto ret = avcodec_send_packet(dctx.get(), nullptr);
+    av::Check(ret, name, "Failed to flush decoder");
+    drain();
+}
+
+} // namespace Audio::detail
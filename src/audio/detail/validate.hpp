@@ -0,0 +1,26 @@
+// src/audio/detail/validate.hpp
+#pragma once
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include "audio/detail/io.hpp"
+#include "audio/detail/raii.hpp"
+
+#include <cstdint>
+
+namespace Audio::detail {
+
+// Opens `input` reading as little as possible: the demuxer is taken from the file extension rather
+// than probed, at most `probeSize` bytes are read to find the streams, and stream discovery stops at
+// the header when it already describes an audio stream. An extension that names the wrong format
+// falls back to probing rather than failing.
+AVFormatInputContextPtr OpenHeaderOnly(AudioInput &input, int64_t probeSize);
+
+// Demuxes and decodes every packet of `st`, throwing on the first read error, packet flagged as
+// corrupt or decoding error, with the decoder told to fail on CRC mismatches and bitstream errors
+// instead of concealing them.
+void DecodeAll(const AVFormatInputContextPtr &ctx, const AVStream *st, const fs::path &name);
+
+} // namespace Audio::detail
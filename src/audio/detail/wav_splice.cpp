@@ -0,0 +1,114 @@
+// src/audio/detail/wav_splice.cpp
+#include "audio/detail/wav_splice.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace Audio::detail {
+
+namespace {
+
+constexpr uint32_t kUnknownSize = 0xFFFFFFFFu;
+
+bool IsTag(const uint8_t *bytes, const char *tag) {
+    return std::memcmp(bytes, tag, 4) == 0;
+}
+
+uint64_t ReadLe(const uint8_t *bytes, const int size) {
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+// `readAt(position, out, count)` fills `out` with `count` bytes at `position`, returning false if
+// they are not all there.
+template <typename ReadAt> std::optional<WavDataRegion> FindDataChunk(ReadAt &&readAt, const uint64_t size) {
+    uint8_t head[12];
+    if (!readAt(0, head, sizeof(head)))
+        return std::nullopt;
+    const bool rf64 = IsTag(head, "RF64");
+    if ((!rf64 && !IsTag(head, "RIFF")) || !IsTag(head + 8, "WAVE"))
+        return std::nullopt;
+
+    uint64_t ds64DataSize = 0;
+    for (uint64_t pos = 12; pos + 8 <= size;) {
+        uint8_t chunk[8];
+        if (!readAt(pos, chunk, sizeof(chunk)))
+            return std::nullopt;
+        uint64_t chunkSize = ReadLe(chunk + 4, 4);
+
+        if (rf64 && IsTag(chunk, "ds64")) {
+            uint8_t ds64[16];
+            if (!readAt(pos + 8, ds64, sizeof(ds64)))
+                return std::nullopt;
+            ds64DataSize = ReadLe(ds64 + 8, 8);
+        } else if (IsTag(chunk, "data")) {
+            const uint64_t offset = pos + 8;
+            if (rf64 && chunkSize == kUnknownSize) {
+                chunkSize = ds64DataSize;
+            } else if (!rf64 && (chunkSize == 0 || chunkSize == kUnknownSize)) {
+                // Written by a streaming muxer that never came back to patch the size.
+                chunkSize = size - offset;
+            }
+            return WavDataRegion{offset, (std::min)(chunkSize, size - offset)};
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+std::optional<WavDataRegion> FindWavData(const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw lib::FileError(path, "Failed to open input");
+    }
+    const auto size = static_cast<uint64_t>(fs::file_size(path));
+    return FindDataChunk(
+        [&](const uint64_t position, uint8_t *out, const std::size_t count) {
+            return static_cast<bool>(in.seekg(static_cast<std::streamoff>(position)) &&
+                                     in.read(reinterpret_cast<char *>(out), static_cast<std::streamsize>(count)));
+        },
+        size);
+}
+
+std::optional<WavDataRegion> FindWavData(const std::span<const uint8_t> bytes) {
+    return FindDataChunk(
+        [&](const uint64_t position, uint8_t *out, const std::size_t count) {
+            if (position + count > bytes.size())
+                return false;
+            std::memcpy(out, bytes.data() + position, count);
+            return true;
+        },
+        bytes.size());
+}
+
+bool SpliceWav(AudioInput &src, AudioOutput &dst, const WavFormat &format, const int64_t offsetSamples) {
+    const auto region = src.InMemory() ? FindWavData(src.Bytes()) : FindWavData(src.Name());
+    if (!region)
+        return false;
+
+    const auto blockAlign = static_cast<uint64_t>(av_get_bytes_per_sample(format.SampleFormat)) * format.Channels;
+    const auto frames = static_cast<int64_t>(region->Size / blockAlign);
+    const int64_t lead = (std::max)(offsetSamples, int64_t{0});
+    const int64_t skip = (std::min)((std::max)(-offsetSamples, int64_t{0}), frames);
+
+    const auto writer = dst.Open(format, lead + frames - skip);
+    writer->WriteSilence(lead);
+
+    const uint64_t from = region->Offset + static_cast<uint64_t>(skip) * blockAlign;
+    const uint64_t bytes = static_cast<uint64_t>(frames - skip) * blockAlign;
+    if (src.InMemory()) {
+        writer->Write(src.Bytes().subspan(static_cast<std::size_t>(from), static_cast<std::size_t>(bytes)));
+    } else {
+        writer->Append(src.Name(), from, bytes);
+    }
+    writer->Finish();
+    return true;
+}
+
+} // namespace Audio::detail
@@ -0,0 +1,32 @@
+// src/audio/detail/wav_splice.hpp
+#pragma once
+
+#include "audio/detail/io.hpp"
+#include "audio/detail/wav_writer.hpp"
+#include "lib.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace Audio::detail {
+
+// Byte range of the sample data in a RIFF or RF64 WAV file.
+struct WavDataRegion {
+    uint64_t Offset;
+    uint64_t Size;
+};
+
+// Locates the first data chunk by walking the RIFF chunk list. Returns nullopt when the input is
+// not a WAV file. Sizes are clamped to what is actually there, as FFmpeg's demuxer does for
+// truncated or streamed files.
+std::optional<WavDataRegion> FindWavData(const fs::path &path);
+std::optional<WavDataRegion> FindWavData(std::span<const uint8_t> bytes);
+
+// Writes `src` to `dst` shifted by `offsetSamples` (see OffsetSamples) without decoding: leading
+// silence for a positive offset, skipped bytes for a negative one, and the rest of the data copied
+// as is. The source must be a PCM WAV file whose samples are already in `format`. Returns false
+// when no data chunk is found, leaving `dst` untouched.
+bool SpliceWav(AudioInput &src, AudioOutput &dst, const WavFormat &format, int64_t offsetSamples);
+
+} // namespace Audio::detail
@@ -0,0 +1,449 @@
+// src/audio/detail/wav_writer.cpp
+#include "audio/detail/wav_writer.hpp"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+#include "audio/detail/error.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace Audio::detail {
+
+namespace {
+
+// Samples are written in blocks of this size. The header goes out with the first block, so every
+// write starts on a block boundary of the file.
+constexpr std::size_t kWriteBlock = std::size_t{1} << 20;
+
+// The RIFF header reserves room for an RF64 ds64 chunk as a JUNK chunk of the same size, so a
+// file that outgrows 4 GiB can be converted in place.
+constexpr uint32_t kDs64Size = 28;
+
+constexpr uint16_t kFormatPcm = 0x0001;
+constexpr uint16_t kFormatFloat = 0x0003;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+bool IsFloat(const AVSampleFormat format) {
+    return format == AV_SAMPLE_FMT_FLT || format == AV_SAMPLE_FMT_DBL;
+}
+
+// Same rule as FFmpeg's wav muxer, so readers see the layout they did before.
+bool IsExtensible(const WavFormat &format) {
+    return av_get_bytes_per_sample(format.SampleFormat) > 2 || format.SampleRate > 48000 || format.Channels > 2;
+}
+
+void PutTag(std::vector<uint8_t> &out, const char *tag) {
+    out.insert(out.end(), tag, tag + 4);
+}
+
+template <typename T> void PutLe(std::vector<uint8_t> &out, T value) {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+    }
+}
+
+std::vector<uint8_t> BuildHeader(const WavFormat &format, const uint64_t dataBytes) {
+    const auto bytesPerSample = static_cast<uint16_t>(av_get_bytes_per_sample(format.SampleFormat));
+    const auto blockAlign = static_cast<uint16_t>(bytesPerSample * format.Channels);
+    const bool extensible = IsExtensible(format);
+    const uint16_t tag = IsFloat(format.SampleFormat) ? kFormatFloat : kFormatPcm;
+    const uint32_t fmtSize = extensible ? 40 : 16;
+
+    const uint64_t headerSize = 12 + 8 + kDs64Size + 8 + fmtSize + 8;
+    const uint64_t padded = dataBytes + (dataBytes & 1);
+    const uint64_t riffSize = headerSize - 8 + padded;
+    const bool rf64 = riffSize > (std::numeric_limits<uint32_t>::max)();
+
+    std::vector<uint8_t> out;
+    out.reserve(headerSize);
+    PutTag(out, rf64 ? "RF64" : "RIFF");
+    PutLe<uint32_t>(out, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(riffSize));
+    PutTag(out, "WAVE");
+
+    PutTag(out, rf64 ? "ds64" : "JUNK");
+    PutLe<uint32_t>(out, kDs64Size);
+    if (rf64) {
+        PutLe<uint64_t>(out, riffSize);
+        PutLe<uint64_t>(out, dataBytes);
+        PutLe<uint64_t>(out, dataBytes / blockAlign);
+        PutLe<uint32_t>(out, 0); // no table entries
+    } else {
+        out.insert(out.end(), kDs64Size, 0);
+    }
+
+    PutTag(out, "fmt ");
+    PutLe<uint32_t>(out, fmtSize);
+    PutLe<uint16_t>(out, extensible ? kFormatExtensible : tag);
+    PutLe<uint16_t>(out, static_cast<uint16_t>(format.Channels));
+    PutLe<uint32_t>(out, static_cast<uint32_t>(format.SampleRate));
+    PutLe<uint32_t>(out, static_cast<uint32_t>(format.SampleRate) * blockAlign);
+    PutLe<uint16_t>(out, blockAlign);
+    PutLe<uint16_t>(out, static_cast<uint16_t>(bytesPerSample * 8));
+    if (extensible) {
+        AVChannelLayout layout{};
+        av_channel_layout_default(&layout, format.Channels);
+        const uint64_t mask = layout.order == AV_CHANNEL_ORDER_NATIVE ? layout.u.mask : 0;
+        av_channel_layout_uninit(&layout);
+
+        static constexpr uint8_t kSubFormatTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                                       0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+        PutLe<uint16_t>(out, 22);
+        PutLe<uint16_t>(out, static_cast<uint16_t>(bytesPerSample * 8));
+        PutLe<uint32_t>(out, static_cast<uint32_t>(mask));
+        PutLe<uint16_t>(out, tag);
+        out.insert(out.end(), std::begin(kSubFormatTail), std::end(kSubFormatTail));
+    }
+
+    PutTag(out, "data");
+    PutLe<uint32_t>(out, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(dataBytes));
+    return out;
+}
+
+#if !defined(_WIN32)
+struct FdGuard {
+    int Fd;
+    ~FdGuard() {
+        close(Fd);
+    }
+};
+#endif
+
+} // namespace
+
+class WavWriter::File {
+  public:
+    explicit File(const fs::path &path) : m_path(path) {
+#if defined(_WIN32)
+        m_file = CreateFileW(m_path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            throw lib::FileError(m_path, "Failed to create WAV output");
+        }
+#else
+        m_fd = open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            throw lib::FileError(m_path, "Failed to create WAV output");
+        }
+#endif
+    }
+
+    ~File() {
+#if defined(_WIN32)
+        CloseHandle(m_file);
+#else
+        close(m_fd);
+#endif
+    }
+
+    File(const File &) = delete;
+    File &operator=(const File &) = delete;
+
+    // Reserves disk space without changing the file size, so an overestimate leaves nothing
+    // behind. Best effort: a filesystem that cannot do it just allocates as the file grows.
+    void Reserve(const uint64_t bytes) {
+#if defined(_WIN32)
+        FILE_ALLOCATION_INFO info{};
+        info.AllocationSize.QuadPart = static_cast<LONGLONG>(bytes);
+        const bool ok = SetFileInformationByHandle(m_file, FileAllocationInfo, &info, sizeof(info));
+#elif defined(__linux__)
+        const bool ok = fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) == 0;
+#elif defined(__APPLE__)
+        fstore_t store{F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(bytes), 0};
+        const bool ok = fcntl(m_fd, F_PREALLOCATE, &store) != -1;
+#else
+        const bool ok = true;
+#endif
+        if (!ok) {
+            spdlog::debug("Could not preallocate {} bytes for {}", bytes, lib::PathToUtf8(m_path));
+        }
+    }
+
+    void Write(std::span<const uint8_t> bytes) {
+        while (!bytes.empty()) {
+#if defined(_WIN32)
+            const auto chunk = static_cast<DWORD>((std::min)(bytes.size(), std::size_t{1} << 30));
+            DWORD written = 0;
+            if (!WriteFile(m_file, bytes.data(), chunk, &written, nullptr)) {
+                throw lib::FileError(m_path, "Failed to write WAV output");
+            }
+#else
+            const auto written = write(m_fd, bytes.data(), bytes.size());
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw lib::FileError(m_path, "Failed to write WAV output");
+            }
+#endif
+            bytes = bytes.subspan(static_cast<std::size_t>(written));
+        }
+    }
+
+    // Writes `bytes` at `offset` without moving the append position. `what` names the bytes in
+    // the error message.
+    void WriteAt(const uint64_t offset, const std::span<const uint8_t> bytes, const char *what) {
+#if defined(_WIN32)
+        OVERLAPPED at{};
+        at.Offset = static_cast<DWORD>(offset);
+        at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        if (!WriteFile(m_file, bytes.data(), static_cast<DWORD>(bytes.size()), &written, &at) ||
+            written != bytes.size()) {
+            throw lib::FileError(m_path, fmt::format("Failed to write WAV {}", what));
+        }
+#else
+        std::size_t done = 0;
+        while (done < bytes.size()) {
+            const auto written =
+                pwrite(m_fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(offset + done));
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw lib::FileError(m_path, fmt::format("Failed to write WAV {}", what));
+            }
+            done += static_cast<std::size_t>(written);
+        }
+#endif
+    }
+
+    // Appends `bytes` bytes of `src` starting at `offset`.
+    void CopyFrom(const fs::path &src, uint64_t offset, uint64_t bytes) {
+#if defined(_WIN32)
+        const HANDLE in = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (in == INVALID_HANDLE_VALUE) {
+            throw lib::FileError(src, "Failed to open WAV source");
+        }
+        const std::unique_ptr<void, decltype(&CloseHandle)> guard(in, &CloseHandle);
+        LARGE_INTEGER position{};
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        if (!SetFilePointerEx(in, position, nullptr, FILE_BEGIN)) {
+            throw lib::FileError(src, "Failed to read WAV source");
+        }
+#else
+        const int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            throw lib::FileError(src, "Failed to open WAV source");
+        }
+        const FdGuard guard{in};
+#if defined(__linux__)
+        auto from = static_cast<off_t>(offset);
+        while (bytes > 0) {
+            const auto copied = copy_file_range(in, &from, m_fd, nullptr, (std::min)(bytes, uint64_t{1} << 30), 0);
+            if (copied < 0) {
+                if (errno == EINTR)
+                    continue;
+                // Not supported across these filesystems; copy through user space below.
+                if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)
+                    break;
+                throw lib::FileError(m_path, "Failed to copy WAV data");
+            }
+            if (copied == 0) {
+                throw lib::FileError(src, "Unexpected end of WAV source");
+            }
+            bytes -= static_cast<uint64_t>(copied);
+        }
+        offset = static_cast<uint64_t>(from);
+#endif
+#endif
+        std::vector<uint8_t> chunk(static_cast<std::size_t>((std::min)(bytes, uint64_t{kWriteBlock})));
+        while (bytes > 0) {
+            const auto want = static_cast<std::size_t>((std::min)(bytes, uint64_t{chunk.size()}));
+#if defined(_WIN32)
+            DWORD got = 0;
+            if (!ReadFile(in, chunk.data(), static_cast<DWORD>(want), &got, nullptr)) {
+                throw lib::FileError(src, "Failed to read WAV source");
+            }
+#else
+            const auto got = pread(in, chunk.data(), want, static_cast<off_t>(offset));
+            if (got < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw lib::FileError(src, "Failed to read WAV source");
+            }
+#endif
+            if (got == 0) {
+                throw lib::FileError(src, "Unexpected end of WAV source");
+            }
+            Write({chunk.data(), static_cast<std::size_t>(got)});
+            offset += static_cast<uint64_t>(got);
+            bytes -= static_cast<uint64_t>(got);
+        }
+    }
+
+  private:
+    fs::path m_path;
+#if defined(_WIN32)
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+#else
+    int m_fd = -1;
+#endif
+};
+
+WavWriter::WavWriter(const fs::path &path, const WavFormat &format, const int64_t expectedFrames)
+    : m_path(path), m_format(format),
+      m_blockAlign(static_cast<std::size_t>(av_get_bytes_per_sample(format.SampleFormat)) * format.Channels) {
+    av::Require(m_blockAlign > 0 && !av_sample_fmt_is_planar(format.SampleFormat),
+                "WAV output requires a packed sample format");
+    m_file = std::make_unique<File>(m_path);
+    if (expectedFrames > 0) {
+        m_file->Reserve(HeaderSize(format) + static_cast<uint64_t>(expectedFrames) * m_blockAlign);
+    }
+    m_buffer = BuildHeader(m_format, 0);
+    m_buffer.reserve(kWriteBlock);
+}
+
+WavWriter::WavWriter(std::vector<uint8_t> &bytes, const WavFormat &format, const int64_t expectedFrames)
+    : m_path("<memory>"), m_format(format),
+      m_blockAlign(static_cast<std::size_t>(av_get_bytes_per_sample(format.SampleFormat)) * format.Channels),
+      m_memory(&bytes) {
+    av::Require(m_blockAlign > 0 && !av_sample_fmt_is_planar(format.SampleFormat),
+                "WAV output requires a packed sample format");
+    m_memory->clear();
+    if (expectedFrames > 0) {
+        m_memory->reserve(HeaderSize(format) + static_cast<std::size_t>(expectedFrames) * m_blockAlign);
+    }
+    const auto header = BuildHeader(m_format, 0);
+    m_memory->insert(m_memory->end(), header.begin(), header.end());
+}
+
+WavWriter::~WavWriter() = default;
+
+std::size_t WavWriter::HeaderSize(const WavFormat &format) {
+    return 12 + 8 + kDs64Size + 8 + (IsExtensible(format) ? 40 : 16) + 8;
+}
+
+void WavWriter::Write(const AVFrame *frame) {
+    av::Require(frame->format == m_format.SampleFormat && frame->ch_layout.nb_channels == m_format.Channels,
+                "Audio frame does not match WAV output format");
+    Write({frame->data[0], static_cast<std::size_t>(frame->nb_samples) * m_blockAlign});
+}
+
+void WavWriter::Write(std::span<const uint8_t> samples) {
+    av::Require(!m_finished, "WAV output is already finished");
+    m_dataBytes += samples.size();
+    if (m_memory) {
+        m_memory->insert(m_memory->end(), samples.begin(), samples.end());
+        return;
+    }
+    while (!samples.empty()) {
+        const auto count = (std::min)(samples.size(), kWriteBlock - m_buffer.size());
+        m_buffer.insert(m_buffer.end(), samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(count));
+        samples = samples.subspan(count);
+        if (m_buffer.size() == kWriteBlock) {
+            Flush();
+        }
+    }
+}
+
+void WavWriter::WriteSilence(int64_t frames) {
+    // Unsigned 8-bit PCM is centred on 0x80; every other format is silent at zero.
+    const uint8_t silence = m_format.SampleFormat == AV_SAMPLE_FMT_U8 ? 0x80 : 0x00;
+    const std::vector<uint8_t> block(m_blockAlign * 4096, silence);
+    while (frames > 0) {
+        const auto count = (std::min)(frames, int64_t{4096});
+        Write(std::span(block).first(static_cast<std::size_t>(count) * m_blockAlign));
+        frames -= count;
+    }
+}
+
+void WavWriter::Append(const fs::path &src, const uint64_t offset, const uint64_t bytes) {
+    av::Require(!m_finished, "WAV output is already finished");
+    if (bytes == 0)
+        return;
+    if (m_memory) {
+        std::ifstream in(src, std::ios::binary);
+        const auto start = m_memory->size();
+        m_memory->resize(start + static_cast<std::size_t>(bytes));
+        if (!in.seekg(static_cast<std::streamoff>(offset)) ||
+            !in.read(reinterpret_cast<char *>(m_memory->data() + start), static_cast<std::streamsize>(bytes))) {
+            throw lib::FileError(src, "Failed to read WAV source");
+        }
+    } else {
+        Flush();
+        m_file->CopyFrom(src, offset, bytes);
+    }
+    m_dataBytes += bytes;
+}
+
+void WavWriter::WriteAt(const int64_t position, const std::span<const uint8_t> samples) {
+    const uint64_t begin = static_cast<uint64_t>(position) * m_blockAlign;
+    const uint64_t end = begin + samples.size();
+    std::unique_lock lock(m_mutex);
+    av::Require(!m_finished, "WAV output is already finished");
+    m_positional = true;
+    m_dataBytes = (std::max)(m_dataBytes, end);
+    if (m_memory) {
+        const std::size_t header = HeaderSize(m_format);
+        if (m_memory->size() < header + end) {
+            m_memory->resize(header + end);
+        }
+        std::memcpy(m_memory->data() + header + begin, samples.data(), samples.size());
+        return;
+    }
+    lock.unlock();
+    m_file->WriteAt(HeaderSize(m_format) + begin, samples, "sample data");
+}
+
+void WavWriter::Finish() {
+    if (m_finished)
+        return;
+    m_finished = true;
+    // RIFF chunks are word aligned; an odd-sized data chunk is followed by a pad byte.
+    static constexpr uint8_t kPad = 0;
+    const bool pad = m_dataBytes & 1;
+    if (m_memory) {
+        if (pad) {
+            m_memory->resize(HeaderSize(m_format) + m_dataBytes);
+            m_memory->push_back(kPad);
+        }
+    } else if (m_positional) {
+        // The samples are already in place; the buffer only holds the provisional header.
+        m_buffer.clear();
+        if (pad) {
+            m_file->WriteAt(HeaderSize(m_format) + m_dataBytes, {&kPad, 1}, "data padding");
+        }
+    } else if (pad) {
+        m_buffer.push_back(kPad);
+    }
+    Flush();
+    WriteHeader(m_dataBytes);
+}
+
+void WavWriter::WriteHeader(const uint64_t dataBytes) {
+    const auto header = BuildHeader(m_format, dataBytes);
+    if (m_memory) {
+        std::memcpy(m_memory->data(), header.data(), header.size());
+    } else {
+        m_file->WriteAt(0, header, "header");
+    }
+}
+
+void WavWriter::Flush() {
+    if (m_memory || m_buffer.empty())
+        return;
+    m_file->Write(m_buffer);
+    m_buffer.clear();
+}
+
+} // namespace Audio::detail
@@ -0,0 +1,86 @@
+// src/audio/detail/wav_writer.hpp
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include "lib.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace Audio::detail {
+
+struct WavFormat {
+    AVSampleFormat SampleFormat; // packed
+    int SampleRate;
+    int Channels;
+};
+
+// Writes interleaved PCM straight into a WAV file, without going through a PCM encoder and the
+// wav muxer. Samples are staged in a large buffer and written in aligned blocks; the file is
+// preallocated from the expected length and its header is patched once the real length is known,
+// switching to RF64 when the data outgrows the 4 GiB RIFF limit. Memory output appends to a
+// caller-owned vector instead.
+class WavWriter {
+  public:
+    // `expectedFrames` is only a hint for preallocation; 0 means unknown.
+    WavWriter(const fs::path &path, const WavFormat &format, int64_t expectedFrames);
+    WavWriter(std::vector<uint8_t> &bytes, const WavFormat &format, int64_t expectedFrames);
+    ~WavWriter();
+
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+
+    // Appends a packed frame in the writer's sample format and channel count.
+    void Write(const AVFrame *frame);
+    // Appends whole interleaved sample frames.
+    void Write(std::span<const uint8_t> samples);
+
+    // Appends `frames` frames of digital silence.
+    void WriteSilence(int64_t frames);
+    // Appends `bytes` bytes of interleaved samples read from `src` at `offset`. File to file copies
+    // stay in the kernel where the platform has copy_file_range.
+    void Append(const fs::path &src, uint64_t offset, uint64_t bytes);
+
+    // Writes whole interleaved frames starting at frame `position` of the data chunk, bypassing the
+    // sequential buffer. May be called from several threads for disjoint ranges; cannot be mixed
+    // with the sequential writes above.
+    void WriteAt(int64_t position, std::span<const uint8_t> samples);
+
+    // Flushes the buffered samples and patches the header. Nothing may be written afterwards.
+    void Finish();
+
+    [[nodiscard]] int64_t Frames() const {
+        return static_cast<int64_t>(m_dataBytes / m_blockAlign);
+    }
+
+    // Size of the header written in front of the sample data, in bytes.
+    [[nodiscard]] static std::size_t HeaderSize(const WavFormat &format);
+
+  private:
+    class File;
+
+    void WriteHeader(uint64_t dataBytes);
+    void Flush();
+
+    fs::path m_path;
+    WavFormat m_format;
+    std::size_t m_blockAlign;
+    uint64_t m_dataBytes = 0;
+    bool m_finished = false;
+    bool m_positional = false;
+    std::mutex m_mutex; // guards the positional state and memory output in WriteAt
+
+    std::unique_ptr<File> m_file;
+    std::vector<uint8_t> m_buffer;
+    std::vector<uint8_t> *m_memory = nullptr;
+};
+
+} // namespace Audio::detail
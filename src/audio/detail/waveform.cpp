@@ -0,0 +1,208 @@
+// src/audio/detail/waveform.cpp
+#include "audio/detail/waveform.hpp"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include "audio/audio.hpp"
+#include "audio/detail/error.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+
+namespace Audio::detail {
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "The waveform sidecar is written in host byte order");
+static_assert(sizeof(WaveformHeader) % 8 == 0 && sizeof(WaveformLevel) % 8 == 0);
+
+constexpr char kMagic[8] = {'M', 'U', 'A', 'W', 'A', 'V', 'E', '\0'};
+constexpr int kBaseBucketSamples = 256;
+constexpr int kLevelFactor = 4;
+constexpr int kLevels = 5; // 256 to 65536 samples per bucket
+constexpr uint32_t kLoudnessIntervalMs = 100;
+
+constexpr int16_t kEmptyMin = std::numeric_limits<int16_t>::max();
+constexpr int16_t kEmptyMax = std::numeric_limits<int16_t>::min();
+
+template <typename T> int16_t ToPeak(const T value) {
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        return static_cast<int16_t>((static_cast<int>(value) - 128) * 256);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<int16_t>(std::clamp(std::lround(value * 32768.0), -32768L, 32767L));
+    } else {
+        return static_cast<int16_t>(value >> (8 * (sizeof(T) - sizeof(int16_t))));
+    }
+}
+
+uint64_t AlignUp(const uint64_t value) {
+    return (value + 7) & ~uint64_t{7};
+}
+
+AVChannelLayout DefaultLayout(const int channels) {
+    AVChannelLayout layout{};
+    av_channel_layout_default(&layout, channels);
+    return layout;
+}
+
+} // namespace
+
+WaveformBuilder::WaveformBuilder(const int sampleRate, const int channels)
+    : m_sampleRate(sampleRate), m_channels(channels), m_meter(sampleRate, DefaultLayout(channels), false),
+      m_bucket(static_cast<size_t>(channels) * 2) {
+    for (int c = 0; c < m_channels; ++c) {
+        m_bucket[c * 2] = kEmptyMin;
+        m_bucket[c * 2 + 1] = kEmptyMax;
+    }
+}
+
+void WaveformBuilder::Add(const AVFrame *frame) {
+    av::Require(frame->ch_layout.nb_channels == m_channels, "Waveform frame has {} channels, expected {}",
+                frame->ch_layout.nb_channels, m_channels);
+    m_meter.Add(frame);
+
+    switch (av_get_packed_sample_fmt(static_cast<AVSampleFormat>(frame->format))) {
+    case AV_SAMPLE_FMT_U8:
+        AddPeaks<uint8_t>(frame);
+        break;
+    case AV_SAMPLE_FMT_S16:
+        AddPeaks<int16_t>(frame);
+        break;
+    case AV_SAMPLE_FMT_S32:
+        AddPeaks<int32_t>(frame);
+        break;
+    case AV_SAMPLE_FMT_S64:
+        AddPeaks<int64_t>(frame);
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        AddPeaks<float>(frame);
+        break;
+    case AV_SAMPLE_FMT_DBL:
+        AddPeaks<double>(frame);
+        break;
+    default:
+        av::Require(false, "Unsupported sample format for waveform: {}", frame->format);
+    }
+    m_frames += static_cast<uint64_t>(frame->nb_samples);
+}
+
+template <typename T> void WaveformBuilder::AddPeaks(const AVFrame *frame) {
+    const bool planar = av_sample_fmt_is_planar(static_cast<AVSampleFormat>(frame->format));
+    const size_t step = planar ? 1 : static_cast<size_t>(m_channels);
+
+    for (int begin = 0; begin < frame->nb_samples;) {
+        const int count = (std::min)(frame->nb_samples - begin, kBaseBucketSamples - m_bucketFill);
+        for (int c = 0; c < m_channels; ++c) {
+            const T *src = planar ? reinterpret_cast<const T *>(frame->extended_data[c]) + begin
+                                  : reinterpret_cast<const T *>(frame->extended_data[0]) +
+                                        static_cast<size_t>(begin) * m_channels + c;
+            int16_t lo = m_bucket[c * 2];
+            int16_t hi = m_bucket[c * 2 + 1];
+            for (int i = 0; i < count; ++i) {
+                const int16_t v = ToPeak(src[static_cast<size_t>(i) * step]);
+                lo = (std::min)(lo, v);
+                hi = (std::max)(hi, v);
+            }
+            m_bucket[c * 2] = lo;
+            m_bucket[c * 2 + 1] = hi;
+        }
+        begin += count;
+        m_bucketFill += count;
+        if (m_bucketFill == kBaseBucketSamples) {
+            m_peaks.insert(m_peaks.end(), m_bucket.begin(), m_bucket.end());
+            for (int c = 0; c < m_channels; ++c) {
+                m_bucket[c * 2] = kEmptyMin;
+                m_bucket[c * 2 + 1] = kEmptyMax;
+            }
+            m_bucketFill = 0;
+        }
+    }
+}
+
+void WaveformBuilder::Write(const fs::path &path) const {
+    const size_t pair = static_cast<size_t>(m_channels) * 2;
+
+    std::vector<std::vector<int16_t>> levels(kLevels);
+    levels[0] = m_peaks;
+    if (m_bucketFill > 0) {
+        levels[0].insert(levels[0].end(), m_bucket.begin(), m_bucket.end());
+    }
+    for (int level = 1; level < kLevels; ++level) {
+        const auto &finer = levels[level - 1];
+        auto &coarser = levels[level];
+        const size_t buckets = (finer.size() / pair + kLevelFactor - 1) / kLevelFactor;
+        coarser.assign(buckets * pair, 0);
+        for (size_t b = 0; b < buckets; ++b) {
+            for (size_t c = 0; c < pair; c += 2) {
+                int16_t lo = kEmptyMin;
+                int16_t hi = kEmptyMax;
+                for (size_t f = b * kLevelFactor; f < (std::min)((b + 1) * kLevelFactor, finer.size() / pair); ++f) {
+                    lo = (std::min)(lo, finer[f * pair + c]);
+                    hi = (std::max)(hi, finer[f * pair + c + 1]);
+                }
+                coarser[b * pair + c] = lo;
+                coarser[b * pair + c + 1] = hi;
+            }
+        }
+    }
+    const auto loudness = m_meter.Momentary();
+
+    WaveformHeader header{};
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = kWaveformVersion;
+    header.SampleRate = static_cast<uint32_t>(m_sampleRate);
+    header.Channels = static_cast<uint32_t>(m_channels);
+    header.LevelCount = kLevels;
+    header.Frames = m_frames;
+    header.LoudnessIntervalMs = kLoudnessIntervalMs;
+
+    std::vector<WaveformLevel> entries(kLevels);
+    uint64_t offset = sizeof(WaveformHeader) + sizeof(WaveformLevel) * kLevels;
+    for (int level = 0; level < kLevels; ++level) {
+        auto &entry = entries[level];
+        entry.SamplesPerBucket = kBaseBucketSamples;
+        for (int k = 0; k < level; ++k) {
+            entry.SamplesPerBucket *= kLevelFactor;
+        }
+        entry.Offset = offset;
+        entry.Buckets = levels[level].size() / pair;
+        offset = AlignUp(offset + levels[level].size() * sizeof(int16_t));
+    }
+    header.LoudnessOffset = offset;
+    header.LoudnessCount = loudness.size();
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw lib::FileError(path, "Failed to open waveform sidecar");
+    }
+    const auto write = [&](const void *data, const size_t size) {
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    };
+    const auto pad = [&] {
+        static constexpr char zeros[8] = {};
+        const auto position = static_cast<uint64_t>(out.tellp());
+        write(zeros, static_cast<size_t>(AlignUp(position) - position));
+    };
+
+    write(&header, sizeof(header));
+    write(entries.data(), entries.size() * sizeof(WaveformLevel));
+    for (const auto &level : levels) {
+        write(level.data(), level.size() * sizeof(int16_t));
+        pad();
+    }
+    write(loudness.data(), loudness.size() * sizeof(float));
+    pad();
+    if (!out.flush()) {
+        throw lib::FileError(path, "Failed to write waveform sidecar");
+    }
+}
+
+} // namespace Audio::detail
@@ -0,0 +1,42 @@
+// src/audio/detail/waveform.hpp
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include "audio/detail/meter.hpp"
+#include "lib.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Audio::detail {
+
+// Collects the waveform sidecar of an output (see Audio::WaveformHeader) from the frames written to
+// it: min/max peaks per 256 samples, merged into coarser zoom levels four at a time, and the
+// momentary loudness every 100 ms from a loudness meter fed the same frames.
+class WaveformBuilder {
+  public:
+    WaveformBuilder(int sampleRate, int channels);
+
+    // Accepts packed or planar frames in any integer or floating point sample format.
+    void Add(const AVFrame *frame);
+
+    void Write(const fs::path &path) const;
+
+  private:
+    template <typename T> void AddPeaks(const AVFrame *frame);
+
+    int m_sampleRate;
+    int m_channels;
+    LoudnessMeter m_meter;
+
+    // {min, max} per channel of each complete base bucket, then of the bucket being filled.
+    std::vector<int16_t> m_peaks;
+    std::vector<int16_t> m_bucket;
+    int m_bucketFill = 0;
+    uint64_t m_frames = 0;
+};
+
+} // namespace Audio::detail
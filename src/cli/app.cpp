@@ -6,10 +6,24 @@
 
 #include <CLI/CLI.hpp>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 namespace {
 
@@ -21,19 +35,48 @@ struct AudioNormalizeOpts {
     fs::path src, dst;
     Audio::NormalizeOptions options;
     std::string sample_format = av_get_sample_fmt_name(Audio::NormalizeOptions{}.SampleFormat);
-} audio_normalize_opts;
+    std::string resampler = "default";
+    bool decode_twice = false;
+    fs::path cache;
+    fs::path stats_json;
+} audio_normalize_opts, audio_normalize_batch_opts, audio_preview_normalize_opts, audio_plan_normalize_opts;
+
+struct AudioPlanOpts {
+    bool json = false;
+} audio_plan_opts;
+
+struct AudioPreviewOpts {
+    Audio::PreviewOptions preview;
+} audio_preview_opts;
+
+struct AudioBatchOpts {
+    fs::path list;
+    unsigned threads = 0;
+} audio_batch_opts;
 
 struct SrcOnlyOpts {
     fs::path src;
-} audio_ensure_valid_opts, image_ensure_valid_opts;
+} image_ensure_valid_opts;
+
+struct AudioCheckOpts {
+    fs::path src, list;
+    std::string mode = "standard";
+    unsigned threads = 0;
+} audio_ensure_valid_opts;
 
 struct SrcDstOpts {
     fs::path src, dst;
-} convert_jacket_opts, extract_dds_opts;
+} extract_dds_opts;
+
+struct ConvertJacketOpts {
+    fs::path src, dst;
+    std::string encoder = "directxtex";
+} convert_jacket_opts;
 
 struct ConvertStageOpts {
     fs::path bg, stsrc, stdst;
     std::array<fs::path, 4> fx{};
+    std::string encoder = "directxtex";
 } convert_stage_opts;
 
 AVSampleFormat ParseSampleFormat(const std::string &name) {
@@ -44,6 +87,274 @@ AVSampleFormat ParseSampleFormat(const std::string &name) {
     return sampleFormat;
 }
 
+Audio::ValidateMode ParseValidateMode(const std::string &name) {
+    if (name == "fast")
+        return Audio::ValidateMode::Fast;
+    if (name == "standard")
+        return Audio::ValidateMode::Standard;
+    if (name == "deep")
+        return Audio::ValidateMode::Deep;
+    throw std::runtime_error(fmt::format("Unknown validation mode: {}", name));
+}
+
+Audio::ResampleQuality ParseResampleQuality(const std::string &name) {
+    if (name == "fast")
+        return Audio::ResampleQuality::Fast;
+    if (name == "default")
+        return Audio::ResampleQuality::Default;
+    if (name == "high")
+        return Audio::ResampleQuality::High;
+    throw std::runtime_error(fmt::format("Unknown resampler preset: {}", name));
+}
+
+Image::DdsEncoder ParseDdsEncoder(const std::string &name) {
+    if (name == "directxtex")
+        return Image::DdsEncoder::DirectXTex;
+    if (name == "fast")
+        return Image::DdsEncoder::Fast;
+    if (name == "high")
+        return Image::DdsEncoder::High;
+    throw std::runtime_error(fmt::format("Unknown DDS encoder: {}", name));
+}
+
+void AddNormalizeOptions(CLI::App *cmd, AudioNormalizeOpts &opts) {
+    cmd->add_option("--sample-format", opts.sample_format, "sample format (u8, s16, s32, s64, flt, dbl)")
+        ->default_val(opts.sample_format);
+    cmd->add_option("--sample-rate", opts.options.SampleRate, "sample rate (Hz)")->check(CLI::PositiveNumber);
+    cmd->add_option("--resampler", opts.resampler, "resampler preset (fast, default, high)")
+        ->default_val(opts.resampler);
+    cmd->add_option("--lufs", opts.options.Loudness, "target loudness (LUFS)");
+    cmd->add_option("--lu", opts.options.LoudnessRange, "target loudness range (LU)");
+    cmd->add_option("--dbtp", opts.options.TruePeak, "target true peak (dBTP)");
+    cmd->add_option("--true-peak-tolerance", opts.options.TruePeakTolerance, "true peak tolerance (dB)")
+        ->check(CLI::NonNegativeNumber);
+    cmd->add_option("--lu-tolerance", opts.options.LoudnessRangeTolerance, "loudness range tolerance (LU)")
+        ->check(CLI::NonNegativeNumber);
+    cmd->add_option("--gain-tolerance", opts.options.GainTolerance, "gain tolerance (dB)")
+        ->check(CLI::NonNegativeNumber);
+    cmd->add_option("--offset-tolerance", opts.options.OffsetTolerance, "offset tolerance (s)")
+        ->check(CLI::NonNegativeNumber);
+    cmd->add_flag("--decode-twice", opts.decode_twice,
+                  "decode the source again for the second pass instead of reusing first-pass PCM");
+    cmd->add_option("--decode-memory", opts.options.DecodedAudioMemoryLimit,
+                    "decoded PCM kept in memory before spilling to a temporary file (bytes)");
+    cmd->add_option("--cache", opts.cache, "loudness analysis cache file, created if missing");
+    cmd->add_flag("--pipelined", opts.options.Pipelined, "decode, filter and encode on separate threads");
+    cmd->add_option("--analysis-threads", opts.options.AnalysisThreads,
+                    "measure long PCM/FLAC inputs in this many parallel segments (0: one per core)");
+    cmd->add_option("--render-threads", opts.options.RenderThreads,
+                    "render linear-gain second passes of long PCM/FLAC inputs in parallel segments");
+}
+
+Audio::NormalizeOptions ResolveNormalizeOptions(const AudioNormalizeOpts &opts) {
+    auto options = opts.options;
+    options.SampleFormat = ParseSampleFormat(opts.sample_format);
+    options.Resampler = ParseResampleQuality(opts.resampler);
+    options.ReuseDecodedAudio = !opts.decode_twice;
+    return options;
+}
+
+fs::path Utf8ToPath(const std::string_view text) {
+    return fs::path(std::u8string(reinterpret_cast<const char8_t *>(text.data()), text.size()));
+}
+
+// One path per line, UTF-8. Blank lines and lines starting with '#' are skipped.
+std::vector<fs::path> ReadPathList(const fs::path &list) {
+    std::ifstream in(list, std::ios::binary);
+    if (!in) {
+        throw lib::FileError(list, "Failed to open path list");
+    }
+
+    std::vector<fs::path> paths;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line.front() == '#')
+            continue;
+        paths.push_back(Utf8ToPath(line));
+    }
+    return paths;
+}
+
+// One job per line: `src<TAB>dst[<TAB>offset]`, UTF-8. Blank lines and lines starting with '#' are
+// skipped.
+std::vector<Audio::NormalizeJob> ReadNormalizeJobs(const fs::path &list, const Audio::NormalizeOptions &options) {
+    std::ifstream in(list, std::ios::binary);
+    if (!in) {
+        throw lib::FileError(list, "Failed to open batch list");
+    }
+
+    std::vector<Audio::NormalizeJob> jobs;
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        const auto first = line.find('\t');
+        if (first == std::string::npos) {
+            throw lib::FileError(list, fmt::format("Expected src<TAB>dst on line {}", number));
+        }
+        const auto second = line.find('\t', first + 1);
+
+        Audio::NormalizeJob job{Utf8ToPath(std::string_view(line).substr(0, first)),
+                                Utf8ToPath(std::string_view(line).substr(first + 1, second - first - 1)), options};
+        if (second != std::string::npos) {
+            job.Options.Offset = std::stod(line.substr(second + 1));
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+// "-" as a path stands for stdin or stdout. Pipes are not seekable, so stdin is read into memory
+// and output is assembled in memory before it is written out.
+bool IsStdio(const fs::path &path) {
+    return path == "-";
+}
+
+void SetBinaryMode(std::FILE *stream) {
+#if defined(_WIN32)
+    _setmode(_fileno(stream), _O_BINARY);
+#else
+    (void)stream;
+#endif
+}
+
+std::vector<uint8_t> ReadAll(const fs::path &path) {
+    std::vector<uint8_t> bytes;
+    if (!IsStdio(path)) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw lib::FileError(path, "Failed to open input");
+        }
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+        return bytes;
+    }
+
+    SetBinaryMode(stdin);
+    std::array<uint8_t, 64 * 1024> chunk{};
+    for (size_t got; (got = std::fread(chunk.data(), 1, chunk.size(), stdin)) > 0;) {
+        bytes.insert(bytes.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(got));
+    }
+    if (std::ferror(stdin)) {
+        throw std::runtime_error("Failed to read from stdin");
+    }
+    return bytes;
+}
+
+void WriteAll(const fs::path &path, const std::vector<uint8_t> &bytes) {
+    if (!IsStdio(path)) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            throw lib::FileError(path, "Failed to write output");
+        }
+        return;
+    }
+
+    SetBinaryMode(stdout);
+    if (std::fwrite(bytes.data(), 1, bytes.size(), stdout) != bytes.size() || std::fflush(stdout) != 0) {
+        throw std::runtime_error("Failed to write to stdout");
+    }
+}
+
+// JSON has no infinities or NaN (what silent input measures as, for instance), so those become null.
+std::string JsonNumber(const double value) {
+    return std::isfinite(value) ? fmt::format("{}", value) : "null";
+}
+
+// Codec and route names are plain identifiers, so no string escaping is needed.
+void WriteStatsJson(const fs::path &path, const Audio::NormalizeStats &stats) {
+    const auto stage = [](const Audio::StageTiming &timing) {
+        return fmt::format(R"({{"wall_seconds": {}, "cpu_seconds": {}}})", JsonNumber(timing.WallSeconds),
+                           JsonNumber(timing.CpuSeconds));
+    };
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw lib::FileError(path, "Failed to open stats file");
+    }
+    out << "{\n"
+        << fmt::format(R"(  "stages": {{"open": {}, "analysis": {}, "seek": {}, "render": {}, "total": {}}},)",
+                       stage(stats.Open), stage(stats.Analysis), stage(stats.Seek), stage(stats.Render),
+                       stage(stats.Total))
+        << "\n"
+        << fmt::format(R"(  "render_split": {{"decode_seconds": {}, "filter_seconds": {}, "write_seconds": {}}},)",
+                       JsonNumber(stats.DecodeSeconds), JsonNumber(stats.FilterSeconds),
+                       JsonNumber(stats.WriteSeconds))
+        << "\n"
+        << fmt::format(R"(  "bytes_read": {}, "bytes_written": {}, "input_frames": {}, "input_seconds": {},)",
+                       stats.BytesRead, stats.BytesWritten, stats.InputFrames, JsonNumber(stats.InputSeconds))
+        << "\n"
+        << fmt::format(R"(  "realtime_factor": {}, "codec": "{}", "cache_hit": {}, "route": "{}",)",
+                       JsonNumber(stats.RealtimeFactor), stats.Codec, stats.CacheHit, stats.Route)
+        << "\n"
+        << fmt::format(R"(  "plan": {{"transform": {}, "format": {}, "channels": {}, "loudnorm": {}, "offset": {},)",
+                       stats.NeedTransform, stats.NeedFormat, stats.NeedChannels, stats.NeedLoudNorm,
+                       stats.NeedOffset)
+        << fmt::format(R"( "linear_gain": {}, "gain_db": {}}})", stats.LinearGain, JsonNumber(stats.GainDb))
+        << "\n}\n";
+    if (!out) {
+        throw lib::FileError(path, "Failed to write stats file");
+    }
+}
+
+void PrintPlan(const Audio::PlanResult &plan, const bool json) {
+    if (!json) {
+        std::cout << fmt::format("source: {} {} {} Hz {} ch, {:.2f} s\n", plan.Codec, plan.SampleFormat,
+                                 plan.SampleRate, plan.Channels, plan.DurationSeconds)
+                  << fmt::format("loudness: I={:.2f} LUFS TP={:.2f} dBTP LRA={:.2f} LU threshold={:.2f} LUFS{}\n",
+                                 plan.Loudness, plan.TruePeak, plan.LoudnessRange, plan.Threshold,
+                                 plan.CacheHit ? " (cached)" : "");
+        if (plan.Noop()) {
+            std::cout << "plan: unchanged\n";
+            return;
+        }
+        std::cout << "plan:";
+        for (const auto &[need, name] : {std::pair{plan.NeedTransform, "transform"}, {plan.NeedFormat, "format"},
+                                         {plan.NeedChannels, "channels"}, {plan.NeedLoudNorm, "loudnorm"},
+                                         {plan.NeedOffset, "offset"}}) {
+            if (need)
+                std::cout << ' ' << name;
+        }
+        if (plan.LinearGain)
+            std::cout << fmt::format(" (linear gain {:.2f} dB)", plan.GainDb);
+        std::cout << '\n';
+        return;
+    }
+
+    // Codec and sample format names are plain identifiers, so no string escaping is needed.
+    std::cout << "{\n"
+              << fmt::format(R"(  "codec": "{}", "sample_format": "{}", "sample_rate": {}, "channels": {},)",
+                             plan.Codec, plan.SampleFormat, plan.SampleRate, plan.Channels)
+              << "\n"
+              << fmt::format(R"(  "duration_seconds": {}, "loudness": {}, "true_peak": {}, "loudness_range": {},)",
+                             JsonNumber(plan.DurationSeconds), JsonNumber(plan.Loudness), JsonNumber(plan.TruePeak),
+                             JsonNumber(plan.LoudnessRange))
+              << "\n"
+              << fmt::format(R"(  "threshold": {}, "cache_hit": {}, "noop": {},)", JsonNumber(plan.Threshold),
+                             plan.CacheHit, plan.Noop())
+              << "\n"
+              << fmt::format(R"(  "plan": {{"transform": {}, "format": {}, "channels": {}, "loudnorm": {},)",
+                             plan.NeedTransform, plan.NeedFormat, plan.NeedChannels, plan.NeedLoudNorm)
+              << fmt::format(R"( "offset": {}, "linear_gain": {}, "gain_db": {}}})", plan.NeedOffset,
+                             plan.LinearGain, JsonNumber(plan.GainDb))
+              << "\n}\n";
+}
+
+const char *StatusName(const Audio::NormalizeStatus status) {
+    switch (status) {
+    case Audio::NormalizeStatus::Normalized:
+        return "normalized";
+    case Audio::NormalizeStatus::Unchanged:
+        return "unchanged";
+    default:
+        return "failed";
+    }
+}
+
 template <typename T> int run_impl(int argc, T **argv) {
     spdlog::set_default_logger(spdlog::stderr_color_mt("Manipulate"));
 
@@ -54,36 +365,60 @@ template <typename T> int run_impl(int argc, T **argv) {
     app.add_option("--loglevel", log_level, "(trace, debug, info, warn, error, critical, off)")->default_val("info");
 
     const auto subcmd_audio_normalize = app.add_subcommand("audio_normalize", "Audio::Normalize")->fallthrough();
-    subcmd_audio_normalize->add_option("-s,--src", audio_normalize_opts.src)->required();
-    subcmd_audio_normalize->add_option("-d,--dst", audio_normalize_opts.dst)->required();
+    subcmd_audio_normalize->add_option("-s,--src", audio_normalize_opts.src, "source file, or - for stdin")
+        ->required();
+    subcmd_audio_normalize->add_option("-d,--dst", audio_normalize_opts.dst, "output file, or - for stdout")
+        ->required();
     subcmd_audio_normalize->add_option("-o,--offset", audio_normalize_opts.options.Offset, "offset (s)");
-    subcmd_audio_normalize
-        ->add_option("--sample-format", audio_normalize_opts.sample_format,
-                     "sample format (u8, s16, s32, s64, flt, dbl)")
-        ->default_val(audio_normalize_opts.sample_format);
-    subcmd_audio_normalize->add_option("--sample-rate", audio_normalize_opts.options.SampleRate, "sample rate (Hz)")
-        ->check(CLI::PositiveNumber);
-    subcmd_audio_normalize->add_option("--lufs", audio_normalize_opts.options.Loudness, "target loudness (LUFS)");
-    subcmd_audio_normalize->add_option("--lu", audio_normalize_opts.options.LoudnessRange,
-                                       "target loudness range (LU)");
-    subcmd_audio_normalize->add_option("--dbtp", audio_normalize_opts.options.TruePeak, "target true peak (dBTP)");
-    subcmd_audio_normalize
-        ->add_option("--true-peak-tolerance", audio_normalize_opts.options.TruePeakTolerance,
-                     "true peak tolerance (dB)")
-        ->check(CLI::NonNegativeNumber);
-    subcmd_audio_normalize
-        ->add_option("--lu-tolerance", audio_normalize_opts.options.LoudnessRangeTolerance,
-                     "loudness range tolerance (LU)")
-        ->check(CLI::NonNegativeNumber);
-    subcmd_audio_normalize
-        ->add_option("--gain-tolerance", audio_normalize_opts.options.GainTolerance, "gain tolerance (dB)")
-        ->check(CLI::NonNegativeNumber);
-    subcmd_audio_normalize
-        ->add_option("--offset-tolerance", audio_normalize_opts.options.OffsetTolerance, "offset tolerance (s)")
+    subcmd_audio_normalize->add_option("--waveform", audio_normalize_opts.options.Waveform,
+                                       "also write a waveform peak and loudness sidecar to this file");
+    subcmd_audio_normalize->add_option("--stats-json", audio_normalize_opts.stats_json,
+                                       "write stage timings, throughput and plan decisions to this JSON file");
+    AddNormalizeOptions(subcmd_audio_normalize, audio_normalize_opts);
+
+    const auto subcmd_audio_normalize_batch =
+        app.add_subcommand("audio_normalize_batch", "Audio::NormalizeBatch")->fallthrough();
+    subcmd_audio_normalize_batch
+        ->add_option("-l,--list", audio_batch_opts.list, "job list, one `src<TAB>dst[<TAB>offset]` per line")
+        ->required();
+    subcmd_audio_normalize_batch->add_option("-j,--jobs", audio_batch_opts.threads, "worker threads (0: all cores)");
+    AddNormalizeOptions(subcmd_audio_normalize_batch, audio_normalize_batch_opts);
+
+    const auto subcmd_audio_preview = app.add_subcommand("audio_preview", "Audio::NormalizePreview")->fallthrough();
+    subcmd_audio_preview->add_option("-s,--src", audio_preview_normalize_opts.src)->required();
+    subcmd_audio_preview->add_option("-d,--dst", audio_preview_normalize_opts.dst)->required();
+    subcmd_audio_preview->add_option("-o,--offset", audio_preview_normalize_opts.options.Offset, "offset (s)");
+    subcmd_audio_preview->add_option("--start", audio_preview_opts.preview.Start, "excerpt start (s)")
         ->check(CLI::NonNegativeNumber);
+    subcmd_audio_preview->add_option("--duration", audio_preview_opts.preview.Duration, "excerpt length (s)")
+        ->check(CLI::PositiveNumber)
+        ->default_val(audio_preview_opts.preview.Duration);
+    subcmd_audio_preview->add_option("--fade-in", audio_preview_opts.preview.FadeIn, "fade-in length (s)")
+        ->check(CLI::NonNegativeNumber)
+        ->default_val(audio_preview_opts.preview.FadeIn);
+    subcmd_audio_preview->add_option("--fade-out", audio_preview_opts.preview.FadeOut, "fade-out length (s)")
+        ->check(CLI::NonNegativeNumber)
+        ->default_val(audio_preview_opts.preview.FadeOut);
+    AddNormalizeOptions(subcmd_audio_preview, audio_preview_normalize_opts);
+
+    const auto subcmd_audio_plan = app.add_subcommand("audio_plan", "Audio::Plan")->fallthrough();
+    subcmd_audio_plan->add_option("-s,--src", audio_plan_normalize_opts.src, "source file, or - for stdin")
+        ->required();
+    subcmd_audio_plan->add_option("-o,--offset", audio_plan_normalize_opts.options.Offset, "offset (s)");
+    subcmd_audio_plan->add_flag("--json", audio_plan_opts.json, "print the plan as JSON");
+    AddNormalizeOptions(subcmd_audio_plan, audio_plan_normalize_opts);
 
     const auto subcmd_audio_ensure_valid = app.add_subcommand("audio_check", "Audio::EnsureValid")->fallthrough();
-    subcmd_audio_ensure_valid->add_option("-s,--src", audio_ensure_valid_opts.src)->required();
+    // Exactly one of --src and --list; the other options combine freely with either.
+    const auto audio_check_source = subcmd_audio_ensure_valid->add_option_group("source");
+    audio_check_source->add_option("-s,--src", audio_ensure_valid_opts.src, "source file, or - for stdin");
+    audio_check_source->add_option("-l,--list", audio_ensure_valid_opts.list,
+                                   "validate every file in this list, one path per line");
+    audio_check_source->require_option(1);
+    subcmd_audio_ensure_valid->add_option("-m,--mode", audio_ensure_valid_opts.mode, "(fast, standard, deep)")
+        ->default_val("standard");
+    subcmd_audio_ensure_valid->add_option("-j,--jobs", audio_ensure_valid_opts.threads,
+                                          "worker threads for --list (0: all cores)");
 
     const auto subcmd_image_ensure_valid = app.add_subcommand("image_check", "Image::EnsureValid")->fallthrough();
     subcmd_image_ensure_valid->add_option("-s,--src", image_ensure_valid_opts.src)->required();
@@ -91,6 +426,8 @@ template <typename T> int run_impl(int argc, T **argv) {
     const auto subcmd_convert_jacket = app.add_subcommand("convert_jacket", "Image::ConvertJacket")->fallthrough();
     subcmd_convert_jacket->add_option("-s,--src", convert_jacket_opts.src)->required();
     subcmd_convert_jacket->add_option("-d,--dst", convert_jacket_opts.dst)->required();
+    subcmd_convert_jacket->add_option("--encoder", convert_jacket_opts.encoder, "DDS encoder (directxtex, fast, high)")
+        ->default_val(convert_jacket_opts.encoder);
 
     const auto subcmd_convert_stage = app.add_subcommand("convert_stage", "Image::ConvertStage")->fallthrough();
     subcmd_convert_stage->add_option("-b,--bg", convert_stage_opts.bg)->required();
@@ -100,6 +437,8 @@ template <typename T> int run_impl(int argc, T **argv) {
     subcmd_convert_stage->add_option("-2,--fx2", convert_stage_opts.fx[1]);
     subcmd_convert_stage->add_option("-3,--fx3", convert_stage_opts.fx[2]);
     subcmd_convert_stage->add_option("-4,--fx4", convert_stage_opts.fx[3]);
+    subcmd_convert_stage->add_option("--encoder", convert_stage_opts.encoder, "DDS encoder (directxtex, fast, high)")
+        ->default_val(convert_stage_opts.encoder);
 
     const auto subcmd_extract_dds = app.add_subcommand("extract_dds", "Image::ExtractDds")->fallthrough();
     subcmd_extract_dds->add_option("-s,--src", extract_dds_opts.src)->required();
@@ -137,23 +476,99 @@ template <typename T> int run_impl(int argc, T **argv) {
     try {
         if (subcmd_audio_normalize->parsed()) {
             Audio::Initialize();
-            audio_normalize_opts.options.SampleFormat = ParseSampleFormat(audio_normalize_opts.sample_format);
-            ret = Audio::Normalize(audio_normalize_opts.src, audio_normalize_opts.dst, audio_normalize_opts.options)
-                      ? kExitOk
-                      : kExitNoop;
+            auto options = ResolveNormalizeOptions(audio_normalize_opts);
+            std::optional<Audio::AnalysisCache> cache;
+            if (!audio_normalize_opts.cache.empty()) {
+                options.Cache = &cache.emplace(audio_normalize_opts.cache);
+            }
+            const auto &src = audio_normalize_opts.src;
+            const auto &dst = audio_normalize_opts.dst;
+            Audio::NormalizeStats stats;
+            auto *const statsOut = audio_normalize_opts.stats_json.empty() ? nullptr : &stats;
+            if (IsStdio(src) || IsStdio(dst)) {
+                const auto input = ReadAll(src);
+                std::vector<uint8_t> output;
+                ret = Audio::Normalize(input, output, options, statsOut) ? kExitOk : kExitNoop;
+                if (ret == kExitOk) {
+                    WriteAll(dst, output);
+                }
+            } else {
+                ret = Audio::Normalize(src, dst, options, statsOut) ? kExitOk : kExitNoop;
+            }
+            if (statsOut) {
+                WriteStatsJson(audio_normalize_opts.stats_json, stats);
+            }
+        } else if (subcmd_audio_normalize_batch->parsed()) {
+            Audio::Initialize();
+            auto options = ResolveNormalizeOptions(audio_normalize_batch_opts);
+            std::optional<Audio::AnalysisCache> cache;
+            if (!audio_normalize_batch_opts.cache.empty()) {
+                options.Cache = &cache.emplace(audio_normalize_batch_opts.cache);
+            }
+            const auto jobs = ReadNormalizeJobs(audio_batch_opts.list, options);
+            const auto results = Audio::NormalizeBatch(jobs, audio_batch_opts.threads);
+            if (cache) {
+                spdlog::info("Loudness cache: {} hits, {} misses", cache->Hits(), cache->Misses());
+            }
+            for (std::size_t i = 0; i < jobs.size(); ++i) {
+                std::cout << StatusName(results[i].Status) << '\t' << lib::PathToUtf8(jobs[i].Src);
+                if (!results[i].Error.empty())
+                    std::cout << '\t' << results[i].Error;
+                std::cout << '\n';
+                if (results[i].Status == Audio::NormalizeStatus::Failed)
+                    ret = kExitError;
+            }
+        } else if (subcmd_audio_preview->parsed()) {
+            Audio::Initialize();
+            auto options = ResolveNormalizeOptions(audio_preview_normalize_opts);
+            std::optional<Audio::AnalysisCache> cache;
+            if (!audio_preview_normalize_opts.cache.empty()) {
+                options.Cache = &cache.emplace(audio_preview_normalize_opts.cache);
+            }
+            Audio::NormalizePreview(audio_preview_normalize_opts.src, audio_preview_normalize_opts.dst, options,
+                                    audio_preview_opts.preview);
+        } else if (subcmd_audio_plan->parsed()) {
+            Audio::Initialize();
+            auto options = ResolveNormalizeOptions(audio_plan_normalize_opts);
+            std::optional<Audio::AnalysisCache> cache;
+            if (!audio_plan_normalize_opts.cache.empty()) {
+                options.Cache = &cache.emplace(audio_plan_normalize_opts.cache);
+            }
+            const auto &src = audio_plan_normalize_opts.src;
+            const auto plan = IsStdio(src) ? Audio::Plan(ReadAll(src), options) : Audio::Plan(src, options);
+            PrintPlan(plan, audio_plan_opts.json);
+            ret = plan.Noop() ? kExitNoop : kExitOk;
         } else if (subcmd_audio_ensure_valid->parsed()) {
             Audio::Initialize();
-            Audio::EnsureValid(audio_ensure_valid_opts.src);
+            Audio::ValidateOptions options;
+            options.Mode = ParseValidateMode(audio_ensure_valid_opts.mode);
+            if (!audio_ensure_valid_opts.list.empty()) {
+                const auto paths = ReadPathList(audio_ensure_valid_opts.list);
+                const auto results = Audio::EnsureValidBatch(paths, options, audio_ensure_valid_opts.threads);
+                for (std::size_t i = 0; i < paths.size(); ++i) {
+                    std::cout << (results[i].Valid ? "valid" : "invalid") << '\t' << lib::PathToUtf8(paths[i]);
+                    if (!results[i].Valid) {
+                        std::cout << '\t' << results[i].Error;
+                        ret = kExitError;
+                    }
+                    std::cout << '\n';
+                }
+            } else if (IsStdio(audio_ensure_valid_opts.src)) {
+                Audio::EnsureValid(ReadAll(audio_ensure_valid_opts.src), options);
+            } else {
+                Audio::EnsureValid(audio_ensure_valid_opts.src, options);
+            }
         } else if (subcmd_image_ensure_valid->parsed()) {
             Image::Initialize();
             Image::EnsureValid(image_ensure_valid_opts.src);
         } else if (subcmd_convert_jacket->parsed()) {
             Image::Initialize();
-            Image::ConvertJacket(convert_jacket_opts.src, convert_jacket_opts.dst);
+            Image::ConvertJacket(convert_jacket_opts.src, convert_jacket_opts.dst,
+                                 ParseDdsEncoder(convert_jacket_opts.encoder));
         } else if (subcmd_convert_stage->parsed()) {
             Image::Initialize();
             Image::ConvertStage(convert_stage_opts.bg, convert_stage_opts.stsrc, convert_stage_opts.stdst,
-                                convert_stage_opts.fx);
+                                convert_stage_opts.fx, ParseDdsEncoder(convert_stage_opts.encoder));
         } else if (subcmd_extract_dds->parsed()) {
             Image::ExtractDds(extract_dds_opts.src, extract_dds_opts.dst);
         } else {
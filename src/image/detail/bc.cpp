@@ -0,0 +1,529 @@
+// src/image/detail/bc.cpp
+#include "bc.hpp"
+#include "bc_kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+#include <fmt/format.h>
+
+namespace Image::detail {
+namespace {
+
+constexpr uint8_t kAlphaThreshold = 128;
+constexpr uint16_t kAllPixels = 0xFFFF;
+constexpr float kMinDeterminant = 1e-3f;
+constexpr int kPowerIterations = 8;
+constexpr int kMaxClusterIterations = 4;
+
+struct Rgb {
+    float r = 0;
+    float g = 0;
+    float b = 0;
+};
+
+struct ColorFit {
+    uint16_t c0 = 0;
+    uint16_t c1 = 0;
+    uint32_t indices = 0;
+    int32_t error = std::numeric_limits<int32_t>::max();
+};
+
+struct AlphaFit {
+    uint8_t a0 = 0;
+    uint8_t a1 = 0;
+    uint64_t indices = 0;
+    int32_t error = std::numeric_limits<int32_t>::max();
+};
+
+struct Kernels {
+    AssignColorKernel assign;
+    ClusterSearchKernel search;
+};
+
+// -- Shared with the vector kernels: the error of one cluster split ----------------------------
+
+[[nodiscard]] float SnapToGrid(const float value, const float steps) {
+    return std::nearbyint(std::clamp(value, 0.0f, 255.0f) * (steps / 255.0f)) * (255.0f / steps);
+}
+
+[[nodiscard]] float SplitError(const ClusterSums &sums, const int i, const int j, const int k) {
+    const auto n0 = static_cast<float>(i);
+    const auto n2 = static_cast<float>(j - i);
+    const auto n3 = static_cast<float>(k - j);
+    const auto n1 = static_cast<float>(16 - k);
+    const float alpha2 = n0 + n2 * (4.0f / 9.0f) + n3 * (1.0f / 9.0f);
+    const float beta2 = n1 + n2 * (1.0f / 9.0f) + n3 * (4.0f / 9.0f);
+    const float alphaBeta = (n2 + n3) * (2.0f / 9.0f);
+    const float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+    if (determinant < kMinDeterminant)
+        return std::numeric_limits<float>::infinity();
+    const float factor = 1.0f / determinant;
+
+    float error = 0;
+    const auto channel = [&](const std::array<float, 24> &s, const float steps) {
+        const float x0 = s[i];
+        const float x2 = s[j] - s[i];
+        const float x3 = s[k] - s[j];
+        const float x1 = s[16] - s[k];
+        const float alphaX = x0 + x2 * (2.0f / 3.0f) + x3 * (1.0f / 3.0f);
+        const float betaX = x1 + x2 * (1.0f / 3.0f) + x3 * (2.0f / 3.0f);
+        const float a = SnapToGrid((alphaX * beta2 - betaX * alphaBeta) * factor, steps);
+        const float b = SnapToGrid((betaX * alpha2 - alphaX * alphaBeta) * factor, steps);
+        error += a * a * alpha2 + b * b * beta2 + 2 * a * b * alphaBeta - 2 * a * alphaX - 2 * b * betaX;
+    };
+    channel(sums.r, 31);
+    channel(sums.g, 63);
+    channel(sums.b, 31);
+    return error;
+}
+
+// -- Scalar kernels ----------------------------------------------------------------------------
+
+uint32_t AssignColorScalar(const ColorBlock &block, const ColorPalette &palette, int32_t &error) {
+    uint32_t indices = 0;
+    for (int p = 0; p < 16; ++p) {
+        int32_t best = std::numeric_limits<int32_t>::max();
+        uint32_t index = 0;
+        for (uint32_t e = 0; e < 4; ++e) {
+            const int32_t dr = block.r[p] - palette.r[e];
+            const int32_t dg = block.g[p] - palette.g[e];
+            const int32_t db = block.b[p] - palette.b[e];
+            const int32_t distance = dr * dr + dg * dg + db * db;
+            if (distance < best) {
+                best = distance;
+                index = e;
+            }
+        }
+        indices |= index << (p * 2);
+        error += best;
+    }
+    return indices;
+}
+
+ClusterSplit SearchClustersScalar(const ClusterSums &sums) {
+    ClusterSplit best{std::numeric_limits<float>::infinity(), 0, 0, 0};
+    for (int i = 0; i <= 16; ++i) {
+        for (int j = i; j <= 16; ++j) {
+            for (int k = j; k <= 16; ++k) {
+                const float error = SplitError(sums, i, j, k);
+                if (error < best.error) {
+                    best = {error, i, j, k};
+                }
+            }
+        }
+    }
+    return best;
+}
+
+[[nodiscard]] Kernels SelectKernels(const SimdLevel simd) {
+#ifdef MUA_IMAGE_AVX2
+    if (simd == SimdLevel::Avx2 && BestSimdLevel() == SimdLevel::Avx2)
+        return {AssignColorIndicesAvx2, SearchClustersAvx2};
+#else
+    (void)simd;
+#endif
+    return {AssignColorScalar, SearchClustersScalar};
+}
+
+// -- Colour endpoints --------------------------------------------------------------------------
+
+[[nodiscard]] uint16_t Pack565(const Rgb &color) {
+    const auto quantize = [](const float value, const int steps) {
+        return static_cast<int>(std::nearbyint(std::clamp(value, 0.0f, 255.0f) * steps / 255.0f));
+    };
+    return static_cast<uint16_t>(quantize(color.r, 31) << 11 | quantize(color.g, 63) << 5 | quantize(color.b, 31));
+}
+
+[[nodiscard]] ColorPalette MakePalette(const uint16_t c0, const uint16_t c1, const bool fourColors) {
+    ColorPalette palette{};
+    const auto unpack = [&](const uint16_t c, const int e) {
+        const int r = c >> 11;
+        const int g = (c >> 5) & 0x3F;
+        const int b = c & 0x1F;
+        palette.r[e] = (r << 3) | (r >> 2);
+        palette.g[e] = (g << 2) | (g >> 4);
+        palette.b[e] = (b << 3) | (b >> 2);
+    };
+    unpack(c0, 0);
+    unpack(c1, 1);
+    for (auto *channel : {&palette.r, &palette.g, &palette.b}) {
+        auto &v = *channel;
+        if (fourColors) {
+            v[2] = (2 * v[0] + v[1]) / 3;
+            v[3] = (v[0] + 2 * v[1]) / 3;
+        } else {
+            v[2] = (v[0] + v[1]) / 2;
+            v[3] = 0;
+        }
+    }
+    return palette;
+}
+
+// Encodes the endpoints in four-colour mode, which needs c0 > c1. Swapping them swaps indices 0
+// with 1 and 2 with 3; equal endpoints end up with every index 0, which decodes the same in either
+// mode.
+[[nodiscard]] ColorFit FitEndpoints(const ColorBlock &block, const Rgb &first, const Rgb &second,
+                                    const Kernels &kernels) {
+    ColorFit fit{.c0 = Pack565(first), .c1 = Pack565(second), .error = 0};
+    if (fit.c0 < fit.c1) {
+        std::swap(fit.c0, fit.c1);
+    }
+    fit.indices = kernels.assign(block, MakePalette(fit.c0, fit.c1, true), fit.error);
+    return fit;
+}
+
+[[nodiscard]] Rgb PixelColor(const ColorBlock &block, const int p) {
+    return {static_cast<float>(block.r[p]), static_cast<float>(block.g[p]), static_cast<float>(block.b[p])};
+}
+
+[[nodiscard]] float Dot(const Rgb &a, const Rgb &b) {
+    return a.r * b.r + a.g * b.g + a.b * b.b;
+}
+
+// Principal axis of the pixels in `mask` by power iteration on their covariance.
+[[nodiscard]] Rgb PrincipalAxis(const ColorBlock &block, const uint16_t mask) {
+    Rgb mean;
+    int count = 0;
+    for (int p = 0; p < 16; ++p) {
+        if (mask >> p & 1) {
+            const Rgb c = PixelColor(block, p);
+            mean = {mean.r + c.r, mean.g + c.g, mean.b + c.b};
+            ++count;
+        }
+    }
+    mean = {mean.r / count, mean.g / count, mean.b / count};
+
+    float rr = 0, rg = 0, rb = 0, gg = 0, gb = 0, bb = 0;
+    for (int p = 0; p < 16; ++p) {
+        if (mask >> p & 1) {
+            const Rgb c = PixelColor(block, p);
+            const Rgb d{c.r - mean.r, c.g - mean.g, c.b - mean.b};
+            rr += d.r * d.r;
+            rg += d.r * d.g;
+            rb += d.r * d.b;
+            gg += d.g * d.g;
+            gb += d.g * d.b;
+            bb += d.b * d.b;
+        }
+    }
+
+    Rgb axis{1, 1, 1};
+    for (int iteration = 0; iteration < kPowerIterations; ++iteration) {
+        const Rgb next{rr * axis.r + rg * axis.g + rb * axis.b, rg * axis.r + gg * axis.g + gb * axis.b,
+                       rb * axis.r + gb * axis.g + bb * axis.b};
+        const float scale = (std::max)({std::abs(next.r), std::abs(next.g), std::abs(next.b)});
+        if (scale == 0)
+            break;
+        axis = {next.r / scale, next.g / scale, next.b / scale};
+    }
+    return axis;
+}
+
+// The pixels in `mask` with the largest and smallest projection on `axis`.
+[[nodiscard]] std::pair<Rgb, Rgb> Extremes(const ColorBlock &block, const uint16_t mask, const Rgb &axis) {
+    float lowest = std::numeric_limits<float>::infinity();
+    float highest = -lowest;
+    int low = 0;
+    int high = 0;
+    for (int p = 0; p < 16; ++p) {
+        if (mask >> p & 1) {
+            const float t = Dot(PixelColor(block, p), axis);
+            if (t < lowest) {
+                lowest = t;
+                low = p;
+            }
+            if (t > highest) {
+                highest = t;
+                high = p;
+            }
+        }
+    }
+    return {PixelColor(block, high), PixelColor(block, low)};
+}
+
+[[nodiscard]] ColorFit RangeFit(const ColorBlock &block, const Rgb &axis, const Kernels &kernels) {
+    auto [high, low] = Extremes(block, kAllPixels, axis);
+    // Pull the endpoints in by 1/16 of the range so the interpolated entries land on the bulk of
+    // the pixels rather than the outliers.
+    const Rgb inset{(high.r - low.r) / 16, (high.g - low.g) / 16, (high.b - low.b) / 16};
+    high = {high.r - inset.r, high.g - inset.g, high.b - inset.b};
+    low = {low.r + inset.r, low.g + inset.g, low.b + inset.b};
+    return FitEndpoints(block, high, low, kernels);
+}
+
+[[nodiscard]] ColorFit ClusterFit(const ColorBlock &block, Rgb axis, ColorFit best, const Kernels &kernels) {
+    std::array<int, 16> previous{};
+    previous.fill(-1);
+    for (int iteration = 0; iteration < kMaxClusterIterations; ++iteration) {
+        std::array<float, 16> projection{};
+        std::array<int, 16> order{};
+        for (int p = 0; p < 16; ++p) {
+            projection[p] = Dot(PixelColor(block, p), axis);
+        }
+        std::iota(order.begin(), order.end(), 0);
+        // Highest first, so the first run of the split goes to the first endpoint.
+        std::ranges::stable_sort(order, [&](const int a, const int b) { return projection[a] > projection[b]; });
+        if (order == previous)
+            break;
+        previous = order;
+
+        ClusterSums sums{};
+        for (int m = 0; m < 16; ++m) {
+            sums.r[m + 1] = sums.r[m] + static_cast<float>(block.r[order[m]]);
+            sums.g[m + 1] = sums.g[m] + static_cast<float>(block.g[order[m]]);
+            sums.b[m + 1] = sums.b[m] + static_cast<float>(block.b[order[m]]);
+        }
+        for (int m = 17; m < 24; ++m) {
+            sums.r[m] = sums.r[16];
+            sums.g[m] = sums.g[16];
+            sums.b[m] = sums.b[16];
+        }
+
+        const ClusterSplit split = kernels.search(sums);
+        if (!std::isfinite(split.error))
+            break;
+
+        // Recover the unrounded endpoints of the winning split.
+        const auto n0 = static_cast<float>(split.i);
+        const auto n2 = static_cast<float>(split.j - split.i);
+        const auto n3 = static_cast<float>(split.k - split.j);
+        const auto n1 = static_cast<float>(16 - split.k);
+        const float alpha2 = n0 + n2 * (4.0f / 9.0f) + n3 * (1.0f / 9.0f);
+        const float beta2 = n1 + n2 * (1.0f / 9.0f) + n3 * (4.0f / 9.0f);
+        const float alphaBeta = (n2 + n3) * (2.0f / 9.0f);
+        const float factor = 1.0f / (alpha2 * beta2 - alphaBeta * alphaBeta);
+        const auto solve = [&](const std::array<float, 24> &s) {
+            const float x2 = s[split.j] - s[split.i];
+            const float x3 = s[split.k] - s[split.j];
+            const float alphaX = s[split.i] + x2 * (2.0f / 3.0f) + x3 * (1.0f / 3.0f);
+            const float betaX = s[16] - s[split.k] + x2 * (1.0f / 3.0f) + x3 * (2.0f / 3.0f);
+            return std::pair{(alphaX * beta2 - betaX * alphaBeta) * factor,
+                             (betaX * alpha2 - alphaX * alphaBeta) * factor};
+        };
+        const auto [r0, r1] = solve(sums.r);
+        const auto [g0, g1] = solve(sums.g);
+        const auto [b0, b1] = solve(sums.b);
+
+        const ColorFit fit = FitEndpoints(block, {r0, g0, b0}, {r1, g1, b1}, kernels);
+        if (fit.error >= best.error)
+            break;
+        best = fit;
+
+        axis = {r0 - r1, g0 - g1, b0 - b1};
+        if (axis.r == 0 && axis.g == 0 && axis.b == 0)
+            break;
+    }
+    return best;
+}
+
+// BC1 with pixels under the alpha threshold: three-colour mode (c0 <= c1) with index 3 as
+// transparent black, fitted to the opaque pixels only.
+[[nodiscard]] ColorFit PunchThroughFit(const ColorBlock &block, const uint16_t opaque) {
+    ColorFit fit{.c0 = 0, .c1 = 0, .indices = 0, .error = 0};
+    if (opaque == 0) {
+        fit.indices = 0xFFFFFFFF;
+        return fit;
+    }
+
+    const auto [high, low] = Extremes(block, opaque, PrincipalAxis(block, opaque));
+    fit.c0 = Pack565(high);
+    fit.c1 = Pack565(low);
+    if (fit.c0 > fit.c1) {
+        std::swap(fit.c0, fit.c1);
+    }
+    const ColorPalette palette = MakePalette(fit.c0, fit.c1, false);
+    for (int p = 0; p < 16; ++p) {
+        uint32_t index = 3;
+        if (opaque >> p & 1) {
+            int32_t best = std::numeric_limits<int32_t>::max();
+            for (uint32_t e = 0; e < 3; ++e) {
+                const int32_t dr = block.r[p] - palette.r[e];
+                const int32_t dg = block.g[p] - palette.g[e];
+                const int32_t db = block.b[p] - palette.b[e];
+                const int32_t distance = dr * dr + dg * dg + db * db;
+                if (distance < best) {
+                    best = distance;
+                    index = e;
+                }
+            }
+            fit.error += best;
+        }
+        fit.indices |= index << (p * 2);
+    }
+    return fit;
+}
+
+// -- Alpha endpoints (BC3) ---------------------------------------------------------------------
+
+[[nodiscard]] std::array<int, 8> AlphaPalette(const int a0, const int a1) {
+    if (a0 > a1) {
+        return {a0, a1, (6 * a0 + a1) / 7, (5 * a0 + 2 * a1) / 7, (4 * a0 + 3 * a1) / 7,
+                (3 * a0 + 4 * a1) / 7, (2 * a0 + 5 * a1) / 7, (a0 + 6 * a1) / 7};
+    }
+    return {a0, a1, (4 * a0 + a1) / 5, (3 * a0 + 2 * a1) / 5, (2 * a0 + 3 * a1) / 5, (a0 + 4 * a1) / 5, 0, 255};
+}
+
+[[nodiscard]] AlphaFit FitAlpha(const std::array<uint8_t, 16> &alpha, const int a0, const int a1) {
+    const std::array<int, 8> palette = AlphaPalette(a0, a1);
+    AlphaFit fit{.a0 = static_cast<uint8_t>(a0), .a1 = static_cast<uint8_t>(a1), .indices = 0, .error = 0};
+    for (int p = 0; p < 16; ++p) {
+        int best = std::numeric_limits<int>::max();
+        uint64_t index = 0;
+        for (uint64_t e = 0; e < 8; ++e) {
+            const int d = alpha[p] - palette[e];
+            if (d * d < best) {
+                best = d * d;
+                index = e;
+            }
+        }
+        fit.indices |= index << (p * 3);
+        fit.error += best;
+    }
+    return fit;
+}
+
+[[nodiscard]] AlphaFit EncodeAlpha(const std::array<uint8_t, 16> &alpha, const BcQuality quality) {
+    const auto [lowest, highest] = std::ranges::minmax(alpha);
+    if (lowest == highest)
+        return {.a0 = highest, .a1 = lowest, .indices = 0, .error = 0};
+
+    AlphaFit best = FitAlpha(alpha, highest, lowest);
+    if (quality == BcQuality::Fast)
+        return best;
+
+    // Six-value mode spends its endpoints on the values between 0 and 255, which it has exactly.
+    int innerLow = 255;
+    int innerHigh = 0;
+    for (const uint8_t a : alpha) {
+        if (a != 0 && a != 255) {
+            innerLow = (std::min)(innerLow, int{a});
+            innerHigh = (std::max)(innerHigh, int{a});
+        }
+    }
+    const AlphaFit sixValues = innerLow <= innerHigh ? FitAlpha(alpha, innerLow, innerHigh) : FitAlpha(alpha, 0, 255);
+    if (sixValues.error < best.error) {
+        best = sixValues;
+    }
+    for (int inHigh = 0; inHigh < 4; ++inHigh) {
+        for (int inLow = 0; inLow < 4; ++inLow) {
+            const int a0 = highest - inHigh;
+            const int a1 = lowest + inLow;
+            if (a0 <= a1 || (inHigh == 0 && inLow == 0))
+                continue;
+            if (const AlphaFit fit = FitAlpha(alpha, a0, a1); fit.error < best.error) {
+                best = fit;
+            }
+        }
+    }
+    return best;
+}
+
+// -- Blocks ------------------------------------------------------------------------------------
+
+void LoadBlock(const RgbaImage &image, const unsigned bx, const unsigned by, ColorBlock &block,
+               std::array<uint8_t, 16> &alpha) {
+    for (unsigned py = 0; py < 4; ++py) {
+        const unsigned y = (std::min)(by * 4 + py, image.height - 1);
+        for (unsigned px = 0; px < 4; ++px) {
+            const unsigned x = (std::min)(bx * 4 + px, image.width - 1);
+            const RgbaPixel &pixel = image.pixels[static_cast<size_t>(y) * image.width + x];
+            const unsigned p = py * 4 + px;
+            block.r[p] = pixel.r;
+            block.g[p] = pixel.g;
+            block.b[p] = pixel.b;
+            alpha[p] = pixel.a;
+        }
+    }
+}
+
+void StoreColor(const ColorFit &fit, uint8_t *out) {
+    out[0] = static_cast<uint8_t>(fit.c0);
+    out[1] = static_cast<uint8_t>(fit.c0 >> 8);
+    out[2] = static_cast<uint8_t>(fit.c1);
+    out[3] = static_cast<uint8_t>(fit.c1 >> 8);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<uint8_t>(fit.indices >> (i * 8));
+    }
+}
+
+void StoreAlpha(const AlphaFit &fit, uint8_t *out) {
+    out[0] = fit.a0;
+    out[1] = fit.a1;
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<uint8_t>(fit.indices >> (i * 8));
+    }
+}
+
+[[nodiscard]] ColorFit EncodeColor(const ColorBlock &block, const BcQuality quality, const Kernels &kernels) {
+    const Rgb axis = PrincipalAxis(block, kAllPixels);
+    const ColorFit range = RangeFit(block, axis, kernels);
+    if (quality == BcQuality::Fast || range.error == 0)
+        return range;
+    return ClusterFit(block, axis, range, kernels);
+}
+
+void EncodeBlock(const RgbaImage &image, const unsigned bx, const unsigned by, const DdsCompression compression,
+                 const BcQuality quality, const Kernels &kernels, uint8_t *out) {
+    ColorBlock block;
+    std::array<uint8_t, 16> alpha{};
+    LoadBlock(image, bx, by, block, alpha);
+
+    if (compression == DdsCompression::Bc3) {
+        StoreAlpha(EncodeAlpha(alpha, quality), out);
+        StoreColor(EncodeColor(block, quality, kernels), out + 8);
+        return;
+    }
+
+    uint16_t opaque = 0;
+    for (int p = 0; p < 16; ++p) {
+        opaque |= static_cast<uint16_t>(alpha[p] >= kAlphaThreshold) << p;
+    }
+    StoreColor(opaque == kAllPixels ? EncodeColor(block, quality, kernels) : PunchThroughFit(block, opaque), out);
+}
+
+} // namespace
+
+std::vector<uint8_t> CompressBc(const RgbaImage &image, const DdsCompression compression, const BcQuality quality,
+                                const SimdLevel simd) {
+    if (image.width == 0 || image.height == 0 ||
+        image.pixels.size() != static_cast<size_t>(image.width) * image.height) {
+        throw std::runtime_error(fmt::format("Invalid {}x{} image for block compression", image.width, image.height));
+    }
+
+    const unsigned blocksWide = (image.width + 3) / 4;
+    const unsigned blocksHigh = (image.height + 3) / 4;
+    const size_t blockBytes = compression == DdsCompression::Bc1 ? 8 : 16;
+    const size_t rowBytes = blocksWide * blockBytes;
+    std::vector<uint8_t> blocks(rowBytes * blocksHigh);
+    const Kernels kernels = SelectKernels(simd);
+
+    std::atomic<unsigned> nextRow{0};
+    const auto work = [&] {
+        for (unsigned by = nextRow++; by < blocksHigh; by = nextRow++) {
+            uint8_t *out = blocks.data() + by * rowBytes;
+            for (unsigned bx = 0; bx < blocksWide; ++bx, out += blockBytes) {
+                EncodeBlock(image, bx, by, compression, quality, kernels, out);
+            }
+        }
+    };
+
+    const unsigned hardware = (std::max)(1u, std::thread::hardware_concurrency());
+    const unsigned threads = (std::min)(hardware, blocksHigh);
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(work);
+        }
+        work();
+    }
+    return blocks;
+}
+
+} // namespace Image::detail
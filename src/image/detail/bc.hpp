@@ -0,0 +1,28 @@
+// src/image/detail/bc.hpp
+#pragma once
+
+#include "dds.hpp"
+#include "raster.hpp"
+#include "simd.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Image::detail {
+
+enum class BcQuality {
+    // Endpoints from the extremes along the block's principal axis (range fit).
+    Fast,
+    // Also searches every ordered split of the block into the four palette entries and solves each
+    // for least-squares endpoints (cluster fit), refining the axis from the best result.
+    High
+};
+
+// Compresses `image` to BC1 (8 bytes per 4x4 block) or BC3 (16 bytes) blocks in row-major block
+// order, as stored in a DDS file. Partial blocks at the right and bottom edges repeat the last
+// column and row. Colour error is uniform across channels. BC1 keeps alpha as one bit, cut at 128
+// like DirectXTex's default threshold. Rows of blocks run on separate threads.
+[[nodiscard]] std::vector<uint8_t> CompressBc(const RgbaImage &image, DdsCompression compression,
+                                              BcQuality quality, SimdLevel simd = BestSimdLevel());
+
+} // namespace Image::detail
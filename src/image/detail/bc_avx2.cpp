@@ -0,0 +1,148 @@
+// src/image/detail/bc_avx2.cpp
+// Compiled with AVX2 enabled; only called after BestSimdLevel() has confirmed CPU support.
+#include "bc_kernels.hpp"
+
+#include <immintrin.h>
+
+#include <limits>
+
+namespace Image::detail {
+namespace {
+
+constexpr float kMinDeterminant = 1e-3f;
+
+[[nodiscard]] int32_t HorizontalSum(const __m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+[[nodiscard]] __m256 SnapToGrid(const __m256 value, const float steps) {
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    const __m256 scaled = _mm256_mul_ps(clamped, _mm256_set1_ps(steps / 255.0f));
+    return _mm256_mul_ps(_mm256_round_ps(scaled, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC),
+                         _mm256_set1_ps(255.0f / steps));
+}
+
+} // namespace
+
+uint32_t AssignColorIndicesAvx2(const ColorBlock &block, const ColorPalette &palette, int32_t &error) {
+    const __m256i shifts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    __m256i total = _mm256_setzero_si256();
+    uint32_t indices = 0;
+    for (int half = 0; half < 2; ++half) {
+        const __m256i r = _mm256_load_si256(reinterpret_cast<const __m256i *>(block.r.data() + half * 8));
+        const __m256i g = _mm256_load_si256(reinterpret_cast<const __m256i *>(block.g.data() + half * 8));
+        const __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i *>(block.b.data() + half * 8));
+
+        __m256i best = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+        __m256i index = _mm256_setzero_si256();
+        for (int e = 0; e < 4; ++e) {
+            const __m256i dr = _mm256_sub_epi32(r, _mm256_set1_epi32(palette.r[e]));
+            const __m256i dg = _mm256_sub_epi32(g, _mm256_set1_epi32(palette.g[e]));
+            const __m256i db = _mm256_sub_epi32(b, _mm256_set1_epi32(palette.b[e]));
+            const __m256i distance = _mm256_add_epi32(
+                _mm256_mullo_epi32(dr, dr), _mm256_add_epi32(_mm256_mullo_epi32(dg, dg), _mm256_mullo_epi32(db, db)));
+            // Strictly closer only, so ties keep the lower index like the scalar kernel.
+            const __m256i closer = _mm256_cmpgt_epi32(best, distance);
+            best = _mm256_min_epi32(best, distance);
+            index = _mm256_blendv_epi8(index, _mm256_set1_epi32(e), closer);
+        }
+        total = _mm256_add_epi32(total, best);
+        // Each lane's index moves to its own two bits, so the lanes can simply be summed.
+        indices |= static_cast<uint32_t>(HorizontalSum(_mm256_sllv_epi32(index, shifts))) << (half * 16);
+    }
+    error += HorizontalSum(total);
+    return indices;
+}
+
+ClusterSplit SearchClustersAvx2(const ClusterSums &sums) {
+    // Eight values of k per step, mirroring SplitError in bc.cpp operation for operation so both
+    // kernels pick the same split.
+    const __m256 laneOffsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i laneCodes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 two = _mm256_set1_ps(2.0f);
+    __m256 bestError = infinity;
+    __m256i bestCode = _mm256_setzero_si256();
+
+    for (int i = 0; i <= 16; ++i) {
+        for (int j = i; j <= 16; ++j) {
+            const auto n0 = _mm256_set1_ps(static_cast<float>(i));
+            const auto n2 = _mm256_set1_ps(static_cast<float>(j - i));
+            for (int k0 = j; k0 <= 16; k0 += 8) {
+                const __m256 k = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(k0)), laneOffsets);
+                const __m256 n3 = _mm256_sub_ps(k, _mm256_set1_ps(static_cast<float>(j)));
+                const __m256 n1 = _mm256_sub_ps(_mm256_set1_ps(16.0f), k);
+                const __m256 alpha2 = _mm256_add_ps(_mm256_add_ps(n0, _mm256_mul_ps(n2, _mm256_set1_ps(4.0f / 9.0f))),
+                                                    _mm256_mul_ps(n3, _mm256_set1_ps(1.0f / 9.0f)));
+                const __m256 beta2 = _mm256_add_ps(_mm256_add_ps(n1, _mm256_mul_ps(n2, _mm256_set1_ps(1.0f / 9.0f))),
+                                                   _mm256_mul_ps(n3, _mm256_set1_ps(4.0f / 9.0f)));
+                const __m256 alphaBeta = _mm256_mul_ps(_mm256_add_ps(n2, n3), _mm256_set1_ps(2.0f / 9.0f));
+                const __m256 determinant =
+                    _mm256_sub_ps(_mm256_mul_ps(alpha2, beta2), _mm256_mul_ps(alphaBeta, alphaBeta));
+                const __m256 valid =
+                    _mm256_and_ps(_mm256_cmp_ps(determinant, _mm256_set1_ps(kMinDeterminant), _CMP_GE_OQ),
+                                  _mm256_cmp_ps(n1, _mm256_setzero_ps(), _CMP_GE_OQ));
+                const __m256 factor = _mm256_div_ps(_mm256_set1_ps(1.0f), determinant);
+
+                __m256 error = _mm256_setzero_ps();
+                const auto channel = [&](const std::array<float, 24> &s, const float steps) {
+                    const __m256 sk = _mm256_loadu_ps(s.data() + k0);
+                    const __m256 x0 = _mm256_set1_ps(s[i]);
+                    const __m256 x2 = _mm256_set1_ps(s[j] - s[i]);
+                    const __m256 x3 = _mm256_sub_ps(sk, _mm256_set1_ps(s[j]));
+                    const __m256 x1 = _mm256_sub_ps(_mm256_set1_ps(s[16]), sk);
+                    const __m256 alphaX =
+                        _mm256_add_ps(_mm256_add_ps(x0, _mm256_mul_ps(x2, _mm256_set1_ps(2.0f / 3.0f))),
+                                      _mm256_mul_ps(x3, _mm256_set1_ps(1.0f / 3.0f)));
+                    const __m256 betaX =
+                        _mm256_add_ps(_mm256_add_ps(x1, _mm256_mul_ps(x2, _mm256_set1_ps(1.0f / 3.0f))),
+                                      _mm256_mul_ps(x3, _mm256_set1_ps(2.0f / 3.0f)));
+                    const __m256 a = SnapToGrid(
+                        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(alphaX, beta2), _mm256_mul_ps(betaX, alphaBeta)),
+                                      factor),
+                        steps);
+                    const __m256 b = SnapToGrid(
+                        _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(betaX, alpha2), _mm256_mul_ps(alphaX, alphaBeta)),
+                                      factor),
+                        steps);
+                    __m256 term = _mm256_mul_ps(_mm256_mul_ps(a, a), alpha2);
+                    term = _mm256_add_ps(term, _mm256_mul_ps(_mm256_mul_ps(b, b), beta2));
+                    term = _mm256_add_ps(term, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(two, a), b), alphaBeta));
+                    term = _mm256_sub_ps(term, _mm256_mul_ps(_mm256_mul_ps(two, a), alphaX));
+                    term = _mm256_sub_ps(term, _mm256_mul_ps(_mm256_mul_ps(two, b), betaX));
+                    error = _mm256_add_ps(error, term);
+                };
+                channel(sums.r, 31);
+                channel(sums.g, 63);
+                channel(sums.b, 31);
+
+                error = _mm256_blendv_ps(infinity, error, valid);
+                const __m256 better = _mm256_cmp_ps(error, bestError, _CMP_LT_OQ);
+                const __m256i code = _mm256_add_epi32(_mm256_set1_epi32(i << 10 | j << 5 | k0), laneCodes);
+                bestError = _mm256_blendv_ps(bestError, error, better);
+                bestCode = _mm256_castps_si256(
+                    _mm256_blendv_ps(_mm256_castsi256_ps(bestCode), _mm256_castsi256_ps(code), better));
+            }
+        }
+    }
+
+    alignas(32) float errors[8];
+    alignas(32) int32_t codes[8];
+    _mm256_store_ps(errors, bestError);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(codes), bestCode);
+    ClusterSplit best{std::numeric_limits<float>::infinity(), 0, 0, 0};
+    int32_t bestLaneCode = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        // Lowest code on ties: the split the scalar kernel's (i, j, k) loop order would meet first.
+        if (errors[lane] < best.error || (errors[lane] == best.error && codes[lane] < bestLaneCode)) {
+            best = {errors[lane], codes[lane] >> 10, codes[lane] >> 5 & 31, codes[lane] & 31};
+            bestLaneCode = codes[lane];
+        }
+    }
+    return best;
+}
+
+} // namespace Image::detail
@@ -0,0 +1,53 @@
+// src/image/detail/bc_kernels.hpp
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Image::detail {
+
+// The colour channels of a 4x4 block as planes; pixel `i` is at row i / 4, column i % 4.
+struct alignas(32) ColorBlock {
+    std::array<int32_t, 16> r;
+    std::array<int32_t, 16> g;
+    std::array<int32_t, 16> b;
+};
+
+// The four colours a BC1 colour block decodes to, in index order.
+struct alignas(16) ColorPalette {
+    std::array<int32_t, 4> r;
+    std::array<int32_t, 4> g;
+    std::array<int32_t, 4> b;
+};
+
+// Picks the nearest palette entry for every pixel (the lowest index on ties) and returns the 2-bit
+// indices packed with pixel 0 in the low bits. The summed squared error goes to `error`.
+using AssignColorKernel = uint32_t (*)(const ColorBlock &block, const ColorPalette &palette, int32_t &error);
+
+// Prefix sums of a block's colours ordered along the fit axis: entry `m` sums the first `m`
+// colours. Entries past 16 repeat the total so vector loops can read past the end.
+struct alignas(32) ClusterSums {
+    std::array<float, 24> r;
+    std::array<float, 24> g;
+    std::array<float, 24> b;
+};
+
+// An ordered split of the 16 colours into runs for indices 0, 2, 3 and 1 (the palette order from
+// the first endpoint to the second): [0, i), [i, j), [j, k) and [k, 16).
+struct ClusterSplit {
+    float error;
+    int i;
+    int j;
+    int k;
+};
+
+// Finds the split whose least-squares endpoints, rounded to the 565 grid, give the lowest error.
+// Errors omit the sum of squared colours, which is the same for every split.
+using ClusterSearchKernel = ClusterSplit (*)(const ClusterSums &sums);
+
+#ifdef MUA_IMAGE_AVX2
+uint32_t AssignColorIndicesAvx2(const ColorBlock &block, const ColorPalette &palette, int32_t &error);
+ClusterSplit SearchClustersAvx2(const ClusterSums &sums);
+#endif
+
+} // namespace Image::detail
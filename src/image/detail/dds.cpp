@@ -1,5 +1,6 @@
 // src/image/detail/dds.cpp
 #include "dds.hpp"
+#include "bc.hpp"
 
 #include <DirectXTex.h>
 
@@ -37,7 +38,7 @@ void CheckDx(const HRESULT hr, const std::string_view operation, const unsigned
 } // namespace
 
 std::vector<uint8_t> EncodeDds(std::span<const uint8_t> rgba, const unsigned width, const unsigned height,
-                               const DdsCompression compression) {
+                               const DdsCompression compression, const DdsEncoder encoder) {
     const size_t expected = static_cast<size_t>(width) * height * 4;
     if (rgba.size() != expected) {
         throw std::runtime_error(fmt::format("RGBA buffer size mismatch: got {} bytes, expected {} for {}x{}",
@@ -47,28 +48,44 @@ std::vector<uint8_t> EncodeDds(std::span<const uint8_t> rgba, const unsigned wid
     static_assert(sizeof(RgbaPixel) == 4, "RgbaPixel must be 4 bytes for memcpy staging");
     RgbaImage image{.width = width, .height = height, .pixels = std::vector<RgbaPixel>(expected / 4)};
     std::memcpy(image.pixels.data(), rgba.data(), expected);
-    return EncodeDds(std::move(image), compression);
+    return EncodeDds(std::move(image), compression, encoder);
 }
 
-std::vector<uint8_t> EncodeDds(RgbaImage image, const DdsCompression compression) {
+std::vector<uint8_t> EncodeDds(RgbaImage image, const DdsCompression compression, const DdsEncoder encoder) {
     const size_t expected = static_cast<size_t>(image.width) * image.height;
     if (image.pixels.size() != expected) {
         throw std::runtime_error(fmt::format("RGBA buffer size mismatch: got {} pixels, expected {} for {}x{}",
                                              image.pixels.size(), expected, image.width, image.height));
     }
 
-    DirectX::Image src{};
-    src.width = image.width;
-    src.height = image.height;
-    src.format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    src.rowPitch = static_cast<size_t>(image.width) * sizeof(RgbaPixel);
-    src.slicePitch = src.rowPitch * image.height;
-    src.pixels = reinterpret_cast<uint8_t *>(image.pixels.data());
-
     DirectX::ScratchImage compressed;
-    HRESULT hr = DirectX::Compress(src, ToDxgiFormat(compression), DirectX::TEX_COMPRESS_PARALLEL,
-                                   DirectX::TEX_THRESHOLD_DEFAULT, compressed);
-    CheckDx(hr, "DirectXTex compression", image.width, image.height, compression);
+    HRESULT hr;
+    if (encoder == DdsEncoder::DirectXTex) {
+        DirectX::Image src{};
+        src.width = image.width;
+        src.height = image.height;
+        src.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        src.rowPitch = static_cast<size_t>(image.width) * sizeof(RgbaPixel);
+        src.slicePitch = src.rowPitch * image.height;
+        src.pixels = reinterpret_cast<uint8_t *>(image.pixels.data());
+
+        hr = DirectX::Compress(src, ToDxgiFormat(compression), DirectX::TEX_COMPRESS_PARALLEL,
+                               DirectX::TEX_THRESHOLD_DEFAULT, compressed);
+        CheckDx(hr, "DirectXTex compression", image.width, image.height, compression);
+    } else {
+        const BcQuality quality = encoder == DdsEncoder::Fast ? BcQuality::Fast : BcQuality::High;
+        const auto blocks = CompressBc(image, compression, quality);
+        hr = compressed.Initialize2D(ToDxgiFormat(compression), image.width, image.height, 1, 1);
+        CheckDx(hr, "DDS image allocation", image.width, image.height, compression);
+
+        // The blocks are packed; the scratch image's rows may be padded.
+        const DirectX::Image *dst = compressed.GetImage(0, 0, 0);
+        const size_t blockRows = (image.height + 3) / 4;
+        const size_t blockRowBytes = blocks.size() / blockRows;
+        for (size_t row = 0; row < blockRows; ++row) {
+            std::memcpy(dst->pixels + row * dst->rowPitch, blocks.data() + row * blockRowBytes, blockRowBytes);
+        }
+    }
 
     DirectX::Blob dds;
     hr = DirectX::SaveToDDSMemory(compressed.GetImages(), compressed.GetImageCount(), compressed.GetMetadata(),
@@ -1,6 +1,7 @@
 // src/image/detail/dds.hpp
 #pragma once
 
+#include "image/image.hpp"
 #include "lib.hpp"
 #include "raster.hpp"
 
@@ -16,9 +17,11 @@ enum class DdsCompression {
 };
 
 [[nodiscard]] std::vector<uint8_t> EncodeDds(std::span<const uint8_t> rgba, unsigned width, unsigned height,
-                                             DdsCompression compression);
+                                             DdsCompression compression,
+                                             DdsEncoder encoder = DdsEncoder::DirectXTex);
 
-[[nodiscard]] std::vector<uint8_t> EncodeDds(RgbaImage image, DdsCompression compression);
+[[nodiscard]] std::vector<uint8_t> EncodeDds(RgbaImage image, DdsCompression compression,
+                                             DdsEncoder encoder = DdsEncoder::DirectXTex);
 
 void SaveDds(const fs::path &dstPath, std::span<const uint8_t> bytes);
 
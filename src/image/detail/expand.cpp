@@ -0,0 +1,72 @@
+// src/image/detail/expand.cpp
+#include "expand.hpp"
+
+#include <cstring>
+
+namespace Image::detail {
+namespace {
+
+template <int Channels> void ExpandScalar(const uint8_t *src, const size_t count, RgbaPixel *dst) {
+    for (size_t i = 0; i < count; ++i, src += Channels) {
+        if constexpr (Channels == 1) {
+            dst[i].set(src[0], 255);
+        } else if constexpr (Channels == 2) {
+            dst[i].set(src[0], src[1]);
+        } else if constexpr (Channels == 3) {
+            dst[i].set(src[0], src[1], src[2], 255);
+        }
+    }
+}
+
+void ExpandWide(const uint8_t *src, const int channels, const size_t count, RgbaPixel *dst) {
+    for (size_t i = 0; i < count; ++i, src += channels) {
+        dst[i].set(src[0], src[1], src[2], src[3]);
+    }
+}
+
+} // namespace
+
+void ExpandToRgba(const uint8_t *src, const int channels, const size_t count, RgbaPixel *dst,
+                  [[maybe_unused]] const SimdLevel simd) {
+    size_t done = 0;
+#ifdef MUA_IMAGE_AVX2
+    if (simd == SimdLevel::Avx2 && BestSimdLevel() == SimdLevel::Avx2) {
+        switch (channels) {
+        case 1:
+            done = ExpandGrayAvx2(src, count, dst);
+            break;
+        case 2:
+            done = ExpandGrayAlphaAvx2(src, count, dst);
+            break;
+        case 3:
+            done = ExpandRgbAvx2(src, count, dst);
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+    src += done * channels;
+    dst += done;
+    const size_t rest = count - done;
+
+    switch (channels) {
+    case 1:
+        ExpandScalar<1>(src, rest, dst);
+        break;
+    case 2:
+        ExpandScalar<2>(src, rest, dst);
+        break;
+    case 3:
+        ExpandScalar<3>(src, rest, dst);
+        break;
+    case 4:
+        std::memcpy(dst, src, rest * sizeof(RgbaPixel));
+        break;
+    default:
+        ExpandWide(src, channels, rest, dst);
+        break;
+    }
+}
+
+} // namespace Image::detail
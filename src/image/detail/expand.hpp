@@ -0,0 +1,25 @@
+// src/image/detail/expand.hpp
+#pragma once
+
+#include "raster.hpp"
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Image::detail {
+
+// Expands `count` interleaved 8-bit pixels to RGBA: one channel is gray, two are gray and alpha,
+// three are RGB with opaque alpha, four are copied, and channels past the fourth are dropped. Each
+// channel count has its own loop, with SIMD shuffles for 1 to 3 channels.
+void ExpandToRgba(const uint8_t *src, int channels, size_t count, RgbaPixel *dst, SimdLevel simd = BestSimdLevel());
+
+#ifdef MUA_IMAGE_AVX2
+// Expand as many leading pixels as the vector loops cover and return how many that was; the rest
+// is left to the scalar loops.
+size_t ExpandGrayAvx2(const uint8_t *src, size_t count, RgbaPixel *dst);
+size_t ExpandGrayAlphaAvx2(const uint8_t *src, size_t count, RgbaPixel *dst);
+size_t ExpandRgbAvx2(const uint8_t *src, size_t count, RgbaPixel *dst);
+#endif
+
+} // namespace Image::detail
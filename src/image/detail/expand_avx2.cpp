@@ -0,0 +1,73 @@
+// src/image/detail/expand_avx2.cpp
+// Compiled with AVX2 enabled; only called after BestSimdLevel() has confirmed CPU support.
+#include "expand.hpp"
+
+#include <immintrin.h>
+
+namespace Image::detail {
+namespace {
+
+constexpr char kZero = static_cast<char>(0x80); // pshufb index that yields 0
+
+[[nodiscard]] __m256i OpaqueAlpha() {
+    return _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+}
+
+} // namespace
+
+size_t ExpandGrayAvx2(const uint8_t *src, const size_t count, RgbaPixel *dst) {
+    // 16 gray bytes become 64 RGBA bytes: both lanes see all 16, and each shuffle splats four
+    // gray values per lane.
+    const __m256i splatLow = _mm256_setr_epi8(0, 0, 0, kZero, 1, 1, 1, kZero, 2, 2, 2, kZero, 3, 3, 3, kZero, //
+                                              4, 4, 4, kZero, 5, 5, 5, kZero, 6, 6, 6, kZero, 7, 7, 7, kZero);
+    const __m256i splatHigh =
+        _mm256_setr_epi8(8, 8, 8, kZero, 9, 9, 9, kZero, 10, 10, 10, kZero, 11, 11, 11, kZero, //
+                         12, 12, 12, kZero, 13, 13, 13, kZero, 14, 14, 14, kZero, 15, 15, 15, kZero);
+    const __m256i alpha = OpaqueAlpha();
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i gray =
+            _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        auto *out = reinterpret_cast<__m256i *>(dst + i);
+        _mm256_storeu_si256(out, _mm256_or_si256(_mm256_shuffle_epi8(gray, splatLow), alpha));
+        _mm256_storeu_si256(out + 1, _mm256_or_si256(_mm256_shuffle_epi8(gray, splatHigh), alpha));
+    }
+    return i;
+}
+
+size_t ExpandGrayAlphaAvx2(const uint8_t *src, const size_t count, RgbaPixel *dst) {
+    // 8 gray-alpha pairs become 32 RGBA bytes, four pixels per lane.
+    const __m256i splat = _mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7, //
+                                           8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i pairs =
+            _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_shuffle_epi8(pairs, splat));
+    }
+    return i;
+}
+
+size_t ExpandRgbAvx2(const uint8_t *src, const size_t count, RgbaPixel *dst) {
+    // 8 RGB pixels (24 bytes) become 32 RGBA bytes: the low lane holds pixels 0-3 and the high
+    // lane is loaded from byte 12 so it holds pixels 4-7 at the same offsets. That second load
+    // reads 28 bytes in total, so the loop stops while at least 10 pixels remain.
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, kZero, 3, 4, 5, kZero, 6, 7, 8, kZero, 9, 10, 11, kZero, //
+                                            0, 1, 2, kZero, 3, 4, 5, kZero, 6, 7, 8, kZero, 9, 10, 11, kZero);
+    const __m256i alpha = OpaqueAlpha();
+
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {
+        const uint8_t *pixels = src + i * 3;
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12));
+        const __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                            _mm256_or_si256(_mm256_shuffle_epi8(rgb, spread), alpha));
+    }
+    return i;
+}
+
+} // namespace Image::detail
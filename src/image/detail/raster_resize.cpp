@@ -1,4 +1,7 @@
 #include "raster.hpp"
+#include "expand.hpp"
+#include "reduced_decode.hpp"
+#include "resample.hpp"
 
 #include <algorithm>
 #include <array>
@@ -6,7 +9,6 @@
 #include <stdexcept>
 
 #include <OpenImageIO/imagebuf.h>
-#include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imageio.h>
 
 namespace Image::detail {
@@ -35,33 +37,29 @@ void ValidateImageSpec(const fs::path &path, const OIIO::ImageSpec &spec) {
     }
 }
 
-[[nodiscard]] OIIO::ImageBuf LoadOrientedImage(const fs::path &path) {
-    OIIO::ImageBuf image(lib::PathToUtf8(path));
-    if (!image.read(0, 0, true, OIIO::TypeDesc::UINT8)) {
-        ThrowImageError(path, image.geterror());
-    }
-
-    OIIO::ImageBuf oriented = OIIO::ImageBufAlgo::reorient(image);
-    if (oriented.has_error()) {
-        ThrowImageError(path, oriented.geterror());
-    }
-    return oriented;
-}
-
-[[nodiscard]] RgbaImage ToRgbaImage(const fs::path &path, OIIO::ImageBuf &image) {
+[[nodiscard]] RgbaImage ToRgbaImage(const fs::path &path, const OIIO::ImageBuf &image) {
     const OIIO::ImageSpec &spec = image.spec();
     ValidateImageSpec(path, spec);
 
     const int channels = std::max(1, spec.nchannels);
-    OIIO::ROI roi = OIIO::get_roi(spec);
-    roi.chbegin = 0;
-    roi.chend = channels;
-
     const auto width = static_cast<unsigned>(spec.width);
     const auto height = static_cast<unsigned>(spec.height);
     RgbaImage rgba{
         .width = width, .height = height, .pixels = std::vector<RgbaPixel>(PixelCount(width, height))};
 
+    // Decoded buffers hold their 8-bit pixels locally, so rows are expanded in place.
+    if (const auto *pixels = static_cast<const uint8_t *>(image.localpixels());
+        pixels && spec.format == OIIO::TypeDesc::UINT8) {
+        const auto stride = static_cast<std::ptrdiff_t>(image.scanline_stride());
+        for (unsigned y = 0; y < height; ++y) {
+            ExpandToRgba(pixels + y * stride, channels, width, rgba.pixels.data() + PixelOffset(width, 0, y));
+        }
+        return rgba;
+    }
+
+    OIIO::ROI roi = OIIO::get_roi(spec);
+    roi.chbegin = 0;
+    roi.chend = channels;
     if (channels == 4) {
         if (!image.get_pixels(roi, OIIO::TypeDesc::UINT8, rgba.pixels.data())) {
             ThrowImageError(path, image.geterror());
@@ -69,23 +67,91 @@ void ValidateImageSpec(const fs::path &path, const OIIO::ImageSpec &spec) {
         return rgba;
     }
 
-    std::vector<uint8_t> source(static_cast<size_t>(spec.width) * spec.height * channels);
+    std::vector<uint8_t> source(PixelCount(width, height) * channels);
     if (!image.get_pixels(roi, OIIO::TypeDesc::UINT8, source.data())) {
         ThrowImageError(path, image.geterror());
     }
+    ExpandToRgba(source.data(), channels, rgba.pixels.size(), rgba.pixels.data());
+    return rgba;
+}
+
+// Applies an EXIF orientation (2 to 8; anything else is left as stored) to an image.
+[[nodiscard]] RgbaImage Orient(RgbaImage image, const int orientation) {
+    if (orientation <= 1 || orientation > 8) {
+        return image;
+    }
 
-    for (size_t pixel = 0; pixel < static_cast<size_t>(width) * height; ++pixel) {
-        const uint8_t *src = source.data() + pixel * channels;
-        auto &dst = rgba.pixels[pixel];
-        if (channels == 1) {
-            dst.set(src[0], 255);
-        } else if (channels == 2) {
-            dst.set(src[0], src[1]);
-        } else {
-            dst.set(src[0], src[1], src[2], channels >= 4 ? src[3] : 255);
+    const unsigned width = image.width;
+    const unsigned height = image.height;
+    const bool transposed = orientation >= 5;
+    RgbaImage oriented{.width = transposed ? height : width,
+                       .height = transposed ? width : height,
+                       .pixels = std::vector<RgbaPixel>(PixelCount(width, height))};
+    for (unsigned y = 0; y < oriented.height; ++y) {
+        for (unsigned x = 0; x < oriented.width; ++x) {
+            unsigned sx = x;
+            unsigned sy = y;
+            switch (orientation) {
+            case 2: // mirrored horizontally
+                sx = width - 1 - x;
+                break;
+            case 3: // rotated 180
+                sx = width - 1 - x;
+                sy = height - 1 - y;
+                break;
+            case 4: // mirrored vertically
+                sy = height - 1 - y;
+                break;
+            case 5: // transposed
+                sx = y;
+                sy = x;
+                break;
+            case 6: // rotated 90 clockwise
+                sx = y;
+                sy = height - 1 - x;
+                break;
+            case 7: // transversed
+                sx = width - 1 - y;
+                sy = height - 1 - x;
+                break;
+            default: // 8: rotated 90 counter-clockwise
+                sx = width - 1 - y;
+                sy = x;
+                break;
+            }
+            oriented.pixels[PixelOffset(oriented.width, x, y)] = image.pixels[PixelOffset(width, sx, sy)];
         }
     }
-    return rgba;
+    return oriented;
+}
+
+// Resizes `image` so it is `width`x`height` once its Orientation is applied. The resize runs in the
+// stored orientation (to the transposed size for orientations 5 to 8) and only the small result is
+// reoriented, so a rotated source never gets a second full-resolution copy. Flips and transposes
+// commute with the separable resize filter, so the pixels match reorienting first.
+[[nodiscard]] RgbaImage ResizeOriented(const fs::path &path, const OIIO::ImageBuf &image, const int width,
+                                       const int height) {
+    const OIIO::ImageSpec &spec = image.spec();
+    ValidateImageSpec(path, spec);
+
+    const int orientation = spec.get_int_attribute("Orientation", 1);
+    const bool transposed = orientation >= 5 && orientation <= 8;
+    const int storedWidth = transposed ? height : width;
+    const int storedHeight = transposed ? width : height;
+    if (spec.width == storedWidth && spec.height == storedHeight) {
+        return Orient(ToRgbaImage(path, image), orientation);
+    }
+
+    const auto *pixels = static_cast<const uint8_t *>(image.localpixels());
+    if (!pixels || spec.format != OIIO::TypeDesc::UINT8) {
+        ThrowImageError(path, "Decoded pixels are not in local 8-bit storage");
+    }
+    const PixelView view{.data = pixels,
+                         .width = spec.width,
+                         .height = spec.height,
+                         .channels = spec.nchannels,
+                         .rowStride = static_cast<std::ptrdiff_t>(image.scanline_stride())};
+    return Orient(Resample(view, storedWidth, storedHeight), orientation);
 }
 
 } // namespace
@@ -107,13 +173,8 @@ RgbaImage LoadResizedRgba(const fs::path &path, const int width, const int heigh
         throw lib::FileError(path, "Requested image size must be positive");
     }
 
-    OIIO::ImageBuf image = LoadOrientedImage(path);
-    const OIIO::ROI roi(0, width, 0, height, 0, 1, 0, image.nchannels());
-    OIIO::ImageBuf resized = OIIO::ImageBufAlgo::resize(image, {}, roi);
-    if (resized.has_error()) {
-        ThrowImageError(path, resized.geterror());
-    }
-    return ToRgbaImage(path, resized);
+    const OIIO::ImageBuf image = DecodeAtLeast(path, width, height);
+    return ResizeOriented(path, image, width, height);
 }
 
 RgbaImage MakeBlankRgba(const unsigned width, const unsigned height) {
@@ -0,0 +1,195 @@
+// src/image/detail/reduced_decode.cpp
+#include "reduced_decode.hpp"
+
+#include "chunk.hpp"
+
+#include <OpenImageIO/imageio.h>
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <jpeglib.h>
+#include <webp/decode.h>
+
+namespace Image::detail {
+namespace {
+
+constexpr int kMaxJpegReduction = 8;
+constexpr int kMaxWebpReduction = 1 << 16;
+
+[[nodiscard]] int CeilDiv(const int value, const int divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+// Largest power-of-two reduction up to `maxFactor` that keeps both dimensions at least the minimum.
+[[nodiscard]] int ReductionFactor(const int width, const int height, const int minWidth, const int minHeight,
+                                  const int maxFactor) {
+    int factor = 1;
+    while (factor < maxFactor && CeilDiv(width, factor * 2) >= minWidth && CeilDiv(height, factor * 2) >= minHeight) {
+        factor *= 2;
+    }
+    return factor;
+}
+
+// Index of the smallest MIP level of subimage 0 that still covers the minimum; 0 without levels.
+[[nodiscard]] int SmallestSufficientMipLevel(OIIO::ImageInput &input, const int minWidth, const int minHeight) {
+    int best = 0;
+    for (int level = 1;; ++level) {
+        const OIIO::ImageSpec dims = input.spec_dimensions(0, level);
+        if (dims.width < minWidth || dims.height < minHeight)
+            return best;
+        best = level;
+    }
+}
+
+[[nodiscard]] uint8_t *AllocatePixels(std::optional<OIIO::ImageBuf> &out, const int width, const int height,
+                                      const int channels) {
+    out.emplace(OIIO::ImageSpec(width, height, channels, OIIO::TypeDesc::UINT8), OIIO::InitializePixels::No);
+    return static_cast<uint8_t *>(out->localpixels());
+}
+
+struct JpegErrorManager {
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+void OnJpegError(const j_common_ptr cinfo) {
+    std::longjmp(reinterpret_cast<JpegErrorManager *>(cinfo->err)->jump, 1);
+}
+
+using PixelAllocator = uint8_t *(*)(void *context, int width, int height, int channels);
+
+// libjpeg reports fatal errors by longjmp-ing back here, so this frame holds nothing with a
+// destructor; the pixels are allocated by the caller through `allocate`. Returns false for a color
+// space this path does not handle (CMYK, YCCK) and on any decode error, leaving the full-size
+// decode to report it.
+bool DecodeJpegScaled(const uint8_t *data, const size_t size, const int factor, const PixelAllocator allocate,
+                      void *context) {
+    jpeg_decompress_struct cinfo{};
+    JpegErrorManager error{};
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = OnJpegError;
+    error.manager.output_message = [](j_common_ptr) {};
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<unsigned char *>(data), static_cast<unsigned long>(size));
+    jpeg_read_header(&cinfo, TRUE);
+    if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
+        cinfo.out_color_space = JCS_GRAYSCALE;
+    } else if (cinfo.jpeg_color_space == JCS_YCbCr || cinfo.jpeg_color_space == JCS_RGB) {
+        cinfo.out_color_space = JCS_RGB;
+    } else {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = static_cast<unsigned>(factor);
+    jpeg_start_decompress(&cinfo);
+
+    uint8_t *pixels = allocate(context, static_cast<int>(cinfo.output_width), static_cast<int>(cinfo.output_height),
+                               cinfo.output_components);
+    const size_t stride = static_cast<size_t>(cinfo.output_width) * cinfo.output_components;
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = pixels + cinfo.output_scanline * stride;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+[[nodiscard]] std::optional<OIIO::ImageBuf> DecodeJpeg(const std::vector<uint8_t> &data, const int factor) {
+    std::optional<OIIO::ImageBuf> out;
+    const PixelAllocator allocate = [](void *context, const int width, const int height, const int channels) {
+        return AllocatePixels(*static_cast<std::optional<OIIO::ImageBuf> *>(context), width, height, channels);
+    };
+    if (!DecodeJpegScaled(data.data(), data.size(), factor, allocate, &out))
+        return std::nullopt;
+    return out;
+}
+
+[[nodiscard]] std::optional<OIIO::ImageBuf> DecodeWebp(const std::vector<uint8_t> &data, const int factor) {
+    WebPDecoderConfig config;
+    if (!WebPInitDecoderConfig(&config) ||
+        WebPGetFeatures(data.data(), data.size(), &config.input) != VP8_STATUS_OK || config.input.has_animation) {
+        return std::nullopt;
+    }
+
+    const int width = CeilDiv(config.input.width, factor);
+    const int height = CeilDiv(config.input.height, factor);
+    const int channels = config.input.has_alpha ? 4 : 3;
+    std::optional<OIIO::ImageBuf> out;
+    uint8_t *pixels = AllocatePixels(out, width, height, channels);
+
+    config.options.use_scaling = 1;
+    config.options.scaled_width = width;
+    config.options.scaled_height = height;
+    // OIIO hands out WebP alpha associated, so the full-size path does too; match it.
+    config.output.colorspace = config.input.has_alpha ? MODE_rgbA : MODE_RGB;
+    config.output.is_external_memory = 1;
+    config.output.u.RGBA.rgba = pixels;
+    config.output.u.RGBA.stride = width * channels;
+    config.output.u.RGBA.size = static_cast<size_t>(width) * height * channels;
+    const bool decoded = WebPDecode(data.data(), data.size(), &config) == VP8_STATUS_OK;
+    WebPFreeDecBuffer(&config.output);
+    if (!decoded)
+        return std::nullopt;
+    return out;
+}
+
+} // namespace
+
+OIIO::ImageBuf DecodeAtLeast(const fs::path &path, int minWidth, int minHeight) {
+    const std::string name = lib::PathToUtf8(path);
+
+    std::string format;
+    int width = 0;
+    int height = 0;
+    int orientation = 1;
+    int mipLevel = 0;
+    if (const auto input = OIIO::ImageInput::open(name)) {
+        const OIIO::ImageSpec &spec = input->spec();
+        orientation = spec.get_int_attribute("Orientation", 1);
+        // Orientations 5 to 8 transpose the image, so the stored width becomes the shown height.
+        if (orientation >= 5) {
+            std::swap(minWidth, minHeight);
+        }
+        format = input->format_name();
+        width = spec.width;
+        height = spec.height;
+        mipLevel = SmallestSufficientMipLevel(*input, minWidth, minHeight);
+    } else {
+        // Left for the full-size read below to report.
+        (void)OIIO::geterror();
+    }
+
+    if (format == "jpeg" || format == "webp") {
+        const bool jpeg = format == "jpeg";
+        const int factor =
+            ReductionFactor(width, height, minWidth, minHeight, jpeg ? kMaxJpegReduction : kMaxWebpReduction);
+        if (factor > 1) {
+            const auto data = ReadFileData(path);
+            if (auto reduced = jpeg ? DecodeJpeg(data, factor) : DecodeWebp(data, factor)) {
+                reduced->specmod().attribute("Orientation", orientation);
+                return std::move(*reduced);
+            }
+        }
+    }
+
+    OIIO::ImageBuf image(name, 0, mipLevel);
+    if (!image.read(0, mipLevel, true, OIIO::TypeDesc::UINT8)) {
+        throw lib::FileError(path, image.geterror());
+    }
+    return image;
+}
+
+} // namespace Image::detail
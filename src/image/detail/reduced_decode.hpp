@@ -0,0 +1,18 @@
+// src/image/detail/reduced_decode.hpp
+#pragma once
+
+#include "lib.hpp"
+
+#include <OpenImageIO/imagebuf.h>
+
+namespace Image::detail {
+
+// Decodes `path` as UINT8 at the smallest resolution its format can produce cheaply that still
+// covers `minWidth`x`minHeight` once oriented: JPEG through libjpeg-turbo's DCT scaling (1/2, 1/4
+// or 1/8), WebP through libwebp's scaled decode, and files with embedded lower-resolution MIP
+// levels by reading the smallest level that is large enough. Reductions are powers of two, so the
+// caller's resize filter still does the final step. Anything else decodes at full size. The
+// Orientation attribute is kept either way.
+[[nodiscard]] OIIO::ImageBuf DecodeAtLeast(const fs::path &path, int minWidth, int minHeight);
+
+} // namespace Image::detail
@@ -0,0 +1,225 @@
+// src/image/detail/resample.cpp
+#include "resample.hpp"
+#include "expand.hpp"
+#include "resample_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace Image::detail {
+namespace {
+
+constexpr int kMinBandRows = 64;
+
+[[nodiscard]] double FilterRadius(const ResampleFilter filter) {
+    return filter == ResampleFilter::Lanczos3 ? 3.0 : 2.0;
+}
+
+[[nodiscard]] double Lanczos3(double x) {
+    x = std::abs(x);
+    if (x < 1e-8)
+        return 1.0;
+    if (x >= 3.0)
+        return 0.0;
+    const double px = std::numbers::pi * x;
+    return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+}
+
+// Mitchell-Netravali with B = C = 1/3.
+[[nodiscard]] double Mitchell(double x) {
+    constexpr double b = 1.0 / 3.0;
+    constexpr double c = 1.0 / 3.0;
+    x = std::abs(x);
+    if (x < 1.0)
+        return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) / 6;
+    if (x < 2.0)
+        return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) /
+               6;
+    return 0.0;
+}
+
+// Weights for resizing `srcSize` pixels to `dstSize`, with pixel centres aligned as in OIIO. Taps
+// that fall outside the source are dropped and the rest renormalised, so edges are not darkened.
+[[nodiscard]] ResampleAxis MakeAxis(const int srcSize, const int dstSize, const ResampleFilter filter) {
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const double stretch = (std::max)(scale, 1.0);
+    const double radius = FilterRadius(filter) * stretch;
+    const auto kernel = filter == ResampleFilter::Lanczos3 ? Lanczos3 : Mitchell;
+
+    ResampleAxis axis;
+    axis.taps = (std::min)(static_cast<int>(std::ceil(radius * 2)) + 1, srcSize);
+    axis.starts.resize(dstSize);
+    axis.weights.assign(static_cast<size_t>(dstSize) * axis.taps, 0.0f);
+
+    std::vector<double> window(axis.taps);
+    for (int i = 0; i < dstSize; ++i) {
+        const double center = (i + 0.5) * scale - 0.5;
+        const int first = (std::max)(static_cast<int>(std::ceil(center - radius)), 0);
+        const int last = (std::min)(static_cast<int>(std::floor(center + radius)), srcSize - 1);
+        const int start = (std::min)(first, srcSize - axis.taps);
+
+        std::ranges::fill(window, 0.0);
+        double total = 0;
+        for (int s = first; s <= last; ++s) {
+            const double weight = kernel((s - center) / stretch);
+            window[s - start] = weight;
+            total += weight;
+        }
+        if (total == 0) {
+            // Only possible for degenerate sizes; fall back to the nearest pixel.
+            window[std::clamp(static_cast<int>(std::lround(center)), start, start + axis.taps - 1) - start] = 1;
+            total = 1;
+        }
+
+        axis.starts[i] = start;
+        float *weights = axis.weights.data() + static_cast<size_t>(i) * axis.taps;
+        for (int t = 0; t < axis.taps; ++t) {
+            weights[t] = static_cast<float>(window[t] / total);
+        }
+    }
+    return axis;
+}
+
+void HorizontalScalar(const uint8_t *rgba, const ResampleAxis &axis, float *out) {
+    const int taps = axis.taps;
+    for (size_t i = 0; i < axis.starts.size(); ++i) {
+        const uint8_t *src = rgba + static_cast<size_t>(axis.starts[i]) * 4;
+        const float *weights = axis.weights.data() + i * taps;
+        float sum[4] = {};
+        for (int t = 0; t < taps; ++t) {
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += weights[t] * src[t * 4 + c];
+            }
+        }
+        std::memcpy(out + i * 4, sum, sizeof(sum));
+    }
+}
+
+void VerticalScalar(const float *const *rows, const float *weights, const int taps, const int values,
+                    uint8_t *out) {
+    for (int v = 0; v < values; ++v) {
+        float sum = 0;
+        for (int t = 0; t < taps; ++t) {
+            sum += weights[t] * rows[t][v];
+        }
+        out[v] = static_cast<uint8_t>(std::clamp(std::nearbyint(sum), 0.0f, 255.0f));
+    }
+}
+
+struct Kernels {
+    HorizontalKernel horizontal;
+    VerticalKernel vertical;
+    SimdLevel expand;
+};
+
+[[nodiscard]] Kernels SelectKernels(const SimdLevel simd) {
+#ifdef MUA_IMAGE_AVX2
+    if (simd == SimdLevel::Avx2 && BestSimdLevel() == SimdLevel::Avx2)
+        return {ResampleHorizontalAvx2, ResampleVerticalAvx2, SimdLevel::Avx2};
+#else
+    (void)simd;
+#endif
+    return {HorizontalScalar, VerticalScalar, SimdLevel::Scalar};
+}
+
+// Filters output rows [rowBegin, rowEnd). Horizontally filtered source rows live in a ring of
+// `rows.taps` slots: the window of source rows only moves forward, so each is filtered once.
+class Band {
+  public:
+    Band(const PixelView &src, const ResampleAxis &columns, const ResampleAxis &rows, const Kernels kernels,
+         RgbaImage &dst, const int rowBegin, const int rowEnd)
+        : m_src(src), m_columns(columns), m_rows(rows), m_kernels(kernels), m_dst(dst), m_rowBegin(rowBegin),
+          m_rowEnd(rowEnd), m_ring(static_cast<size_t>(rows.taps) * dst.width * 4), m_window(rows.taps) {
+        if (src.channels != 4) {
+            m_expanded.resize(src.width);
+        }
+    }
+
+    void Run() {
+        const size_t ringRow = static_cast<size_t>(m_dst.width) * 4;
+        const int taps = m_rows.taps;
+        int next = m_rows.starts[m_rowBegin];
+        for (int y = m_rowBegin; y < m_rowEnd; ++y) {
+            const int start = m_rows.starts[y];
+            next = (std::max)(next, start);
+            for (; next < start + taps; ++next) {
+                m_kernels.horizontal(SourceRow(next), m_columns, m_ring.data() + (next % taps) * ringRow);
+            }
+            for (int t = 0; t < taps; ++t) {
+                m_window[t] = m_ring.data() + ((start + t) % taps) * ringRow;
+            }
+            auto *out = reinterpret_cast<uint8_t *>(m_dst.pixels.data() + static_cast<size_t>(y) * m_dst.width);
+            m_kernels.vertical(m_window.data(), m_rows.weights.data() + static_cast<size_t>(y) * taps, taps,
+                               static_cast<int>(ringRow), out);
+        }
+    }
+
+  private:
+    [[nodiscard]] const uint8_t *SourceRow(const int y) {
+        const uint8_t *row = m_src.data + y * m_src.rowStride;
+        if (m_src.channels == 4)
+            return row;
+        ExpandToRgba(row, m_src.channels, m_expanded.size(), m_expanded.data(), m_kernels.expand);
+        return reinterpret_cast<const uint8_t *>(m_expanded.data());
+    }
+
+    const PixelView &m_src;
+    const ResampleAxis &m_columns;
+    const ResampleAxis &m_rows;
+    Kernels m_kernels;
+    RgbaImage &m_dst;
+    int m_rowBegin;
+    int m_rowEnd;
+    std::vector<float> m_ring;
+    std::vector<const float *> m_window;
+    std::vector<RgbaPixel> m_expanded;
+};
+
+} // namespace
+
+RgbaImage Resample(const PixelView &src, const int width, const int height, const ResampleFilter filter,
+                   const SimdLevel simd) {
+    if (!src.data || src.width <= 0 || src.height <= 0 || src.channels <= 0) {
+        throw std::runtime_error("Invalid source image for resampling");
+    }
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error(fmt::format("Invalid resample target size {}x{}", width, height));
+    }
+
+    const ResampleAxis columns = MakeAxis(src.width, width, filter);
+    const ResampleAxis rows = MakeAxis(src.height, height, filter);
+    const Kernels kernels = SelectKernels(simd);
+
+    RgbaImage dst{.width = static_cast<unsigned>(width),
+                  .height = static_cast<unsigned>(height),
+                  .pixels = std::vector<RgbaPixel>(static_cast<size_t>(width) * height)};
+
+    const unsigned hardware = (std::max)(1u, std::thread::hardware_concurrency());
+    const int bandCount = std::clamp(height / kMinBandRows, 1, static_cast<int>(hardware));
+    std::vector<Band> bands;
+    bands.reserve(bandCount);
+    for (int i = 0; i < bandCount; ++i) {
+        bands.emplace_back(src, columns, rows, kernels, dst, height * i / bandCount, height * (i + 1) / bandCount);
+    }
+    if (bandCount == 1) {
+        bands.front().Run();
+        return dst;
+    }
+
+    std::vector<std::jthread> workers;
+    workers.reserve(bandCount);
+    for (auto &band : bands) {
+        workers.emplace_back([&band] { band.Run(); });
+    }
+    workers.clear();
+    return dst;
+}
+
+} // namespace Image::detail
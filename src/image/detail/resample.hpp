@@ -0,0 +1,36 @@
+// src/image/detail/resample.hpp
+#pragma once
+
+#include "raster.hpp"
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Image::detail {
+
+enum class ResampleFilter {
+    Lanczos3,
+    Mitchell
+};
+
+// Interleaved 8-bit pixels. One channel is gray, two are gray and alpha, three or more are RGB
+// with the fourth (if any) taken as alpha; further channels are ignored.
+struct PixelView {
+    const uint8_t *data = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::ptrdiff_t rowStride = 0; // bytes
+};
+
+// Resizes `src` to `width`x`height` RGBA with a separable filter: rows are filtered horizontally
+// into float RGBA as the vertical pass needs them, and each output row is the weighted sum of a
+// few of those, rounded to 8 bits. Filter weights are computed once per output column and row and
+// are widened by the scale factor when shrinking, like OIIO's resize. Bands of output rows run on
+// separate threads.
+[[nodiscard]] RgbaImage Resample(const PixelView &src, int width, int height,
+                                 ResampleFilter filter = ResampleFilter::Lanczos3,
+                                 SimdLevel simd = BestSimdLevel());
+
+} // namespace Image::detail
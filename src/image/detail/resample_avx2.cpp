@@ -0,0 +1,64 @@
+// src/image/detail/resample_avx2.cpp
+// Compiled with AVX2 enabled; only called after BestSimdLevel() has confirmed CPU support.
+#include "resample_kernels.hpp"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace Image::detail {
+
+void ResampleHorizontalAvx2(const uint8_t *rgba, const ResampleAxis &axis, float *out) {
+    const int taps = axis.taps;
+    for (size_t i = 0; i < axis.starts.size(); ++i) {
+        const uint8_t *src = rgba + static_cast<size_t>(axis.starts[i]) * 4;
+        const float *weights = axis.weights.data() + i * taps;
+
+        // Two source pixels per step: eight channels widened to float, each pixel's four lanes
+        // scaled by its weight.
+        __m256 acc = _mm256_setzero_ps();
+        int t = 0;
+        for (; t + 2 <= taps; t += 2) {
+            const __m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + t * 4));
+            const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(pixels));
+            const __m256 weight =
+                _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights[t])), _mm_set1_ps(weights[t + 1]), 1);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(values, weight));
+        }
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        if (t < taps) {
+            int32_t pixel;
+            std::memcpy(&pixel, src + t * 4, sizeof(pixel));
+            const __m128 values = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(values, _mm_set1_ps(weights[t])));
+        }
+        _mm_storeu_ps(out + i * 4, sum);
+    }
+}
+
+void ResampleVerticalAvx2(const float *const *rows, const float *weights, const int taps, const int values,
+                          uint8_t *out) {
+    int v = 0;
+    for (; v + 8 <= values; v += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int t = 0; t < taps; ++t) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(rows[t] + v), _mm256_set1_ps(weights[t])));
+        }
+        // Round to nearest, then saturate through 16 bits down to 8.
+        const __m256i rounded = _mm256_cvtps_epi32(acc);
+        const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + v), _mm_packus_epi16(words, words));
+    }
+    if (v < values) {
+        __m128 acc = _mm_setzero_ps();
+        for (int t = 0; t < taps; ++t) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[t] + v), _mm_set1_ps(weights[t])));
+        }
+        const __m128i rounded = _mm_cvtps_epi32(acc);
+        const __m128i words = _mm_packs_epi32(rounded, rounded);
+        const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(out + v, &bytes, sizeof(bytes));
+    }
+}
+
+} // namespace Image::detail
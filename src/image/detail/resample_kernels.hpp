@@ -0,0 +1,28 @@
+// src/image/detail/resample_kernels.hpp
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Image::detail {
+
+// Filter weights for one axis: output pixel `i` is the sum of `taps` source pixels starting at
+// `starts[i]`, weighted by `weights[i * taps ...]`. Weights outside the source are zero.
+struct ResampleAxis {
+    int taps = 0;
+    std::vector<int> starts;
+    std::vector<float> weights;
+};
+
+// Filters one RGBA8 source row into `axis.starts.size()` float RGBA pixels.
+using HorizontalKernel = void (*)(const uint8_t *rgba, const ResampleAxis &axis, float *out);
+// Writes `values` floats (4 per pixel) of the weighted sum of `taps` float rows, rounded and
+// clamped to 8 bits.
+using VerticalKernel = void (*)(const float *const *rows, const float *weights, int taps, int values, uint8_t *out);
+
+#ifdef MUA_IMAGE_AVX2
+void ResampleHorizontalAvx2(const uint8_t *rgba, const ResampleAxis &axis, float *out);
+void ResampleVerticalAvx2(const float *const *rows, const float *weights, int taps, int values, uint8_t *out);
+#endif
+
+} // namespace Image::detail
@@ -0,0 +1,43 @@
+// src/image/detail/simd.cpp
+#include "simd.hpp"
+
+#if defined(MUA_IMAGE_AVX2) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace Image::detail {
+namespace {
+
+[[nodiscard]] bool CpuHasAvx2() {
+#if !defined(MUA_IMAGE_AVX2)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    constexpr int kOsxsave = 1 << 27;
+    constexpr int kAvx = 1 << 28;
+    if ((info[2] & (kOsxsave | kAvx)) != (kOsxsave | kAvx))
+        return false;
+    // The OS must save the YMM registers on context switches.
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+} // namespace
+
+SimdLevel BestSimdLevel() {
+    static const SimdLevel level = CpuHasAvx2() ? SimdLevel::Avx2 : SimdLevel::Scalar;
+    return level;
+}
+
+} // namespace Image::detail
@@ -0,0 +1,17 @@
+// src/image/detail/simd.hpp
+#pragma once
+
+namespace Image::detail {
+
+// Instruction sets the image kernels have specialised paths for. Kernels for a level are only
+// compiled on targets that can run them (MUA_IMAGE_AVX2 for x86), so every level can be requested
+// anywhere and falls back to scalar code when its kernels are missing.
+enum class SimdLevel {
+    Scalar,
+    Avx2
+};
+
+// The best level this CPU and build support, detected once.
+[[nodiscard]] SimdLevel BestSimdLevel();
+
+} // namespace Image::detail
@@ -11,15 +11,16 @@ using namespace Image::detail;
 
 namespace {
 
-[[nodiscard]] std::vector<uint8_t> ConvertJacketDds(const fs::path &srcPath) {
-    return EncodeDds(LoadResizedRgba(srcPath, 300, 300), DdsCompression::Bc1);
+[[nodiscard]] std::vector<uint8_t> ConvertJacketDds(const fs::path &srcPath, const Image::DdsEncoder encoder) {
+    return EncodeDds(LoadResizedRgba(srcPath, 300, 300), DdsCompression::Bc1, encoder);
 }
 
-[[nodiscard]] std::vector<uint8_t> ConvertBackgroundDds(const fs::path &srcPath) {
-    return EncodeDds(LoadResizedRgba(srcPath, 1920, 1080), DdsCompression::Bc1);
+[[nodiscard]] std::vector<uint8_t> ConvertBackgroundDds(const fs::path &srcPath, const Image::DdsEncoder encoder) {
+    return EncodeDds(LoadResizedRgba(srcPath, 1920, 1080), DdsCompression::Bc1, encoder);
 }
 
-[[nodiscard]] std::vector<uint8_t> ConvertEffectDds(const std::array<fs::path, 4> &srcPaths) {
+[[nodiscard]] std::vector<uint8_t> ConvertEffectDds(const std::array<fs::path, 4> &srcPaths,
+                                                   const Image::DdsEncoder encoder) {
     constexpr int tileSize = 256;
 
     std::array<RgbaImage, 4> tiles;
@@ -31,7 +32,7 @@ namespace {
         }
     }
 
-    return EncodeDds(JoinTiles2x2(tiles), DdsCompression::Bc3);
+    return EncodeDds(JoinTiles2x2(tiles), DdsCompression::Bc3, encoder);
 }
 
 } // namespace
@@ -44,16 +45,16 @@ void Image::EnsureValid(const fs::path &srcPath) {
     ValidateImage(srcPath);
 }
 
-void Image::ConvertJacket(const fs::path &srcPath, const fs::path &dstPath) {
-    const auto dds = ConvertJacketDds(srcPath);
+void Image::ConvertJacket(const fs::path &srcPath, const fs::path &dstPath, const DdsEncoder encoder) {
+    const auto dds = ConvertJacketDds(srcPath, encoder);
     SaveDds(dstPath, dds);
 }
 
 void Image::ConvertStage(const fs::path &bgSrcPath, const fs::path &stSrcPath, const fs::path &stDstPath,
-                         const std::array<fs::path, 4> &fxSrcPaths) {
+                         const std::array<fs::path, 4> &fxSrcPaths, const DdsEncoder encoder) {
     const auto stAfb = ReadFileData(stSrcPath);
-    const auto bgDds = ConvertBackgroundDds(bgSrcPath);
-    const auto fxDds = ConvertEffectDds(fxSrcPaths);
+    const auto bgDds = ConvertBackgroundDds(bgSrcPath, encoder);
+    const auto fxDds = ConvertEffectDds(fxSrcPaths, encoder);
 
     const auto stChunks = LocateDdsChunks(stAfb);
     ReplaceChunks(stAfb, stDstPath, stChunks, {std::span<const uint8_t>(bgDds), std::span<const uint8_t>(fxDds)});
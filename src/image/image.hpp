@@ -4,14 +4,22 @@
 
 namespace Image {
 
+// Who compresses DDS blocks: DirectXTex, or the in-tree BC1/BC3 encoder at its fast (range fit) or
+// high-quality (cluster fit) level.
+enum class DdsEncoder {
+    DirectXTex,
+    Fast,
+    High
+};
+
 void Initialize();
 
 void EnsureValid(const fs::path &srcPath);
 
-void ConvertJacket(const fs::path &srcPath, const fs::path &dstPath);
+void ConvertJacket(const fs::path &srcPath, const fs::path &dstPath, DdsEncoder encoder = DdsEncoder::DirectXTex);
 
 void ConvertStage(const fs::path &bgSrcPath, const fs::path &stSrcPath, const fs::path &stDstPath,
-                  const std::array<fs::path, 4> &fxSrcPaths);
+                  const std::array<fs::path, 4> &fxSrcPaths, DdsEncoder encoder = DdsEncoder::DirectXTex);
 
 void ExtractDds(const fs::path &srcPath, const fs::path &dstFolder);
 
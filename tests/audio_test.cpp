@@ -1,21 +1,60 @@
 #include "common.hpp"
+#include "loudnorm_reference.hpp"
 
 #include "audio/audio.hpp"
 #include "audio/detail/analyze.hpp"
+#include "audio/detail/format.hpp"
+#include "audio/detail/frame_pool.hpp"
+#include "audio/detail/io.hpp"
+#include "audio/detail/loudnorm.hpp"
+#include "audio/detail/pipeline.hpp"
 #include "audio/detail/target_format.hpp"
+#include "audio/detail/wav_splice.hpp"
+#include "audio/detail/wav_writer.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <new>
+#include <numbers>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 using namespace Audio;
 using namespace Audio::detail;
 
+namespace {
+
+std::atomic<uint64_t> g_heapAllocations{0};
+
+} // namespace
+
+// Every C++ heap allocation in the test binary goes through here, so tests can check that a
+// steady-state loop does not allocate per frame. The other forms of operator new forward to it.
+void *operator new(const std::size_t size) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
 int main(const int argc, char *argv[]) {
     Setup();
     Initialize();
@@ -23,6 +62,12 @@ int main(const int argc, char *argv[]) {
     return ret;
 }
 
+std::vector<uint8_t> ReadBytes(const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    REQUIRE(in);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
 TEST_CASE("EnsureValid") {
     SECTION("Valid audio file") {
         REQUIRE_NOTHROW(EnsureValid(GetInputPath(L"test.mp3")));
@@ -30,6 +75,11 @@ TEST_CASE("EnsureValid") {
     SECTION("Invalid audio file") {
         REQUIRE_THROWS(EnsureValid(GetInputPath(L"a")));
     }
+    SECTION("Audio in memory") {
+        REQUIRE_NOTHROW(EnsureValid(ReadBytes(GetInputPath(L"test.mp3"))));
+        const std::vector<uint8_t> garbage(4096, 0x5a);
+        REQUIRE_THROWS(EnsureValid(garbage));
+    }
 }
 
 void PrintMeta(const AudioStreamMeta &meta) {
@@ -95,20 +145,150 @@ void WriteScaledPcm16Wav(const fs::path &srcPath, const fs::path &dstPath, const
     REQUIRE(out.good());
 }
 
+// Writes `src` with its data chunk repeated `times` times.
+void WriteLoopedWav(const fs::path &srcPath, const fs::path &dstPath, const int times) {
+    auto bytes = ReadBytes(srcPath);
+    REQUIRE(bytes.size() > 44);
+
+    const auto readU32 = [&](const size_t pos) {
+        return static_cast<uint32_t>(bytes[pos]) | (static_cast<uint32_t>(bytes[pos + 1]) << 8) |
+               (static_cast<uint32_t>(bytes[pos + 2]) << 16) | (static_cast<uint32_t>(bytes[pos + 3]) << 24);
+    };
+    const auto writeU32 = [&](const size_t pos, const uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            bytes[pos + i] = static_cast<uint8_t>((value >> (8 * i)) & 0xff);
+        }
+    };
+
+    for (size_t pos = 12; pos + 8 <= bytes.size();) {
+        const uint32_t chunkSize = readU32(pos + 4);
+        if (bytes[pos] == 'd' && bytes[pos + 1] == 'a' && bytes[pos + 2] == 't' && bytes[pos + 3] == 'a') {
+            const std::vector<uint8_t> data(bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8),
+                                            bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8 + chunkSize));
+            bytes.resize(pos + 8);
+            for (int i = 0; i < times; ++i) {
+                bytes.insert(bytes.end(), data.begin(), data.end());
+            }
+            writeU32(pos + 4, chunkSize * static_cast<uint32_t>(times));
+            writeU32(4, static_cast<uint32_t>(bytes.size() - 8));
+
+            std::ofstream out(dstPath, std::ios::binary);
+            out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            REQUIRE(out.good());
+            return;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    FAIL("No data chunk");
+}
+
+TEST_CASE("EnsureValid modes") {
+    SECTION("Fast mode") {
+        const ValidateOptions fast{ValidateMode::Fast};
+        REQUIRE_NOTHROW(EnsureValid(GetInputPath(L"test.mp3"), fast));
+        REQUIRE_NOTHROW(EnsureValid(GetInputPath(L"test.wav"), fast));
+        REQUIRE_NOTHROW(EnsureValid(ReadBytes(GetInputPath(L"test.mp3")), fast));
+        REQUIRE_THROWS(EnsureValid(GetInputPath(L"a"), fast));
+
+        // An extension naming the wrong format falls back to probing.
+        const auto misnamed = GetOutputPath(L"test7_wav.mp3");
+        fs::copy_file(GetInputPath(L"test.wav"), misnamed, fs::copy_options::overwrite_existing);
+        REQUIRE_NOTHROW(EnsureValid(misnamed, fast));
+    }
+    SECTION("Deep mode") {
+        const ValidateOptions deep{ValidateMode::Deep};
+        REQUIRE_NOTHROW(EnsureValid(GetInputPath(L"test.mp3"), deep));
+        REQUIRE_NOTHROW(EnsureValid(GetInputPath(L"test.wav"), deep));
+
+        // Cut mid-sample: the header still opens, only decoding the last packet fails.
+        const auto truncated = GetOutputPath(L"test7_truncated.wav");
+        WriteScaledPcm16Wav(GetInputPath(L"test.wav"), truncated, 1.0);
+        const auto region = FindWavData(truncated);
+        REQUIRE(region);
+        REQUIRE(region->Size > 8192);
+        fs::resize_file(truncated, region->Offset + (region->Size / 4096 - 1) * 4096 + 1);
+        REQUIRE_NOTHROW(EnsureValid(truncated));
+        REQUIRE_THROWS(EnsureValid(truncated, deep));
+    }
+    SECTION("Batch") {
+        const std::vector<fs::path> paths{GetInputPath(L"test.mp3"), GetInputPath(L"a"), GetInputPath(L"test.wav")};
+        for (const auto mode : {ValidateMode::Fast, ValidateMode::Standard, ValidateMode::Deep}) {
+            const auto results = EnsureValidBatch(paths, ValidateOptions{mode}, 2);
+            REQUIRE(results.size() == 3);
+            REQUIRE(results[0].Valid);
+            REQUIRE_FALSE(results[1].Valid);
+            REQUIRE_FALSE(results[1].Error.empty());
+            REQUIRE(results[2].Valid);
+        }
+    }
+}
+
 TEST_CASE("Analyze") {
     const auto meta = Analyze(GetInputPath(L"test.mp3"));
     PrintMeta(meta);
 }
 
+TEST_CASE("Native loudness meter matches FFmpeg") {
+    const auto target = MakeTargetFormat(NormalizeOptions{});
+
+    for (const auto *name : {L"test.wav", L"test.mp3"}) {
+        const auto path = GetInputPath(name);
+        const auto native = Measure(path);
+
+        const auto ifmt = OpenAVFormatInput(path);
+        const auto ist = GetBestAudioStream(ifmt);
+        const auto dctx = OpenDecoder(ist);
+        const auto reference = LoudNormReference::AnalyzeLoudNorm(ifmt, ist, dctx, 0.0, target);
+
+        REQUIRE(native.LoudNorm.InputI == Catch::Approx(reference.InputI).margin(0.1));
+        REQUIRE(native.LoudNorm.InputThresh == Catch::Approx(reference.InputThresh).margin(0.2));
+        REQUIRE(native.LoudNorm.InputLRA == Catch::Approx(reference.InputLRA).margin(1.0));
+        REQUIRE(native.LoudNorm.InputTP == Catch::Approx(reference.InputTP).margin(0.5));
+
+        // Both routes to the offset run FFmpeg's own loudnorm; only the meter on its output differs.
+        const AudioInput input(path);
+        const double targetOffset = MeasureTargetOffset(input, 0.0, target);
+        REQUIRE(targetOffset == Catch::Approx(reference.TargetOffset).margin(0.2));
+
+        PcmBuffer decoded(std::size_t{64} << 20);
+        const auto ifmt3 = OpenAVFormatInput(path);
+        const auto ist3 = GetBestAudioStream(ifmt3);
+        const auto dctx3 = OpenDecoder(ist3);
+        Measure(ifmt3, ist3, dctx3, 0.0, target, &decoded);
+        REQUIRE(MeasureTargetOffset(decoded, target) == Catch::Approx(targetOffset).margin(1e-9));
+
+        const auto ifmt4 = OpenAVFormatInput(path);
+        const auto ist4 = GetBestAudioStream(ifmt4);
+        const auto dctx4 = OpenDecoder(ist4);
+        const auto combined = Measure(ifmt4, ist4, dctx4, 0.0, target, nullptr, false, true);
+        REQUIRE(combined.LoudNorm.InputI == Catch::Approx(native.LoudNorm.InputI).margin(1e-9));
+        REQUIRE(combined.LoudNorm.TargetOffset == Catch::Approx(targetOffset).margin(1e-9));
+
+        const auto ifmt2 = OpenAVFormatInput(path);
+        const auto ist2 = GetBestAudioStream(ifmt2);
+        const auto dctx2 = OpenDecoder(ist2);
+        const auto ebur128 = AnalyzeEbur128(ifmt2, ist2, dctx2);
+
+        REQUIRE(native.Meta.Loudness == Catch::Approx(ebur128.Loudness).margin(0.1));
+        REQUIRE(native.Meta.TruePeak == Catch::Approx(ebur128.TruePeak).margin(0.5));
+        REQUIRE(native.Meta.SampleRate == ebur128.SampleRate);
+        REQUIRE(native.Meta.Channels == ebur128.Channels);
+    }
+}
+
 TEST_CASE("Normalize") {
     const auto srcPath = GetOutputPath(L"test1_quiet.wav");
     const auto dstPath = GetOutputPath(L"test1_normalized.wav");
     const auto customDstPath = GetOutputPath(L"test1_custom_normalized.wav");
     const auto tmpPath = GetOutputPath(L"test1_impossible.wav");
+    const auto twiceDstPath = GetOutputPath(L"test1_decoded_twice.wav");
+    const auto spilledDstPath = GetOutputPath(L"test1_spilled.wav");
 
     std::filesystem::remove(dstPath);
     std::filesystem::remove(customDstPath);
     std::filesystem::remove(tmpPath);
+    std::filesystem::remove(twiceDstPath);
+    std::filesystem::remove(spilledDstPath);
     WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
 
     SECTION("Normalize to FMT_PCM_S16LE at reference loudness") {
@@ -157,4 +337,816 @@ TEST_CASE("Normalize") {
         REQUIRE(meta.SampleFormat == options.SampleFormat);
         REQUIRE(meta.Loudness == Catch::Approx(options.Loudness).margin(0.3));
     }
+
+    SECTION("Linear gain keeps the loudness range") {
+        const auto source = Measure(srcPath);
+        NormalizeOptions options;
+        options.LoudnessRange = source.LoudNorm.InputLRA + 1.0;
+        options.TruePeak = 0.0;
+        options.Loudness = (std::min)(-14.0, options.TruePeak - source.LoudNorm.InputTP + source.LoudNorm.InputI - 0.5);
+        REQUIRE(LinearGain(source.LoudNorm, MakeTargetFormat(options)).has_value());
+
+        REQUIRE(Normalize(srcPath, dstPath, options));
+
+        const auto result = Measure(dstPath);
+        REQUIRE(result.Meta.Loudness == Catch::Approx(options.Loudness).margin(0.2));
+        REQUIRE(result.LoudNorm.InputLRA == Catch::Approx(source.LoudNorm.InputLRA).margin(0.2));
+        REQUIRE(result.Meta.TruePeak <= options.TruePeak + options.TruePeakTolerance);
+    }
+
+    SECTION("Normalize in memory matches the file output") {
+        NormalizeOptions options;
+        options.Offset = -0.1;
+        REQUIRE(Normalize(srcPath, dstPath, options));
+
+        const auto input = ReadBytes(srcPath);
+        std::vector<uint8_t> output;
+        REQUIRE(Normalize(input, output, options));
+        REQUIRE(output == ReadBytes(dstPath));
+
+        options.ReuseDecodedAudio = false;
+        std::vector<uint8_t> decodedTwice;
+        REQUIRE(Normalize(input, decodedTwice, options));
+        REQUIRE(decodedTwice == output);
+
+        std::vector<uint8_t> unchanged;
+        REQUIRE_FALSE(Normalize(output, unchanged, NormalizeOptions{}));
+        REQUIRE(unchanged.empty());
+    }
+
+    SECTION("Pipelined mode matches the serial output") {
+        NormalizeOptions options;
+        options.Offset = 0.25;
+        REQUIRE(Normalize(srcPath, dstPath, options));
+        const auto expected = ReadBytes(dstPath);
+
+        options.Pipelined = true;
+        REQUIRE(Normalize(srcPath, twiceDstPath, options));
+        REQUIRE(ReadBytes(twiceDstPath) == expected);
+
+        options.ReuseDecodedAudio = false;
+        REQUIRE(Normalize(srcPath, spilledDstPath, options));
+        REQUIRE(ReadBytes(spilledDstPath) == expected);
+    }
+
+    SECTION("Reusing decoded audio matches decoding twice") {
+        NormalizeOptions options;
+        options.Offset = 0.25;
+        options.ReuseDecodedAudio = false;
+        REQUIRE(Normalize(srcPath, twiceDstPath, options));
+
+        options.ReuseDecodedAudio = true;
+        REQUIRE(Normalize(srcPath, dstPath, options));
+
+        options.DecodedAudioMemoryLimit = 0;
+        REQUIRE(Normalize(srcPath, spilledDstPath, options));
+
+        const auto expected = ReadBytes(twiceDstPath);
+        REQUIRE(ReadBytes(dstPath) == expected);
+        REQUIRE(ReadBytes(spilledDstPath) == expected);
+    }
+
+    SECTION("Offset-only change splices the PCM data") {
+        REQUIRE(Normalize(srcPath, dstPath, NormalizeOptions{}));
+        const auto normalized = ReadBytes(dstPath);
+        const auto region = FindWavData(normalized);
+        REQUIRE(region);
+        const auto data = std::span(normalized).subspan(region->Offset, region->Size);
+        constexpr std::size_t kFrameBytes = 4; // stereo S16
+
+        NormalizeOptions options;
+        options.Offset = 0.5;
+        REQUIRE(Normalize(dstPath, twiceDstPath, options));
+        const auto delayed = ReadBytes(twiceDstPath);
+        const auto delayedRegion = FindWavData(delayed);
+        REQUIRE(delayedRegion);
+        REQUIRE(delayedRegion->Size == data.size() + 24000 * kFrameBytes);
+        const auto delayedData = std::span(delayed).subspan(delayedRegion->Offset, delayedRegion->Size);
+        REQUIRE(std::all_of(delayedData.begin(), delayedData.begin() + 24000 * kFrameBytes,
+                            [](const uint8_t b) { return b == 0; }));
+        REQUIRE(std::equal(data.begin(), data.end(), delayedData.begin() + 24000 * kFrameBytes));
+
+        options.Offset = -0.25;
+        REQUIRE(Normalize(dstPath, spilledDstPath, options));
+        const auto trimmed = ReadBytes(spilledDstPath);
+        const auto trimmedRegion = FindWavData(trimmed);
+        REQUIRE(trimmedRegion);
+        REQUIRE(trimmedRegion->Size == data.size() - 12000 * kFrameBytes);
+        REQUIRE(std::equal(data.begin() + 12000 * kFrameBytes, data.end(), trimmed.begin() + trimmedRegion->Offset));
+
+        std::vector<uint8_t> inMemory;
+        REQUIRE(Normalize(normalized, inMemory, options));
+        REQUIRE(inMemory == trimmed);
+
+        const auto meta = Analyze(spilledDstPath);
+        REQUIRE(meta.SampleRate == 48000);
+        REQUIRE(meta.Channels == 2);
+        REQUIRE(meta.SampleFormat == AV_SAMPLE_FMT_S16);
+    }
+}
+
+TEST_CASE("NormalizeBatch") {
+    const auto srcPath = GetOutputPath(L"test2_quiet.wav");
+    const auto singlePath = GetOutputPath(L"test2_single.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
+    fs::remove(singlePath);
+
+    NormalizeOptions options;
+    REQUIRE(Normalize(srcPath, singlePath, options));
+
+    std::vector<NormalizeJob> jobs;
+    for (int i = 0; i < 4; ++i) {
+        const auto dst = GetOutputPath(L"test2_batch_" + std::to_wstring(i) + L".wav");
+        fs::remove(dst);
+        jobs.push_back({srcPath, dst, options});
+    }
+    jobs.push_back({GetInputPath(L"a"), GetOutputPath(L"test2_batch_invalid.wav"), options});
+    jobs.push_back({singlePath, GetOutputPath(L"test2_batch_unchanged.wav"), options});
+
+    const auto results = NormalizeBatch(jobs, 2);
+    REQUIRE(results.size() == jobs.size());
+
+    const auto expected = ReadBytes(singlePath);
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(results[i].Status == NormalizeStatus::Normalized);
+        REQUIRE(results[i].Error.empty());
+        REQUIRE(ReadBytes(jobs[i].Dst) == expected);
+    }
+    REQUIRE(results[4].Status == NormalizeStatus::Failed);
+    REQUIRE_FALSE(results[4].Error.empty());
+    REQUIRE(results[5].Status == NormalizeStatus::Unchanged);
+    REQUIRE_FALSE(fs::exists(jobs[5].Dst));
+}
+
+TEST_CASE("AnalysisCache") {
+    const auto srcPath = GetOutputPath(L"test3_quiet.wav");
+    const auto cachePath = GetOutputPath(L"test3_loudness.cache");
+    const auto uncachedPath = GetOutputPath(L"test3_uncached.wav");
+    const auto missPath = GetOutputPath(L"test3_miss.wav");
+    const auto hitPath = GetOutputPath(L"test3_hit.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
+    fs::remove(cachePath);
+
+    NormalizeOptions options;
+    REQUIRE(Normalize(srcPath, uncachedPath, options));
+
+    {
+        AnalysisCache cache(cachePath);
+        options.Cache = &cache;
+        REQUIRE(Normalize(srcPath, missPath, options));
+        REQUIRE(cache.Hits() == 0);
+        REQUIRE(cache.Misses() == 1);
+    }
+
+    SECTION("Reopened cache hits and produces the same output") {
+        AnalysisCache cache(cachePath);
+        options.Cache = &cache;
+        REQUIRE(Normalize(srcPath, hitPath, options));
+        REQUIRE(cache.Hits() == 1);
+        REQUIRE(cache.Misses() == 0);
+
+        const auto expected = ReadBytes(uncachedPath);
+        REQUIRE(ReadBytes(missPath) == expected);
+        REQUIRE(ReadBytes(hitPath) == expected);
+    }
+
+    SECTION("Changed content or offset misses") {
+        AnalysisCache cache(cachePath);
+        options.Cache = &cache;
+
+        options.Offset = 0.25;
+        REQUIRE(Normalize(srcPath, hitPath, options));
+        REQUIRE(cache.Misses() == 1);
+
+        options.Offset = 0.0;
+        WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.2);
+        REQUIRE(Normalize(srcPath, hitPath, options));
+        REQUIRE(cache.Misses() == 2);
+        REQUIRE(cache.Hits() == 0);
+    }
+
+    SECTION("Changed target misses") {
+        fs::remove(cachePath);
+        AnalysisCache cache(cachePath);
+        options.Cache = &cache;
+
+        // Recorded for a target the source reaches with a constant gain, so without loudnorm's
+        // target offset, which the default target's dynamic pass needs.
+        auto linear = options;
+        linear.Loudness = -30.0;
+        linear.LoudnessRange = 20.0;
+        NormalizeStats stats;
+        REQUIRE(Normalize(srcPath, hitPath, linear, &stats));
+        REQUIRE(stats.LinearGain);
+
+        REQUIRE(Normalize(srcPath, hitPath, options, &stats));
+        REQUIRE_FALSE(stats.LinearGain);
+        REQUIRE_FALSE(stats.CacheHit);
+        REQUIRE(cache.Hits() == 0);
+        REQUIRE(ReadBytes(hitPath) == ReadBytes(uncachedPath));
+    }
+}
+
+TEST_CASE("Normalize allocates nothing per frame") {
+    const auto shortPath = GetOutputPath(L"test4_short.wav");
+    const auto longPath = GetOutputPath(L"test4_long.wav");
+    const auto dstPath = GetOutputPath(L"test4_normalized.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), shortPath, 0.25);
+    WriteLoopedWav(shortPath, longPath, 8);
+
+    // The long input has eight times the short one's frames. Containers that grow geometrically
+    // with the input may reallocate a few more times, but nothing may allocate per frame.
+    constexpr uint64_t kGrowthSlack = 64;
+    // Two stage queues, one frame held by each of the three stages, and the packets.
+    constexpr uint64_t kPoolBound = 2 * pipeline_detail::kStageDepth + 8;
+
+    NormalizeOptions options;
+    options.AnalysisThreads = 1;
+    options.RenderThreads = 1;
+    for (const bool pipelined : {false, true}) {
+        for (const bool reuse : {true, false}) {
+            options.Pipelined = pipelined;
+            options.ReuseDecodedAudio = reuse;
+
+            std::array<uint64_t, 2> heap{};
+            std::array<uint64_t, 2> pooled{};
+            std::array<bool, 2> written{};
+            for (size_t i = 0; i < 2; ++i) {
+                const auto heapBefore = g_heapAllocations.load();
+                const auto pooledBefore = FramePool::Allocations();
+                written[i] = Normalize(i == 0 ? shortPath : longPath, dstPath, options);
+                heap[i] = g_heapAllocations.load() - heapBefore;
+                pooled[i] = FramePool::Allocations() - pooledBefore;
+            }
+
+            CAPTURE(pipelined, reuse, heap, pooled);
+            REQUIRE(written[0]);
+            REQUIRE(written[1]);
+            REQUIRE(heap[1] <= heap[0] + kGrowthSlack);
+            REQUIRE(pooled[0] <= kPoolBound);
+            REQUIRE(pooled[1] <= kPoolBound);
+        }
+    }
+}
+
+TEST_CASE("WavWriter") {
+    const auto path = GetOutputPath(L"wav_writer.wav");
+
+    // Data written in uneven pieces, larger than one write block, must come back unchanged and be
+    // read by FFmpeg with the format it was written as.
+    const auto roundTrip = [&](const WavFormat &format, const std::size_t bytes) {
+        std::vector<uint8_t> data(bytes);
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+        }
+        const auto blockAlign =
+            static_cast<std::size_t>(av_get_bytes_per_sample(format.SampleFormat)) * format.Channels;
+        const auto frames = static_cast<int64_t>(bytes / blockAlign);
+
+        std::vector<uint8_t> memory;
+        {
+            WavWriter file(path, format, frames);
+            WavWriter inMemory(memory, format, frames);
+            for (std::size_t pos = 0; pos < data.size();) {
+                const auto count = (std::min)(data.size() - pos, blockAlign * 1237);
+                file.Write(std::span(data).subspan(pos, count));
+                inMemory.Write(std::span(data).subspan(pos, count));
+                pos += count;
+            }
+            file.Finish();
+            inMemory.Finish();
+            REQUIRE(file.Frames() == frames);
+        }
+
+        const auto written = ReadBytes(path);
+        REQUIRE(written == memory);
+        const auto header = WavWriter::HeaderSize(format);
+        REQUIRE(written.size() == header + bytes + (bytes & 1));
+        REQUIRE(std::equal(data.begin(), data.end(), written.begin() + static_cast<std::ptrdiff_t>(header)));
+
+        const auto meta = Analyze(path);
+        REQUIRE(meta.SampleFormat == format.SampleFormat);
+        REQUIRE(meta.SampleRate == format.SampleRate);
+        REQUIRE(meta.Channels == format.Channels);
+        REQUIRE(meta.CodecId == CodecIdForSampleFormat(format.SampleFormat));
+    };
+
+    SECTION("16-bit stereo") {
+        roundTrip({AV_SAMPLE_FMT_S16, 48000, 2}, 3 * 1024 * 1024 + 400);
+    }
+    SECTION("Float at 96 kHz uses WAVE_FORMAT_EXTENSIBLE") {
+        roundTrip({AV_SAMPLE_FMT_FLT, 96000, 2}, 8 * 96000);
+    }
+    SECTION("Odd-sized data chunk is padded") {
+        roundTrip({AV_SAMPLE_FMT_U8, 8000, 1}, 8001);
+    }
+}
+
+TEST_CASE("Only plain PCM and FLAC seek exactly") {
+    REQUIRE(HasExactSeek(AV_CODEC_ID_PCM_S16LE));
+    REQUIRE(HasExactSeek(AV_CODEC_ID_PCM_S24LE_PLANAR));
+    REQUIRE(HasExactSeek(AV_CODEC_ID_PCM_F32LE));
+    REQUIRE(HasExactSeek(AV_CODEC_ID_FLAC));
+
+    REQUIRE_FALSE(HasExactSeek(AV_CODEC_ID_PCM_S302M));
+    REQUIRE_FALSE(HasExactSeek(AV_CODEC_ID_PCM_DVD));
+    REQUIRE_FALSE(HasExactSeek(AV_CODEC_ID_PCM_BLURAY));
+    REQUIRE_FALSE(HasExactSeek(AV_CODEC_ID_MP3));
+}
+
+TEST_CASE("Segmented analysis matches the serial pass") {
+    const auto shortPath = GetOutputPath(L"test5_short.wav");
+    const auto longPath = GetOutputPath(L"test5_long.wav");
+    const auto dstPath = GetOutputPath(L"test5_normalized.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), shortPath, 0.5);
+
+    // Long enough for four segments of at least 30 s.
+    const auto shortMeta = Analyze(shortPath);
+    const auto region = FindWavData(shortPath);
+    REQUIRE(region);
+    const int frameBytes = shortMeta.Channels * av_get_bytes_per_sample(shortMeta.SampleFormat);
+    const double seconds = static_cast<double>(region->Size) / (shortMeta.SampleRate * frameBytes);
+    WriteLoopedWav(shortPath, longPath, static_cast<int>(std::ceil(130.0 / seconds)));
+
+    NormalizeOptions options;
+    const auto target = MakeTargetFormat(options);
+    for (const double offset : {0.0, 1.25, -2.5}) {
+        AudioInput input(longPath);
+        const auto ifmt = input.Open();
+        const auto ist = GetBestAudioStream(ifmt);
+        const auto dctx = OpenDecoder(ist);
+
+        const auto segmented = MeasureSegmented(input, ifmt, ist, dctx, offset, target, 4);
+        REQUIRE(segmented);
+        const auto serial = Measure(ifmt, ist, dctx, offset, target);
+
+        REQUIRE(segmented->LoudNorm.InputI == Catch::Approx(serial.LoudNorm.InputI).margin(1e-6));
+        REQUIRE(segmented->LoudNorm.InputThresh == Catch::Approx(serial.LoudNorm.InputThresh).margin(1e-6));
+        REQUIRE(segmented->LoudNorm.InputLRA == Catch::Approx(serial.LoudNorm.InputLRA).margin(1e-6));
+        REQUIRE(segmented->LoudNorm.InputTP == Catch::Approx(serial.LoudNorm.InputTP).margin(1e-6));
+    }
+
+    options.AnalysisThreads = 4;
+    REQUIRE(Normalize(longPath, dstPath, options));
+    REQUIRE(Analyze(dstPath).Loudness == Catch::Approx(options.Loudness).margin(0.2));
+}
+
+TEST_CASE("Segmented render matches the serial pass") {
+    const auto shortPath = GetOutputPath(L"test6_short.wav");
+    const auto longPath = GetOutputPath(L"test6_long.wav");
+    const auto serialPath = GetOutputPath(L"test6_serial.wav");
+    const auto segmentedPath = GetOutputPath(L"test6_segmented.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), shortPath, 0.5);
+
+    const auto shortMeta = Analyze(shortPath);
+    const auto region = FindWavData(shortPath);
+    REQUIRE(region);
+    const int frameBytes = shortMeta.Channels * av_get_bytes_per_sample(shortMeta.SampleFormat);
+    const double seconds = static_cast<double>(region->Size) / (shortMeta.SampleRate * frameBytes);
+    WriteLoopedWav(shortPath, longPath, static_cast<int>(std::ceil(130.0 / seconds)));
+
+    // A quiet target with a wide range keeps the correction a linear gain.
+    NormalizeOptions options;
+    options.Loudness = -20.0;
+    options.LoudnessRange = 20.0;
+    options.ReuseDecodedAudio = false;
+
+    const auto compare = [&] {
+        NormalizeOptions segmented = options;
+        segmented.RenderThreads = 4;
+        REQUIRE(Normalize(longPath, serialPath, options));
+        REQUIRE(Normalize(longPath, segmentedPath, segmented));
+
+        const auto serialBytes = ReadBytes(serialPath);
+        const auto segmentedBytes = ReadBytes(segmentedPath);
+        const auto serialData = FindWavData(serialBytes);
+        const auto segmentedData = FindWavData(segmentedBytes);
+        REQUIRE(serialData);
+        REQUIRE(segmentedData);
+        REQUIRE(serialData->Size == segmentedData->Size);
+
+        // Within 1 LSB of the serial output, sample for sample.
+        int maxDiff = 0;
+        for (uint64_t i = 0; i + 1 < serialData->Size; i += 2) {
+            const auto sample = [](const std::vector<uint8_t> &bytes, const uint64_t pos) {
+                return static_cast<int16_t>(bytes[pos] | (bytes[pos + 1] << 8));
+            };
+            const int a = sample(serialBytes, serialData->Offset + i);
+            const int b = sample(segmentedBytes, segmentedData->Offset + i);
+            maxDiff = (std::max)(maxDiff, std::abs(a - b));
+        }
+        REQUIRE(maxDiff <= 1);
+    };
+
+    SECTION("Same rate") {
+        for (const double offset : {0.0, 1.25, -2.5}) {
+            options.Offset = offset;
+            compare();
+        }
+    }
+
+    SECTION("Resampled") {
+        options.SampleRate = 44100;
+        options.Offset = 0.75;
+        compare();
+    }
+}
+
+TEST_CASE("Fan-out writes every output from one decode") {
+    const auto srcPath = GetOutputPath(L"test8_quiet.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
+
+    NormalizeOptions asset;
+    NormalizeOptions preview;
+    preview.SampleRate = 44100;
+    NormalizeOptions master;
+    master.SampleFormat = AV_SAMPLE_FMT_FLT;
+
+    const std::vector<NormalizeOutput> outputs{
+        {GetOutputPath(L"test8_asset.wav"), asset},
+        {GetOutputPath(L"test8_preview.wav"), preview},
+        {GetOutputPath(L"test8_master.wav"), master},
+    };
+    const auto statuses = NormalizeFanOut(srcPath, outputs);
+    REQUIRE(statuses.size() == outputs.size());
+
+    const auto separatePath = GetOutputPath(L"test8_separate.wav");
+    for (const auto &output : outputs) {
+        INFO(lib::PathToUtf8(output.Dst));
+        REQUIRE(statuses[&output - outputs.data()] == NormalizeStatus::Normalized);
+
+        const auto meta = Analyze(output.Dst);
+        REQUIRE(meta.SampleRate == output.Options.SampleRate);
+        REQUIRE(meta.SampleFormat == output.Options.SampleFormat);
+        REQUIRE(meta.Channels == 2);
+
+        // Same result as normalizing into that format on its own.
+        REQUIRE(Normalize(srcPath, separatePath, output.Options));
+        const auto separate = Analyze(separatePath);
+        REQUIRE(meta.Loudness == Catch::Approx(separate.Loudness).margin(0.05));
+        REQUIRE(FindWavData(output.Dst)->Size == FindWavData(separatePath)->Size);
+    }
+
+    SECTION("Outputs must share everything but the format") {
+        auto louder = preview;
+        louder.Loudness = -6.0;
+        const std::vector<NormalizeOutput> mismatched{{GetOutputPath(L"test8_a.wav"), asset},
+                                                      {GetOutputPath(L"test8_b.wav"), louder}};
+        REQUIRE_THROWS(NormalizeFanOut(srcPath, mismatched));
+    }
+}
+
+TEST_CASE("Waveform sidecar") {
+    const auto srcPath = GetOutputPath(L"test9_quiet.wav");
+    const auto dstPath = GetOutputPath(L"test9_normalized.wav");
+    const auto sidecarPath = GetOutputPath(L"test9_normalized.wave");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
+
+    NormalizeOptions options;
+    options.Waveform = sidecarPath;
+    REQUIRE(Normalize(srcPath, dstPath, options));
+
+    const auto sidecar = ReadBytes(sidecarPath);
+    REQUIRE(sidecar.size() >= sizeof(WaveformHeader));
+    WaveformHeader header;
+    std::memcpy(&header, sidecar.data(), sizeof(header));
+    REQUIRE(std::string_view(header.Magic) == "MUAWAVE");
+    REQUIRE(header.Version == kWaveformVersion);
+    REQUIRE(header.SampleRate == 48000);
+    REQUIRE(header.Channels == 2);
+    REQUIRE(header.LevelCount >= 1);
+
+    const auto output = ReadBytes(dstPath);
+    const auto data = FindWavData(output);
+    REQUIRE(data);
+    const uint64_t frames = data->Size / 4;
+    REQUIRE(header.Frames == frames);
+    const auto sample = [&](const uint64_t frame, const int channel) {
+        const auto pos = data->Offset + frame * 4 + channel * 2;
+        return static_cast<int16_t>(output[pos] | (output[pos + 1] << 8));
+    };
+
+    std::vector<WaveformLevel> levels(header.LevelCount);
+    std::memcpy(levels.data(), sidecar.data() + sizeof(header), levels.size() * sizeof(WaveformLevel));
+    for (const auto &level : levels) {
+        INFO("samples per bucket " << level.SamplesPerBucket);
+        REQUIRE(level.Offset % 8 == 0);
+        REQUIRE(level.Buckets == (frames + level.SamplesPerBucket - 1) / level.SamplesPerBucket);
+        REQUIRE(level.Offset + level.Buckets * 8 <= sidecar.size());
+
+        // Every bucket holds the exact extremes of the output samples it covers.
+        std::vector<int16_t> peaks(level.Buckets * 4);
+        std::memcpy(peaks.data(), sidecar.data() + level.Offset, peaks.size() * sizeof(int16_t));
+        for (uint64_t b = 0; b < level.Buckets; b += 97) {
+            for (int c = 0; c < 2; ++c) {
+                int16_t lo = std::numeric_limits<int16_t>::max();
+                int16_t hi = std::numeric_limits<int16_t>::min();
+                const uint64_t end = (std::min)(frames, (b + 1) * level.SamplesPerBucket);
+                for (uint64_t f = b * level.SamplesPerBucket; f < end; ++f) {
+                    lo = (std::min)(lo, sample(f, c));
+                    hi = (std::max)(hi, sample(f, c));
+                }
+                REQUIRE(peaks[b * 4 + c * 2] == lo);
+                REQUIRE(peaks[b * 4 + c * 2 + 1] == hi);
+            }
+        }
+    }
+
+    // One momentary loudness value per complete 100 ms, loud enough in places to reach the target.
+    REQUIRE(header.LoudnessIntervalMs == 100);
+    REQUIRE(header.LoudnessOffset % 8 == 0);
+    REQUIRE(header.LoudnessCount == frames / 4800);
+    REQUIRE(header.LoudnessOffset + header.LoudnessCount * sizeof(float) <= sidecar.size());
+    std::vector<float> loudness(header.LoudnessCount);
+    std::memcpy(loudness.data(), sidecar.data() + header.LoudnessOffset, loudness.size() * sizeof(float));
+    REQUIRE(*std::ranges::max_element(loudness) > options.Loudness);
+    REQUIRE(*std::ranges::max_element(loudness) < 0.0f);
+    REQUIRE(*std::ranges::min_element(loudness) >= -99.0f);
+}
+
+TEST_CASE("Normalize stats") {
+    const auto srcPath = GetOutputPath(L"test10_quiet.wav");
+    const auto dstPath = GetOutputPath(L"test10_normalized.wav");
+    const auto unchangedPath = GetOutputPath(L"test10_unchanged.wav");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
+    fs::remove(unchangedPath);
+
+    const auto cachePath = GetOutputPath(L"test10_cache.bin");
+    fs::remove(cachePath);
+    AnalysisCache cache(cachePath);
+
+    NormalizeOptions options;
+    NormalizeStats stats;
+
+    // Replaying the decoded audio, seeking back to the start and reusing a cached analysis each split
+    // the render stage differently; none of them may count any of it twice.
+    const auto check = [&](const bool reuseDecodedAudio, AnalysisCache *analysisCache, const bool cacheHit) {
+        CAPTURE(reuseDecodedAudio, analysisCache != nullptr, cacheHit);
+        options.ReuseDecodedAudio = reuseDecodedAudio;
+        options.Cache = analysisCache;
+        REQUIRE(Normalize(srcPath, dstPath, options, &stats));
+
+        REQUIRE(stats.Route == "graph");
+        REQUIRE(stats.Codec == "pcm_s16le");
+        REQUIRE(stats.CacheHit == cacheHit);
+        REQUIRE(stats.NeedLoudNorm);
+        REQUIRE_FALSE(stats.NeedOffset);
+        REQUIRE(stats.BytesWritten == fs::file_size(dstPath));
+        REQUIRE(stats.BytesRead > 0);
+        REQUIRE(stats.InputFrames > 0);
+        REQUIRE(stats.InputSeconds > 0.0);
+        REQUIRE(stats.RealtimeFactor > 0.0);
+
+        for (const auto *timing : {&stats.Open, &stats.Analysis, &stats.Seek, &stats.Render, &stats.Total}) {
+            REQUIRE(timing->WallSeconds >= 0.0);
+            REQUIRE(timing->CpuSeconds >= 0.0);
+        }
+        REQUIRE(stats.Render.WallSeconds > 0.0);
+        REQUIRE(stats.Total.WallSeconds >= stats.Open.WallSeconds + stats.Analysis.WallSeconds +
+                                               stats.Seek.WallSeconds + stats.Render.WallSeconds);
+        REQUIRE(stats.DecodeSeconds + stats.FilterSeconds + stats.WriteSeconds <= stats.Render.WallSeconds);
+    };
+    check(true, nullptr, false);
+    check(false, nullptr, false);
+    check(true, &cache, false);
+    check(true, &cache, true);
+    options = {};
+
+    // A source that already meets the target is reported as such, and nothing is written.
+    REQUIRE_FALSE(Normalize(dstPath, unchangedPath, options, &stats));
+    REQUIRE(stats.Route == "unchanged");
+    REQUIRE_FALSE(stats.NeedLoudNorm);
+    REQUIRE(stats.BytesWritten == 0);
+    REQUIRE(stats.Seek.WallSeconds == 0.0);
+}
+
+// Writes `seconds` of a stereo float sine at `frequency` and peak `amplitude`.
+void WriteToneWav(const fs::path &path, const int sampleRate, const double frequency, const double amplitude,
+                  const int seconds) {
+    const int64_t frames = int64_t{sampleRate} * seconds;
+    std::vector<float> samples(static_cast<std::size_t>(frames) * 2);
+    for (int64_t i = 0; i < frames; ++i) {
+        const double phase = 2.0 * std::numbers::pi * frequency * static_cast<double>(i) / sampleRate;
+        const auto value = static_cast<float>(amplitude * std::sin(phase));
+        samples[i * 2] = value;
+        samples[i * 2 + 1] = value;
+    }
+    WavWriter writer(path, WavFormat{AV_SAMPLE_FMT_FLT, sampleRate, 2}, frames);
+    writer.Write({reinterpret_cast<const uint8_t *>(samples.data()), samples.size() * sizeof(float)});
+    writer.Finish();
+}
+
+// RMS level of the left channel of a stereo float WAV relative to a full-scale sine of peak
+// `amplitude`, in dB, over the middle half so filter edges do not count.
+double ToneLevelDb(const fs::path &path, const double amplitude) {
+    const auto bytes = ReadBytes(path);
+    const auto data = FindWavData(bytes);
+    REQUIRE(data);
+    const uint64_t frames = data->Size / (2 * sizeof(float));
+    double sum = 0.0;
+    for (uint64_t i = frames / 4; i < frames * 3 / 4; ++i) {
+        float value;
+        std::memcpy(&value, bytes.data() + data->Offset + i * 2 * sizeof(float), sizeof(float));
+        sum += static_cast<double>(value) * value;
+    }
+    const double rms = std::sqrt(sum / static_cast<double>(frames / 2));
+    return 20.0 * std::log10(rms / (amplitude / std::sqrt(2.0)) + 1e-30);
+}
+
+// Options that only convert the rate: the tolerances are wide enough that no loudness correction
+// is ever applied.
+NormalizeOptions ResampleOnlyOptions(const ResampleQuality quality) {
+    NormalizeOptions options;
+    options.SampleFormat = AV_SAMPLE_FMT_FLT;
+    options.SampleRate = 48000;
+    options.Resampler = quality;
+    options.GainTolerance = 1000.0;
+    options.TruePeakTolerance = 1000.0;
+    options.LoudnessRangeTolerance = 1000.0;
+    return options;
+}
+
+double ResampledToneLevelDb(const ResampleQuality quality, const double frequency) {
+    constexpr double kAmplitude = 0.5;
+    const auto srcPath = GetOutputPath(L"test11_tone.wav");
+    const auto dstPath = GetOutputPath(L"test11_resampled.wav");
+    WriteToneWav(srcPath, 96000, frequency, kAmplitude, 2);
+    REQUIRE(Normalize(srcPath, dstPath, ResampleOnlyOptions(quality)));
+    return ToneLevelDb(dstPath, kAmplitude);
+}
+
+TEST_CASE("Resampler presets") {
+    constexpr std::array qualities{ResampleQuality::Fast, ResampleQuality::Default, ResampleQuality::High};
+
+    SECTION("Passband") {
+        for (const auto quality : qualities) {
+            INFO("preset " << static_cast<int>(quality));
+            REQUIRE(std::abs(ResampledToneLevelDb(quality, 1000.0)) < 0.1);
+        }
+    }
+
+    SECTION("Roll-off near Nyquist") {
+        // 22 kHz at 48 kHz output: above Fast's passband, at the edge of Default's, inside High's.
+        const auto fast = ResampledToneLevelDb(ResampleQuality::Fast, 22000.0);
+        const auto normal = ResampledToneLevelDb(ResampleQuality::Default, 22000.0);
+        const auto high = ResampledToneLevelDb(ResampleQuality::High, 22000.0);
+        REQUIRE(fast < -6.0);
+        REQUIRE(fast < normal);
+        REQUIRE(normal < high);
+        REQUIRE(high > -0.5);
+    }
+
+    SECTION("Aliasing") {
+        // 40 kHz cannot be represented at 48 kHz; whatever comes out is aliased to 8 kHz.
+        for (const auto quality : qualities) {
+            INFO("preset " << static_cast<int>(quality));
+            REQUIRE(ResampledToneLevelDb(quality, 40000.0) < -60.0);
+        }
+        REQUIRE(ResampledToneLevelDb(ResampleQuality::High, 40000.0) <
+                ResampledToneLevelDb(ResampleQuality::Default, 40000.0));
+    }
+}
+
+TEST_CASE("Resampler benchmarks", "[.][!benchmark][audio]") {
+    constexpr std::array<std::pair<ResampleQuality, const char *>, 3> presets{{
+        {ResampleQuality::Fast, "fast"},
+        {ResampleQuality::Default, "default"},
+        {ResampleQuality::High, "high"},
+    }};
+
+    std::cout << "preset   1 kHz  20 kHz  22 kHz  26 kHz  40 kHz (dB)" << std::endl;
+    for (const auto &[quality, name] : presets) {
+        std::cout << fmt::format("{:<7}", name);
+        for (const double frequency : {1000.0, 20000.0, 22000.0, 26000.0, 40000.0}) {
+            std::cout << fmt::format(" {:7.1f}", ResampledToneLevelDb(quality, frequency));
+        }
+        std::cout << std::endl;
+    }
+
+    const auto srcPath = GetOutputPath(L"benchmark_tone.wav");
+    const auto dstPath = GetOutputPath(L"benchmark_resampled.wav");
+    WriteToneWav(srcPath, 96000, 1000.0, 0.5, 60);
+    for (const auto &[quality, name] : presets) {
+        const auto options = ResampleOnlyOptions(quality);
+        BENCHMARK(fmt::format("Resample 60 s 96 kHz to 48 kHz ({})", name)) {
+            return Normalize(srcPath, dstPath, options);
+        };
+    }
+}
+
+TEST_CASE("Loudness analysis benchmarks", "[.][!benchmark][audio]") {
+    const auto target = MakeTargetFormat(NormalizeOptions{});
+    const auto path = GetOutputPath(L"benchmark_analysis_tone.wav");
+    WriteToneWav(path, 48000, 1000.0, 0.5, 60);
+
+    BENCHMARK("Native meter, 60 s 48 kHz") {
+        const auto ifmt = OpenAVFormatInput(path);
+        const auto ist = GetBestAudioStream(ifmt);
+        const auto dctx = OpenDecoder(ist);
+        return Measure(ifmt, ist, dctx, 0.0, target);
+    };
+    BENCHMARK("Native meter and target offset, 60 s 48 kHz") {
+        const auto ifmt = OpenAVFormatInput(path);
+        const auto ist = GetBestAudioStream(ifmt);
+        const auto dctx = OpenDecoder(ist);
+        return Measure(ifmt, ist, dctx, 0.0, target, nullptr, false, true);
+    };
+    BENCHMARK("loudnorm first pass, 60 s 48 kHz") {
+        const auto ifmt = OpenAVFormatInput(path);
+        const auto ist = GetBestAudioStream(ifmt);
+        const auto dctx = OpenDecoder(ist);
+        return LoudNormReference::AnalyzeLoudNorm(ifmt, ist, dctx, 0.0, target);
+    };
+}
+
+TEST_CASE("Normalize preview") {
+    const auto srcPath = GetOutputPath(L"test12_tone.wav");
+    const auto fullPath = GetOutputPath(L"test12_full.wav");
+    const auto previewPath = GetOutputPath(L"test12_preview.wav");
+    const auto cachePath = GetOutputPath(L"test12_cache.bin");
+    WriteToneWav(srcPath, 48000, 1000.0, 0.1, 20);
+    fs::remove(cachePath);
+
+    NormalizeOptions options;
+    PreviewOptions preview;
+    preview.Start = 5.0;
+    preview.Duration = 4.0;
+    preview.FadeIn = 0.5;
+    preview.FadeOut = 1.0;
+
+    SECTION("Matches the full render between the fades") {
+        REQUIRE(Normalize(srcPath, fullPath, options));
+        NormalizePreview(srcPath, previewPath, options, preview);
+
+        const auto full = ReadBytes(fullPath);
+        const auto excerpt = ReadBytes(previewPath);
+        const auto fullData = FindWavData(full);
+        const auto excerptData = FindWavData(excerpt);
+        REQUIRE(fullData);
+        REQUIRE(excerptData);
+        REQUIRE(excerptData->Size == 4 * 48000 * 4);
+
+        const auto sample = [](const std::vector<uint8_t> &bytes, const WavDataRegion &data, const uint64_t frame) {
+            const auto pos = data.Offset + frame * 4;
+            return static_cast<int16_t>(bytes[pos] | (bytes[pos + 1] << 8));
+        };
+        for (uint64_t i = 48000; i < 3 * 48000; ++i) {
+            INFO("frame " << i);
+            REQUIRE(std::abs(sample(excerpt, *excerptData, i) - sample(full, *fullData, 5 * 48000 + i)) <= 1);
+        }
+        for (uint64_t i = 0; i < 48; ++i) {
+            REQUIRE(std::abs(sample(excerpt, *excerptData, i)) < 100);
+            REQUIRE(std::abs(sample(excerpt, *excerptData, 4 * 48000 - 1 - i)) < 100);
+        }
+    }
+
+    SECTION("Reuses cached loudness") {
+        AnalysisCache cache(cachePath);
+        options.Cache = &cache;
+        NormalizePreview(srcPath, previewPath, options, preview);
+        REQUIRE(cache.Misses() == 1);
+        NormalizePreview(srcPath, previewPath, options, preview);
+        REQUIRE(cache.Hits() == 1);
+    }
+
+    SECTION("Starts after the end") {
+        preview.Start = 30.0;
+        REQUIRE_THROWS(NormalizePreview(srcPath, previewPath, options, preview));
+    }
+}
+
+TEST_CASE("Plan") {
+    const auto srcPath = GetOutputPath(L"test13_quiet.wav");
+    const auto dstPath = GetOutputPath(L"test13_normalized.wav");
+    const auto cachePath = GetOutputPath(L"test13_cache.bin");
+    WriteScaledPcm16Wav(GetInputPath(L"test.wav"), srcPath, 0.25);
+    fs::remove(cachePath);
+
+    NormalizeOptions options;
+    const auto before = Plan(srcPath, options);
+    REQUIRE(before.Codec == "pcm_s16le");
+    REQUIRE(before.SampleRate > 0);
+    REQUIRE(before.DurationSeconds > 0.0);
+    REQUIRE(before.Loudness < -15.0);
+    REQUIRE(before.NeedLoudNorm);
+    REQUIRE_FALSE(before.NeedOffset);
+    REQUIRE_FALSE(before.Noop());
+    REQUIRE(before.Noop() == !Normalize(srcPath, dstPath, options));
+
+    const auto after = Plan(ReadBytes(dstPath), options);
+    REQUIRE(after.Noop());
+    REQUIRE(after.Loudness == Catch::Approx(options.Loudness).margin(0.2));
+
+    auto shifted = options;
+    shifted.Offset = 0.5;
+    REQUIRE(Plan(dstPath, shifted).NeedOffset);
+
+    SECTION("Cached") {
+        AnalysisCache cache(cachePath);
+        options.Cache = &cache;
+        REQUIRE_FALSE(Plan(srcPath, options).CacheHit);
+        const auto cached = Plan(srcPath, options);
+        REQUIRE(cached.CacheHit);
+        REQUIRE(cached.Loudness == Catch::Approx(before.Loudness).margin(0.01));
+    }
 }
@@ -0,0 +1,108 @@
+#include "common.hpp"
+
+#include "cli/app.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+int main(const int argc, char *argv[]) {
+    Setup();
+    const int ret = Catch::Session().run(argc, argv);
+    return ret;
+}
+
+namespace {
+
+constexpr int kExitError = 1;
+
+// Writes `seconds` of 16-bit stereo digital silence at 48 kHz.
+void WriteSilentWav(const fs::path &path, const int seconds) {
+    constexpr uint32_t kRate = 48000;
+    constexpr uint16_t kChannels = 2;
+    constexpr uint16_t kBlockAlign = kChannels * sizeof(int16_t);
+    const uint32_t dataSize = kRate * kBlockAlign * static_cast<uint32_t>(seconds);
+
+    std::ofstream out(path, std::ios::binary);
+    REQUIRE(out);
+    const auto u16 = [&](const uint16_t v) { out.put(static_cast<char>(v & 0xff)).put(static_cast<char>(v >> 8)); };
+    const auto u32 = [&](const uint32_t v) {
+        u16(static_cast<uint16_t>(v & 0xffff));
+        u16(static_cast<uint16_t>(v >> 16));
+    };
+    out << "RIFF";
+    u32(36 + dataSize);
+    out << "WAVEfmt ";
+    u32(16);
+    u16(1);
+    u16(kChannels);
+    u32(kRate);
+    u32(kRate * kBlockAlign);
+    u16(kBlockAlign);
+    u16(16);
+    out << "data";
+    u32(dataSize);
+    const std::vector<char> zeros(dataSize);
+    out.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+    REQUIRE(out);
+}
+
+// Runs the CLI with `args` and returns what it printed to stdout.
+std::string RunCli(std::vector<std::string> args, int &ret) {
+    // Every run registers its logger afresh.
+    spdlog::drop_all();
+
+    args.insert(args.begin(), "mua");
+    std::vector<char *> argv;
+    for (auto &arg : args) {
+        argv.push_back(arg.data());
+    }
+
+    std::ostringstream captured;
+    auto *const previous = std::cout.rdbuf(captured.rdbuf());
+    ret = mua::app::run(static_cast<int>(argv.size()), argv.data());
+    std::cout.rdbuf(previous);
+    return captured.str();
+}
+
+std::string ReadText(const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    REQUIRE(in);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
+// JSON has no literal for infinities or NaN; fmt spells them like this.
+void RequireFiniteJson(const std::string &json) {
+    CAPTURE(json);
+    REQUIRE(json.front() == '{');
+    for (const auto *bad : {"inf", "nan"}) {
+        REQUIRE(json.find(bad) == std::string::npos);
+    }
+}
+
+} // namespace
+
+TEST_CASE("JSON output of a silent source") {
+    const auto srcPath = GetOutputPath(L"cli_silent.wav");
+    const auto dstPath = GetOutputPath(L"cli_silent_normalized.wav");
+    const auto statsPath = GetOutputPath(L"cli_silent_stats.json");
+    WriteSilentWav(srcPath, 5);
+    fs::remove(statsPath);
+
+    int ret = 0;
+    const auto plan = RunCli({"audio_plan", "-s", lib::PathToUtf8(srcPath), "--json"}, ret);
+    REQUIRE(ret != kExitError);
+    RequireFiniteJson(plan);
+
+    RunCli({"audio_normalize", "-s", lib::PathToUtf8(srcPath), "-d", lib::PathToUtf8(dstPath), "--stats-json",
+            lib::PathToUtf8(statsPath)},
+           ret);
+    REQUIRE(ret != kExitError);
+    RequireFiniteJson(ReadText(statsPath));
+}
@@ -1,15 +1,29 @@
 #include "common.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <span>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+#include "image/detail/bc.hpp"
 #include "image/detail/chunk.hpp"
+#include "image/detail/dds.hpp"
+#include "image/detail/expand.hpp"
+#include "image/detail/raster.hpp"
+#include "image/detail/reduced_decode.hpp"
+#include "image/detail/resample.hpp"
 #include "image/image.hpp"
 
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
 using namespace Image;
 
 namespace {
@@ -62,6 +76,245 @@ void EnsureGeneratedAfb(const fs::path &path) {
                "AFB_GENERATED_SUFFIX");
 }
 
+// A smooth pattern, so reduced and full-size decodes can be compared without aliasing dominating
+// the difference. With four channels the alpha is a smooth diagonal ramp.
+OIIO::ImageBuf SmoothPattern(const int width, const int height, const int channels) {
+    OIIO::ImageBuf image(OIIO::ImageSpec(width, height, channels, OIIO::TypeDesc::UINT8));
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t i = (static_cast<size_t>(y) * width + x) * channels;
+            pixels[i] = static_cast<uint8_t>(255 * x / width);
+            pixels[i + 1] = static_cast<uint8_t>(255 * y / height);
+            pixels[i + 2] = static_cast<uint8_t>(128 + 100 * std::sin(x / 97.0) * std::cos(y / 131.0));
+            if (channels == 4) {
+                pixels[i + 3] = static_cast<uint8_t>(32 + 223 * (x + y) / (width + height));
+            }
+        }
+    }
+    image.set_pixels(OIIO::get_roi(image.spec()), OIIO::TypeDesc::UINT8, pixels.data());
+    return image;
+}
+
+// Writes a real JPEG (the .jpg fixtures above are PPM).
+void EnsureGeneratedJpeg(const fs::path &path, const int width, const int height, const int orientation) {
+    if (std::filesystem::exists(path)) {
+        return;
+    }
+
+    OIIO::ImageBuf image = SmoothPattern(width, height, 3);
+    image.specmod().attribute("Orientation", orientation);
+    image.specmod().attribute("CompressionQuality", 95);
+    if (!image.write(lib::PathToUtf8(path))) {
+        throw lib::FileError(path, image.geterror());
+    }
+}
+
+void EnsureGeneratedWebp(const fs::path &path, const int width, const int height, const bool alpha) {
+    if (std::filesystem::exists(path)) {
+        return;
+    }
+
+    OIIO::ImageBuf image = SmoothPattern(width, height, alpha ? 4 : 3);
+    image.specmod().attribute("oiio:UnassociatedAlpha", 1);
+    image.specmod().attribute("CompressionQuality", 95);
+    if (!image.write(lib::PathToUtf8(path))) {
+        throw lib::FileError(path, image.geterror());
+    }
+}
+
+// Writes a tiled TIFF texture that carries its whole MIP chain.
+void EnsureGeneratedMipmap(const fs::path &path, const int width, const int height) {
+    if (std::filesystem::exists(path)) {
+        return;
+    }
+
+    const OIIO::ImageBuf image = SmoothPattern(width, height, 3);
+    if (!OIIO::ImageBufAlgo::make_texture(OIIO::ImageBufAlgo::MakeTxTexture, image, lib::PathToUtf8(path),
+                                          OIIO::ImageSpec())) {
+        throw lib::FileError(path, OIIO::geterror());
+    }
+}
+
+// Full-size OIIO decode, then reorientation, then resize: the straightforward pipeline that
+// LoadResizedRgba must reproduce. Returns channels [`firstChannel`, `endChannel`) of the result.
+std::vector<uint8_t> ReferencePixels(const fs::path &path, const int width, const int height, const int firstChannel,
+                                     const int endChannel) {
+    OIIO::ImageBuf full(lib::PathToUtf8(path));
+    if (!full.read(0, 0, true, OIIO::TypeDesc::UINT8)) {
+        throw lib::FileError(path, full.geterror());
+    }
+    const OIIO::ImageBuf oriented = OIIO::ImageBufAlgo::reorient(full);
+    const OIIO::ImageBuf resized =
+        OIIO::ImageBufAlgo::resize(oriented, {}, OIIO::ROI(0, width, 0, height, 0, 1, 0, oriented.nchannels()));
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * (endChannel - firstChannel));
+    if (!resized.get_pixels(OIIO::ROI(0, width, 0, height, 0, 1, firstChannel, endChannel), OIIO::TypeDesc::UINT8,
+                            pixels.data())) {
+        throw lib::FileError(path, resized.geterror());
+    }
+    return pixels;
+}
+
+std::vector<uint8_t> ReferenceRgb(const fs::path &path, const int width, const int height) {
+    return ReferencePixels(path, width, height, 0, 3);
+}
+
+double MeanAbsoluteError(const Image::detail::RgbaImage &image, const std::vector<uint8_t> &rgb) {
+    double error = 0;
+    for (size_t i = 0; i < image.pixels.size(); ++i) {
+        const auto &pixel = image.pixels[i];
+        error += std::abs(pixel.r - rgb[i * 3]) + std::abs(pixel.g - rgb[i * 3 + 1]) +
+                 std::abs(pixel.b - rgb[i * 3 + 2]);
+    }
+    return error / (static_cast<double>(image.pixels.size()) * 3);
+}
+
+double AlphaMeanAbsoluteError(const Image::detail::RgbaImage &image, const std::vector<uint8_t> &alpha) {
+    double error = 0;
+    for (size_t i = 0; i < image.pixels.size(); ++i) {
+        error += std::abs(image.pixels[i].a - alpha[i]);
+    }
+    return error / static_cast<double>(image.pixels.size());
+}
+
+double Psnr(const Image::detail::RgbaImage &image, const std::vector<uint8_t> &rgb) {
+    double squared = 0;
+    for (size_t i = 0; i < image.pixels.size(); ++i) {
+        const auto &pixel = image.pixels[i];
+        const std::array<int, 3> difference = {pixel.r - rgb[i * 3], pixel.g - rgb[i * 3 + 1],
+                                               pixel.b - rgb[i * 3 + 2]};
+        for (const int d : difference) {
+            squared += d * d;
+        }
+    }
+    const double mse = squared / (static_cast<double>(image.pixels.size()) * 3);
+    return mse == 0 ? 100.0 : 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+// Full-size decode of `path` as 8-bit pixels, viewed for Resample.
+struct DecodedImage {
+    OIIO::ImageBuf buffer;
+    Image::detail::PixelView view;
+};
+
+DecodedImage DecodeFull(const fs::path &path) {
+    DecodedImage image{.buffer = OIIO::ImageBuf(lib::PathToUtf8(path)), .view = {}};
+    if (!image.buffer.read(0, 0, true, OIIO::TypeDesc::UINT8)) {
+        throw lib::FileError(path, image.buffer.geterror());
+    }
+    const OIIO::ImageSpec &spec = image.buffer.spec();
+    image.view = {.data = static_cast<const uint8_t *>(std::as_const(image.buffer).localpixels()),
+                  .width = spec.width,
+                  .height = spec.height,
+                  .channels = spec.nchannels,
+                  .rowStride = static_cast<std::ptrdiff_t>(image.buffer.scanline_stride())};
+    return image;
+}
+
+// Decodes BC1 or BC3 blocks, stored as in a DDS file, back to pixels the way a GPU samples them.
+Image::detail::RgbaImage DecodeBc(const std::span<const uint8_t> blocks, const unsigned width, const unsigned height,
+                                  const Image::detail::DdsCompression compression) {
+    using namespace Image::detail;
+    const bool bc3 = compression == DdsCompression::Bc3;
+    const size_t blockBytes = bc3 ? 16 : 8;
+    const unsigned blocksWide = (width + 3) / 4;
+    const unsigned blocksHigh = (height + 3) / 4;
+    REQUIRE(blocks.size() == blockBytes * blocksWide * blocksHigh);
+
+    const auto expand565 = [](const unsigned color) {
+        const unsigned r = color >> 11, g = color >> 5 & 63, b = color & 31;
+        return std::array<int, 3>{static_cast<int>(r << 3 | r >> 2), static_cast<int>(g << 2 | g >> 4),
+                                  static_cast<int>(b << 3 | b >> 2)};
+    };
+
+    RgbaImage image{.width = width,
+                    .height = height,
+                    .pixels = std::vector<RgbaPixel>(static_cast<size_t>(width) * height)};
+    for (unsigned by = 0; by < blocksHigh; ++by) {
+        for (unsigned bx = 0; bx < blocksWide; ++bx) {
+            const uint8_t *block = blocks.data() + (static_cast<size_t>(by) * blocksWide + bx) * blockBytes;
+
+            std::array<int, 16> alpha;
+            alpha.fill(255);
+            if (bc3) {
+                std::array<int, 8> values = {block[0], block[1], 0, 0, 0, 0, 0, 255};
+                if (values[0] > values[1]) {
+                    for (int i = 1; i < 7; ++i) {
+                        values[i + 1] = ((7 - i) * values[0] + i * values[1]) / 7;
+                    }
+                } else {
+                    for (int i = 1; i < 5; ++i) {
+                        values[i + 1] = ((5 - i) * values[0] + i * values[1]) / 5;
+                    }
+                }
+                uint64_t bits = 0;
+                for (int i = 0; i < 6; ++i) {
+                    bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+                }
+                for (int i = 0; i < 16; ++i) {
+                    alpha[i] = values[bits >> (3 * i) & 7];
+                }
+                block += 8;
+            }
+
+            const unsigned c0 = block[0] | block[1] << 8;
+            const unsigned c1 = block[2] | block[3] << 8;
+            const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+            const bool fourColor = bc3 || c0 > c1;
+            const auto e0 = expand565(c0);
+            const auto e1 = expand565(c1);
+            std::array<std::array<int, 4>, 4> palette{};
+            for (int c = 0; c < 3; ++c) {
+                palette[0][c] = e0[c];
+                palette[1][c] = e1[c];
+                palette[2][c] = fourColor ? (2 * e0[c] + e1[c]) / 3 : (e0[c] + e1[c]) / 2;
+                palette[3][c] = fourColor ? (e0[c] + 2 * e1[c]) / 3 : 0;
+            }
+            palette[0][3] = palette[1][3] = palette[2][3] = 255;
+            palette[3][3] = fourColor ? 255 : 0;
+
+            for (int i = 0; i < 16; ++i) {
+                const unsigned x = bx * 4 + i % 4;
+                const unsigned y = by * 4 + i / 4;
+                if (x >= width || y >= height) {
+                    continue;
+                }
+                const auto &color = palette[indices >> (2 * i) & 3];
+                const int a = bc3 ? alpha[i] : color[3];
+                image.pixels[static_cast<size_t>(y) * width + x].set(
+                    static_cast<uint8_t>(color[0]), static_cast<uint8_t>(color[1]), static_cast<uint8_t>(color[2]),
+                    static_cast<uint8_t>(a));
+            }
+        }
+    }
+    return image;
+}
+
+// Root-mean-square error over all four channels.
+double Rmse(const Image::detail::RgbaImage &a, const Image::detail::RgbaImage &b) {
+    REQUIRE(a.pixels.size() == b.pixels.size());
+    double squared = 0;
+    for (size_t i = 0; i < a.pixels.size(); ++i) {
+        const auto &p = a.pixels[i];
+        const auto &q = b.pixels[i];
+        const std::array<int, 4> difference = {p.r - q.r, p.g - q.g, p.b - q.b, p.a - q.a};
+        for (const int d : difference) {
+            squared += d * d;
+        }
+    }
+    return std::sqrt(squared / (static_cast<double>(a.pixels.size()) * 4));
+}
+
+// Error of `image` after a round trip through EncodeDds with `encoder`.
+double DdsRoundTripRmse(const Image::detail::RgbaImage &image, const Image::detail::DdsCompression compression,
+                        const Image::DdsEncoder encoder) {
+    constexpr size_t headerBytes = 128; // "DDS " and DDS_HEADER; BC1 and BC3 need no DX10 extension.
+    const auto dds = Image::detail::EncodeDds(image, compression, encoder);
+    REQUIRE(dds.size() > headerBytes);
+    const auto decoded = DecodeBc(std::span(dds).subspan(headerBytes), image.width, image.height, compression);
+    return Rmse(image, decoded);
+}
+
 void EnsureImageFixtures() {
     std::filesystem::create_directories(GetInputPath());
     EnsureGeneratedPpm(GetInputPath(L"1.jpg"), 640, 640, 1);
@@ -70,6 +323,11 @@ void EnsureImageFixtures() {
     EnsureGeneratedPpm(GetInputPath(L"4.jpg"), 1024, 1024, 4);
     EnsureGeneratedPpm(GetInputPath(L"bg.png"), 1920, 1080, 5);
     EnsureGeneratedAfb(GetInputPath(L"st_dummy.afb"));
+    EnsureGeneratedJpeg(GetInputPath(L"large.jpg"), 2400, 1600, 1);
+    EnsureGeneratedJpeg(GetInputPath(L"large_rotated.jpg"), 2400, 1600, 6);
+    EnsureGeneratedWebp(GetInputPath(L"large.webp"), 2400, 1600, false);
+    EnsureGeneratedWebp(GetInputPath(L"large_alpha.webp"), 2400, 1600, true);
+    EnsureGeneratedMipmap(GetInputPath(L"large_mip.tx"), 2048, 1024);
 }
 
 } // namespace
@@ -129,6 +387,245 @@ TEST_CASE("ConvertJacket") {
     }
 }
 
+TEST_CASE("Reduced decode") {
+    using namespace Image::detail;
+
+    SECTION("JPEG decodes at the smallest sufficient DCT scale") {
+        const OIIO::ImageBuf image = DecodeAtLeast(GetInputPath(L"large.jpg"), 300, 300);
+        REQUIRE(image.spec().width == 600);
+        REQUIRE(image.spec().height == 400);
+        REQUIRE(image.spec().format == OIIO::TypeDesc::UINT8);
+    }
+
+    SECTION("Target sizes apply after orientation") {
+        const OIIO::ImageBuf image = DecodeAtLeast(GetInputPath(L"large_rotated.jpg"), 300, 500);
+        REQUIRE(image.spec().width == 600);
+        REQUIRE(image.spec().height == 400);
+        REQUIRE(image.spec().get_int_attribute("Orientation") == 6);
+
+        const RgbaImage rgba = LoadResizedRgba(GetInputPath(L"large_rotated.jpg"), 300, 500);
+        REQUIRE(rgba.width == 300);
+        REQUIRE(rgba.height == 500);
+    }
+
+    SECTION("Formats without reduced decoding read at full size") {
+        const OIIO::ImageBuf image = DecodeAtLeast(GetInputPath(L"1.jpg"), 300, 300);
+        REQUIRE(image.spec().width == 640);
+        REQUIRE(image.spec().height == 640);
+    }
+
+    SECTION("Matches a full-size decode and resize") {
+        const auto path = GetInputPath(L"large.jpg");
+        REQUIRE(MeanAbsoluteError(LoadResizedRgba(path, 300, 300), ReferenceRgb(path, 300, 300)) < 2.0);
+    }
+
+    SECTION("Rotated sources match reorienting before the resize") {
+        const auto path = GetInputPath(L"large_rotated.jpg");
+        REQUIRE(MeanAbsoluteError(LoadResizedRgba(path, 300, 500), ReferenceRgb(path, 300, 500)) < 2.0);
+    }
+
+    SECTION("WebP decodes at the smallest sufficient scale") {
+        const auto path = GetInputPath(L"large.webp");
+        const OIIO::ImageBuf image = DecodeAtLeast(path, 300, 300);
+        REQUIRE(image.spec().width == 600);
+        REQUIRE(image.spec().height == 400);
+        REQUIRE(image.spec().nchannels == 3);
+        REQUIRE(MeanAbsoluteError(LoadResizedRgba(path, 300, 300), ReferenceRgb(path, 300, 300)) < 2.0);
+    }
+
+    SECTION("WebP with alpha keeps its alpha channel") {
+        const auto path = GetInputPath(L"large_alpha.webp");
+        const OIIO::ImageBuf image = DecodeAtLeast(path, 300, 300);
+        REQUIRE(image.spec().width == 600);
+        REQUIRE(image.spec().height == 400);
+        REQUIRE(image.spec().nchannels == 4);
+
+        const RgbaImage rgba = LoadResizedRgba(path, 300, 300);
+        REQUIRE(MeanAbsoluteError(rgba, ReferenceRgb(path, 300, 300)) < 2.0);
+        REQUIRE(AlphaMeanAbsoluteError(rgba, ReferencePixels(path, 300, 300, 3, 4)) < 2.0);
+    }
+
+    SECTION("MIP-mapped files read the smallest sufficient level") {
+        const auto path = GetInputPath(L"large_mip.tx");
+        const OIIO::ImageBuf image = DecodeAtLeast(path, 300, 200);
+        REQUIRE(image.spec().width == 512);
+        REQUIRE(image.spec().height == 256);
+        REQUIRE(DecodeAtLeast(path, 600, 200).spec().width == 1024);
+        REQUIRE(MeanAbsoluteError(LoadResizedRgba(path, 300, 200), ReferenceRgb(path, 300, 200)) < 2.0);
+    }
+
+    SECTION("Invalid image") {
+        REQUIRE_THROWS(DecodeAtLeast(GetInputPath(L"invalid.jpg"), 300, 300));
+    }
+}
+
+TEST_CASE("Resample") {
+    using namespace Image::detail;
+    const auto path = GetInputPath(L"large.jpg");
+    const DecodedImage source = DecodeFull(path);
+
+    SECTION("Matches OIIO's resize") {
+        for (const auto &[width, height] : {std::pair{300, 300}, std::pair{1920, 1080}, std::pair{256, 256}}) {
+            const RgbaImage resized = Resample(source.view, width, height);
+            REQUIRE(resized.width == static_cast<unsigned>(width));
+            REQUIRE(resized.height == static_cast<unsigned>(height));
+            REQUIRE(Psnr(resized, ReferenceRgb(path, width, height)) > 40.0);
+        }
+    }
+
+    SECTION("Mitchell stays close to Lanczos3") {
+        REQUIRE(Psnr(Resample(source.view, 300, 300, ResampleFilter::Mitchell), ReferenceRgb(path, 300, 300)) >
+                35.0);
+    }
+
+    SECTION("SIMD and scalar kernels agree") {
+        const RgbaImage scalar = Resample(source.view, 300, 300, ResampleFilter::Lanczos3, SimdLevel::Scalar);
+        const RgbaImage simd = Resample(source.view, 300, 300, ResampleFilter::Lanczos3, BestSimdLevel());
+        int maxDifference = 0;
+        for (size_t i = 0; i < scalar.pixels.size(); ++i) {
+            const auto &a = scalar.pixels[i];
+            const auto &b = simd.pixels[i];
+            maxDifference = std::max({maxDifference, std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b),
+                                      std::abs(a.a - b.a)});
+        }
+        REQUIRE(maxDifference <= 1);
+    }
+
+    SECTION("Same size is a copy") {
+        const std::vector<uint8_t> gray = {0, 255, 7, 128, 64, 200, 1, 2, 3, 4, 5, 6};
+        const PixelView view{.data = gray.data(), .width = 3, .height = 2, .channels = 2, .rowStride = 6};
+        for (const auto filter : {ResampleFilter::Lanczos3, ResampleFilter::Mitchell}) {
+            const RgbaImage copy = Resample(view, 3, 2, filter);
+            for (size_t i = 0; i < copy.pixels.size(); ++i) {
+                REQUIRE(copy.pixels[i].r == gray[i * 2]);
+                REQUIRE(copy.pixels[i].b == gray[i * 2]);
+                REQUIRE(copy.pixels[i].a == gray[i * 2 + 1]);
+            }
+        }
+    }
+
+    SECTION("Invalid sizes") {
+        REQUIRE_THROWS(Resample(source.view, 0, 300));
+        REQUIRE_THROWS(Resample(PixelView{}, 300, 300));
+    }
+}
+
+TEST_CASE("ExpandToRgba") {
+    using namespace Image::detail;
+
+    SECTION("Every channel count and tail length") {
+        for (int channels = 1; channels <= 5; ++channels) {
+            for (const size_t count : {size_t{0}, size_t{1}, size_t{9}, size_t{16}, size_t{17}, size_t{1921}}) {
+                std::vector<uint8_t> source(count * channels);
+                for (size_t i = 0; i < source.size(); ++i) {
+                    source[i] = static_cast<uint8_t>(i * 37 + channels);
+                }
+                for (const auto simd : {SimdLevel::Scalar, BestSimdLevel()}) {
+                    std::vector<RgbaPixel> rgba(count);
+                    ExpandToRgba(source.data(), channels, count, rgba.data(), simd);
+                    for (size_t i = 0; i < count; ++i) {
+                        const uint8_t *src = source.data() + i * channels;
+                        const RgbaPixel expected = channels == 1   ? RgbaPixel(src[0])
+                                                   : channels == 2 ? RgbaPixel(src[0], src[1])
+                                                                   : RgbaPixel(src[0], src[1], src[2],
+                                                                               channels >= 4 ? src[3] : 255);
+                        REQUIRE(rgba[i].r == expected.r);
+                        REQUIRE(rgba[i].g == expected.g);
+                        REQUIRE(rgba[i].b == expected.b);
+                        REQUIRE(rgba[i].a == expected.a);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Target-sized RGB sources are copied unchanged") {
+        const auto path = GetInputPath(L"bg.png");
+        const RgbaImage image = LoadResizedRgba(path, 1920, 1080);
+        const DecodedImage source = DecodeFull(path);
+        REQUIRE(source.view.channels == 3);
+        for (const unsigned y : {0u, 539u, 1079u}) {
+            for (const unsigned x : {0u, 1000u, 1919u}) {
+                const uint8_t *src = source.view.data + y * source.view.rowStride + x * 3;
+                const RgbaPixel &pixel = image.pixels[static_cast<size_t>(y) * 1920 + x];
+                REQUIRE(pixel.r == src[0]);
+                REQUIRE(pixel.g == src[1]);
+                REQUIRE(pixel.b == src[2]);
+                REQUIRE(pixel.a == 255);
+            }
+        }
+    }
+}
+
+TEST_CASE("BC encoder") {
+    using namespace Image::detail;
+
+    // The in-tree encoder must stay close to DirectXTex at the fast level and match it at the high one.
+    const auto checkAgainstDirectXTex = [](const RgbaImage &image, const DdsCompression compression) {
+        const double reference = DdsRoundTripRmse(image, compression, Image::DdsEncoder::DirectXTex);
+        const double fast = DdsRoundTripRmse(image, compression, Image::DdsEncoder::Fast);
+        const double high = DdsRoundTripRmse(image, compression, Image::DdsEncoder::High);
+        CAPTURE(reference, fast, high);
+        REQUIRE(fast <= reference * 1.35 + 0.5);
+        REQUIRE(high <= reference * 1.05 + 0.25);
+        REQUIRE(high <= fast);
+    };
+
+    SECTION("Jacket quality") {
+        checkAgainstDirectXTex(LoadResizedRgba(GetInputPath(L"1.jpg"), 300, 300), DdsCompression::Bc1);
+    }
+
+    SECTION("Background quality") {
+        checkAgainstDirectXTex(LoadResizedRgba(GetInputPath(L"bg.png"), 1920, 1080), DdsCompression::Bc1);
+    }
+
+    SECTION("BC3 alpha quality") {
+        RgbaImage image = LoadResizedRgba(GetInputPath(L"2.jpg"), 256, 256);
+        for (unsigned y = 0; y < image.height; ++y) {
+            for (unsigned x = 0; x < image.width; ++x) {
+                image.pixels[static_cast<size_t>(y) * image.width + x].a = static_cast<uint8_t>((x + y * 3) / 4);
+            }
+        }
+        checkAgainstDirectXTex(image, DdsCompression::Bc3);
+    }
+
+    SECTION("BC1 keeps transparent pixels transparent") {
+        RgbaImage image{.width = 7, .height = 5, .pixels = std::vector<RgbaPixel>(35)};
+        for (size_t i = 0; i < image.pixels.size(); ++i) {
+            const auto v = static_cast<uint8_t>(i * 7);
+            image.pixels[i].set(v, static_cast<uint8_t>(200 - i * 3), static_cast<uint8_t>(i * 5), i % 3 ? 255 : 0);
+        }
+        for (const auto quality : {BcQuality::Fast, BcQuality::High}) {
+            const auto decoded = DecodeBc(CompressBc(image, DdsCompression::Bc1, quality), 7, 5, DdsCompression::Bc1);
+            for (size_t i = 0; i < image.pixels.size(); ++i) {
+                REQUIRE((decoded.pixels[i].a == 0) == (image.pixels[i].a == 0));
+            }
+        }
+    }
+
+    SECTION("SIMD and scalar kernels produce identical blocks") {
+        RgbaImage image = LoadResizedRgba(GetInputPath(L"3.jpg"), 150, 90);
+        for (size_t i = 0; i < image.pixels.size(); ++i) {
+            image.pixels[i].a = static_cast<uint8_t>(i * 13);
+        }
+        for (const auto compression : {DdsCompression::Bc1, DdsCompression::Bc3}) {
+            for (const auto quality : {BcQuality::Fast, BcQuality::High}) {
+                REQUIRE(CompressBc(image, compression, quality, SimdLevel::Scalar) ==
+                        CompressBc(image, compression, quality, BestSimdLevel()));
+            }
+        }
+    }
+
+    SECTION("ConvertJacket with the in-tree encoder") {
+        for (const auto encoder : {Image::DdsEncoder::Fast, Image::DdsEncoder::High}) {
+            const auto dstPath = GetOutputPath(encoder == Image::DdsEncoder::Fast ? L"converted_jacket_bc_fast.dds"
+                                                                                 : L"converted_jacket_bc_high.dds");
+            REQUIRE_NOTHROW(ConvertJacket(GetInputPath(L"1.jpg"), dstPath, encoder));
+            REQUIRE(std::filesystem::file_size(dstPath) == 128 + 75 * 75 * 8);
+        }
+    }
+}
+
 TEST_CASE("ConvertStage") {
     const auto stSrcPath = GetInputPath(L"st_dummy.afb");
     SECTION("All") {
@@ -187,6 +684,49 @@ TEST_CASE("ExtractDdsFromAfb") {
     REQUIRE(foundDdsFile);
 }
 
+TEST_CASE("Resample benchmarks", "[.][!benchmark][image]") {
+    using namespace Image::detail;
+    const auto path = GetInputPath(L"large.jpg");
+    const DecodedImage source = DecodeFull(path);
+
+    BENCHMARK("OIIO resize to 1920x1080") {
+        return OIIO::ImageBufAlgo::resize(source.buffer, {}, OIIO::ROI(0, 1920, 0, 1080, 0, 1, 0, 3)).spec().width;
+    };
+
+    BENCHMARK("Resample to 1920x1080 (scalar)") {
+        return Resample(source.view, 1920, 1080, ResampleFilter::Lanczos3, SimdLevel::Scalar).width;
+    };
+
+    BENCHMARK("Resample to 1920x1080") {
+        return Resample(source.view, 1920, 1080).width;
+    };
+
+    BENCHMARK("Load a target-sized background") {
+        return LoadResizedRgba(GetInputPath(L"bg.png"), 1920, 1080).width;
+    };
+}
+
+TEST_CASE("BC encoder benchmarks", "[.][!benchmark][image]") {
+    using namespace Image::detail;
+    const RgbaImage background = LoadResizedRgba(GetInputPath(L"bg.png"), 1920, 1080);
+
+    BENCHMARK("Background with DirectXTex") {
+        return EncodeDds(background, DdsCompression::Bc1, Image::DdsEncoder::DirectXTex).size();
+    };
+
+    BENCHMARK("Background with the fast encoder") {
+        return EncodeDds(background, DdsCompression::Bc1, Image::DdsEncoder::Fast).size();
+    };
+
+    BENCHMARK("Background with the high-quality encoder") {
+        return EncodeDds(background, DdsCompression::Bc1, Image::DdsEncoder::High).size();
+    };
+
+    BENCHMARK("Background with the high-quality encoder (scalar)") {
+        return CompressBc(background, DdsCompression::Bc1, BcQuality::High, SimdLevel::Scalar).size();
+    };
+}
+
 TEST_CASE("Image performance benchmarks", "[.][!benchmark][image]") {
     const auto jacketSrcPath = GetInputPath(L"1.jpg");
     const auto bgSrcPath = GetInputPath(L"bg.png");
@@ -200,6 +740,18 @@ TEST_CASE("Image performance benchmarks", "[.][!benchmark][image]") {
         return std::filesystem::file_size(dstPath);
     };
 
+    BENCHMARK("ConvertJacket large JPEG") {
+        const auto dstPath = GetOutputPath(L"benchmark_jacket_large.dds");
+        ConvertJacket(GetInputPath(L"large.jpg"), dstPath);
+        return std::filesystem::file_size(dstPath);
+    };
+
+    BENCHMARK("ConvertJacket rotated large JPEG") {
+        const auto dstPath = GetOutputPath(L"benchmark_jacket_rotated.dds");
+        ConvertJacket(GetInputPath(L"large_rotated.jpg"), dstPath);
+        return std::filesystem::file_size(dstPath);
+    };
+
     BENCHMARK("ConvertStage") {
         const auto dstPath = GetOutputPath(L"benchmark_stage.afb");
         ConvertStage(bgSrcPath, stSrcPath, dstPath, fxSrcPaths);
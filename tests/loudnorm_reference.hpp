@@ -0,0 +1,158 @@
+#pragma once
+
+// FFmpeg's loudnorm first pass, kept only as the reference the native meter is checked against.
+// loudnorm reports its measurements solely through the log, so this installs a process-wide
+// av_log callback; that is acceptable in the test binary but not in the library.
+
+extern "C" {
+#include <libavutil/log.h>
+}
+
+#include "audio/detail/error.hpp"
+#include "audio/detail/filter.hpp"
+#include "audio/detail/loudnorm.hpp"
+#include "audio/detail/pipeline.hpp"
+#include "audio/detail/target_format.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+namespace LoudNormReference {
+
+// Collects everything FFmpeg logs on behalf of one object into memory. Messages from objects that
+// are not being captured are forwarded to av_log_default_callback unchanged.
+class LogCapture {
+  public:
+    LogCapture() = default;
+
+    ~LogCapture() {
+        if (!m_source)
+            return;
+        std::lock_guard lock(Mutex());
+        Captures().erase(m_source);
+    }
+
+    LogCapture(const LogCapture &) = delete;
+    LogCapture &operator=(const LogCapture &) = delete;
+
+    // Starts capturing messages logged with `source` as their context. The capture must outlive
+    // the object's last log call (filters log their summaries on uninit).
+    void Attach(const void *source) {
+        av::Require(source && !m_source, "Log capture needs exactly one source");
+        static std::once_flag callbackOnce;
+        std::call_once(callbackOnce, [] { av_log_set_callback(Callback); });
+
+        std::lock_guard lock(Mutex());
+        const auto [it, inserted] = Captures().try_emplace(source);
+        av::Require(inserted, "Log output of this object is already being captured");
+        m_source = source;
+    }
+
+    [[nodiscard]] std::string Text() const {
+        std::lock_guard lock(Mutex());
+        const auto it = Captures().find(m_source);
+        return it != Captures().end() ? it->second : std::string{};
+    }
+
+  private:
+    static std::mutex &Mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<const void *, std::string> &Captures() {
+        static std::unordered_map<const void *, std::string> captures;
+        return captures;
+    }
+
+    static void Callback(void *avcl, const int level, const char *fmt, va_list vl) {
+        {
+            std::lock_guard lock(Mutex());
+            if (const auto it = Captures().find(avcl); it != Captures().end()) {
+                va_list copy;
+                va_copy(copy, vl);
+                const int len = std::vsnprintf(nullptr, 0, fmt, copy);
+                va_end(copy);
+                if (len > 0) {
+                    auto &text = it->second;
+                    const auto start = text.size();
+                    text.resize(start + static_cast<size_t>(len) + 1);
+                    va_copy(copy, vl);
+                    std::vsnprintf(text.data() + start, static_cast<size_t>(len) + 1, fmt, copy);
+                    va_end(copy);
+                    text.resize(start + static_cast<size_t>(len));
+                }
+                return;
+            }
+        }
+        av_log_default_callback(avcl, level, fmt, vl);
+    }
+
+    const void *m_source = nullptr;
+};
+
+inline double ReadJsonDouble(const std::string &json, const char *key) {
+    const auto needle = fmt::format("\"{}\"", key);
+    auto pos = json.find(needle);
+    av::Require(pos != std::string::npos, "Missing loudnorm stat: {}", key);
+
+    pos = json.find(':', pos + needle.size());
+    av::Require(pos != std::string::npos, "Malformed loudnorm stat: {}", key);
+    ++pos;
+
+    while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
+        ++pos;
+    }
+    if (pos < json.size() && json[pos] == '"') {
+        ++pos;
+    }
+
+    errno = 0;
+    char *end = nullptr;
+    const double value = std::strtod(json.c_str() + pos, &end);
+    av::Require(end != json.c_str() + pos && errno != ERANGE, "Invalid loudnorm stat: {}", key);
+    return value;
+}
+
+// Runs loudnorm's first pass over the whole input, offset by `offset`, and returns the statistics
+// it prints for a second pass.
+inline Audio::detail::LoudNormStats AnalyzeLoudNorm(const Audio::detail::AVFormatInputContextPtr &ifmt,
+                                                    const AVStream *ist,
+                                                    const Audio::detail::AVCodecContextPtr &dctx,
+                                                    const double offset, const Audio::detail::TargetFormat &target) {
+    using namespace Audio::detail;
+    LogCapture summary;
+    {
+        const AVFilterGraphPtr graph(avfilter_graph_alloc());
+        av::Require(graph.get(), "Failed to allocate filter graph");
+
+        AVFilterContext *fsrc = BufferSource(graph, dctx);
+        AVFilterContext *flast = ApplyOffset(graph, dctx, fsrc, offset, target);
+        flast = Filter(graph, flast, "loudnorm", "loudnorm_probe", "I={}:LRA={}:TP={}:linear=1:print_format=json",
+                       target.Loudness, target.LoudnessRange, target.TruePeak);
+        summary.Attach(flast);
+        AVFilterContext *fsnk = Filter(graph, flast, "abuffersink", "loudnorm_probe_out");
+
+        const auto ret = avfilter_graph_config(graph.get(), nullptr);
+        av::Check(ret, "Failed to configure loudnorm analysis filter graph");
+
+        // The stats are logged when the graph is freed at the end of this scope.
+        RunGraph(ifmt, ist, dctx, fsrc, fsnk, [](AVFrame *) {});
+    }
+
+    const auto json = summary.Text();
+    return {
+        ReadJsonDouble(json, "input_i"),      ReadJsonDouble(json, "input_tp"),      ReadJsonDouble(json, "input_lra"),
+        ReadJsonDouble(json, "input_thresh"), ReadJsonDouble(json, "target_offset"),
+    };
+}
+
+} // namespace LoudNormReference